@@ -6,6 +6,7 @@
 
 // Funciones para nombres automáticos
 const char* get_auto_extension(const program_config_t *config);
+const char* get_reverse_extension(const program_config_t *config);
 char* generate_auto_output_path(const char *input_path, const program_config_t *config);
 char* process_output_path(const program_config_t *config);
 
@@ -21,4 +22,10 @@ int is_gsea_archive_file(const char *file_path);
 int create_directory_archive_file(const char *dir_path, const char *archive_path);
 int extract_directory_archive_file(const char *archive_path, const char *output_dir);
 
+// Archive v2: entradas procesadas en paralelo y directorio de offsets al final
+int is_archive_v2_file(const char *file_path);
+int create_archive_v2(const program_config_t *config, const char *archive_path);
+int extract_archive_v2(const program_config_t *config, const char *archive_path, const char *output_dir);
+int list_archive_v2(const char *archive_path);
+
 #endif
\ No newline at end of file
@@ -1,9 +1,13 @@
 #ifndef ARGS_PARSER_H
 #define ARGS_PARSER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define MAX_PATH_LENGTH 1024
 #define MAX_KEY_LENGTH 256
 #define MAX_ALG_NAME_LENGTH 50
+#define MAX_THREADS 1024
 
 // Operaciones disponibles
 typedef enum {
@@ -28,6 +32,27 @@ typedef enum {
     ENC_ALG_VIGENERE
 } encryption_alg_t;
 
+// Política de durabilidad de los archivos de salida
+typedef enum {
+    DURABILITY_DEFAULT,     // solo las salidas escritas de una vez con write_file() hacen fsync
+    DURABILITY_PER_FILE,    // fsync de cada salida al cerrarla
+    DURABILITY_NONE,        // sin sincronización explícita
+    DURABILITY_BATCH        // una sola sincronización al final del trabajo
+} durability_policy_t;
+
+// Planificación del procesamiento de directorios
+typedef enum {
+    SCHEDULER_WORK_STEALING,    // colas por hilo; los archivos grandes se reparten por chunks
+    SCHEDULER_SHARED_QUEUE,     // una cola compartida, cada hilo procesa archivos completos
+    SCHEDULER_STREAMING         // los hilos procesan los archivos a medida que el recorrido los encuentra
+} scheduler_policy_t;
+
+// Formato del archive generado para directorios
+typedef enum {
+    ARCHIVE_FORMAT_V1,      // el directorio se serializa y se procesa como un solo stream
+    ARCHIVE_FORMAT_V2       // cada archivo se procesa por separado, directorio de offsets al final
+} archive_format_t;
+
 // Estructura para almacenar la configuración del programa
 typedef struct {
     operation_t operations;
@@ -36,6 +61,25 @@ typedef struct {
     char input_path[MAX_PATH_LENGTH];
     char output_path[MAX_PATH_LENGTH];
     char key[MAX_KEY_LENGTH];
+    int stream_index;       // Escribir índice de chunks al final del stream (--index)
+    int range_enabled;      // Extraer solo un rango de bytes (--range)
+    size_t range_offset;
+    size_t range_length;
+    durability_policy_t durability;
+    int async_io;           // Lecturas/escrituras de chunks por io_uring si está disponible (--io-uring)
+    int direct_io;          // No contaminar el page cache: O_DIRECT / descarte tras procesar (--direct-io)
+    int num_threads;        // Hilos del pool de directorio; 0 = CPUs en línea (--threads)
+    scheduler_policy_t scheduler;   // Reparto del trabajo entre hilos (--scheduler)
+    int per_file;           // Directorios: un resultado por archivo en un árbol espejo (--per-file)
+    int incremental;        // --per-file: reprocesar solo lo nuevo o modificado según el manifiesto (--incremental)
+    archive_format_t archive_format;    // Formato del archive de directorios (--archive-format)
+    int solid_blocks;       // Archive v2: empaquetar archivos pequeños en bloques sólidos (--solid)
+    int dedup_chunks;       // Archive v2: deduplicar chunks definidos por contenido (--dedup-chunks)
+    char cache_dir[MAX_PATH_LENGTH];    // Caché de chunks comprimidos entre ejecuciones (--cache-dir)
+    uint64_t cache_max_bytes;           // Límite de la caché; se expulsa por LRU (--cache-size)
+    char delta_base[MAX_PATH_LENGTH];   // Versión anterior contra la que se codifica el delta (--delta-base)
+    int list_archive;       // Listar el directorio central de un archive v2 (--list)
+    char extract_pattern[MAX_PATH_LENGTH];  // Extraer solo las entradas que encajan (--extract)
     int valid;
 } program_config_t;
 
@@ -45,5 +89,10 @@ void print_usage(const char *program_name);
 int parse_operations(const char *op_str, operation_t *operations);
 compression_alg_t parse_compression_alg(const char *alg_str);
 encryption_alg_t parse_encryption_alg(const char *alg_str);
+int parse_durability_policy(const char *policy_str, durability_policy_t *policy);
+int parse_scheduler_policy(const char *policy_str, scheduler_policy_t *policy);
+int parse_archive_format(const char *format_str, archive_format_t *format);
+int parse_range(const char *range_str, size_t *offset, size_t *length);
+int parse_byte_size(const char *size_str, uint64_t *size);
 
 #endif
\ No newline at end of file
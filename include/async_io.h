@@ -0,0 +1,26 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define ASYNC_IO_QUEUE_DEPTH 8
+
+// Lector con varias lecturas en vuelo sobre io_uring (entrega en orden FIFO)
+typedef struct async_reader async_reader_t;
+
+// Escritor con varias escrituras posicionales en vuelo sobre io_uring
+typedef struct async_writer async_writer_t;
+
+int async_io_available(void);
+
+async_reader_t* async_reader_open(int fd, size_t slot_size, unsigned depth);
+int async_reader_enqueue(async_reader_t* reader, off_t offset, size_t length);
+ssize_t async_reader_next(async_reader_t* reader, const unsigned char** data);
+void async_reader_close(async_reader_t* reader);
+
+async_writer_t* async_writer_open(int fd, unsigned depth);
+int async_writer_write(async_writer_t* writer, unsigned char* data, size_t size, off_t offset);
+int async_writer_finish(async_writer_t* writer);
+
+#endif
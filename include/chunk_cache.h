@@ -0,0 +1,39 @@
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "args_parser.h"
+#include "compression.h"
+
+// Caché en disco de chunks ya comprimidos, compartible entre trabajos (--cache-dir)
+#define CHUNK_CACHE_DEFAULT_SIZE (1024ULL * 1024 * 1024)
+#define CHUNK_CACHE_MIN_CHUNK (4 * 1024)    // Por debajo, comprimir cuesta menos que buscar
+
+// Clave de un chunk: hash de 128 bits del contenido, codec, versión del codec y tamaño
+typedef struct {
+    uint64_t hash_high;
+    uint64_t hash_low;
+    unsigned char comp_alg;
+    uint32_t size;
+} chunk_cache_key_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t evictions;
+    uint64_t bytes_saved;   // Bytes originales que no hubo que recomprimir
+    uint64_t used_bytes;    // Ocupación actual de la caché
+} chunk_cache_stats_t;
+
+// 1 si el chunk estaba en caché (result queda con una copia propia del payload), 0 si no
+int chunk_cache_lookup(const program_config_t *config, const unsigned char *data, size_t size,
+                       chunk_cache_key_t *key, compression_result_t *result);
+// Guarda el resultado de un fallo; expulsa las entradas menos usadas si se supera el límite
+void chunk_cache_store(const program_config_t *config, const chunk_cache_key_t *key,
+                       const compression_result_t *result);
+void chunk_cache_get_stats(chunk_cache_stats_t *stats);
+void chunk_cache_report(const program_config_t *config);
+
+#endif
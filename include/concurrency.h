@@ -2,9 +2,29 @@
 #define CONCURRENCY_H
 
 #include <pthread.h>
+#include <stddef.h>
 #include "args_parser.h"
+#include "dir_utils.h"
 
-// Estructura para pasar datos a cada hilo
+typedef struct thread_pool thread_pool_t;
+
+// Tarea por archivo para run_file_pool(); index es la posición del archivo en la lista
+typedef int (*file_task_fn)(void *context, const char *path, size_t index);
+
+// Trabajo de un archivo; con robo de trabajo puede repartirse en tareas por chunk
+typedef struct file_job file_job_t;
+
+// Cola circular de tareas de un hilo; los demás hilos le roban cuando se quedan sin trabajo
+typedef struct {
+    file_job_t **tasks;
+    long long *priorities;      // Prioridad de robo de cada tarea, fijada al encolarla
+    size_t head;
+    size_t count;
+    size_t capacity;
+    pthread_mutex_t mutex;
+} task_deque_t;
+
+// Estado de cada hilo trabajador; se reutiliza para cada archivo que toma de la cola
 typedef struct {
     const program_config_t *config;
     char *input_file;
@@ -12,16 +32,31 @@ typedef struct {
     int thread_id;
     int success;
     char error_message[256];
+    thread_pool_t *pool;
+    size_t files_ok;
+    size_t files_failed;
+    size_t chunks_done;     // Tareas de chunk ejecutadas (robo de trabajo)
+    size_t tasks_stolen;    // Tareas tomadas de la cola de otro hilo
+    double busy_seconds;    // Tiempo ejecutando tareas
+    double longest_task;    // Tarea más larga (cota inferior del makespan)
 } thread_data_t;
 
-// Estructura para gestionar todos los hilos
-typedef struct {
+// Pool de tamaño fijo: cola compartida (la lista de archivos) o una cola por hilo con robo
+struct thread_pool {
     pthread_t *threads;
     thread_data_t *thread_data;
     int num_threads;
     int active_threads;
     pthread_mutex_t mutex;
-} thread_pool_t;
+    const FileList *queue;
+    size_t next_index;
+    file_task_fn task;      // Tarea de run_file_pool() (NULL: pipeline de archivos)
+    void *task_context;
+    task_deque_t *deques;
+    pthread_cond_t work_available;
+    long pending_tasks;     // Tareas encoladas en alguna cola (protegido por mutex)
+    size_t jobs_remaining;  // Archivos sin terminar (protegido por mutex)
+};
 
 // Funciones existentes
 void* process_single_file(void *arg);
@@ -29,5 +64,9 @@ int process_directory_concurrent(const program_config_t *config);
 char* generate_output_path(const char *input_path, const char *output_dir, const program_config_t *config);
 int init_thread_pool(thread_pool_t *pool, int num_threads);
 void free_thread_pool(thread_pool_t *pool);
+int default_thread_count(void);
+int resolve_thread_count(const program_config_t *config, size_t job_count);
+int run_file_pool(const program_config_t *config, const FileList *files,
+                  file_task_fn task, void *task_context);
 
-#endif
\ No newline at end of file
+#endif
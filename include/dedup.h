@@ -0,0 +1,52 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dir_utils.h"
+
+// Archivos con contenido idéntico dentro de una lista
+typedef struct {
+    size_t *original_of;    // original_of[i] == i si el archivo es único o es la primera copia
+    size_t duplicates;      // Archivos que pasan a ser referencias a su primera copia
+    uint64_t saved_bytes;   // Bytes que ya no se vuelven a procesar ni a guardar
+} dedup_plan_t;
+
+// Chunking por contenido (FastCDC): los cortes dependen de los datos, no de la posición
+#define CDC_MIN_CHUNK (2 * 1024)
+#define CDC_AVG_CHUNK (8 * 1024)
+#define CDC_MAX_CHUNK (64 * 1024)
+
+// Índice hash → id de chunk con direccionamiento abierto; admite hashes repetidos
+typedef struct {
+    uint64_t *hashes;
+    uint32_t *ids;
+    size_t capacity;        // Potencia de dos
+    size_t used;
+} dedup_index_t;
+
+// Hash rápido no criptográfico (XXH64) de un bloque de memoria
+uint64_t dedup_hash64(const void *data, size_t size, uint64_t seed);
+// Hash del contenido completo de un archivo; 0 si se pudo leer
+int dedup_hash_file(const char *path, uint64_t *hash_out);
+// El mismo hash que dedup_hash_file sobre un contenido ya en memoria (p. ej. mapeado)
+uint64_t dedup_hash_buffer(const void *data, size_t size);
+// 1 si ambos archivos tienen exactamente el mismo contenido
+int files_identical(const char *path_a, const char *path_b);
+
+// Busca duplicados: mismo tamaño, mismo hash y comparación completa
+int dedup_plan_files(const FileList *files, dedup_plan_t *plan);
+void dedup_plan_free(dedup_plan_t *plan);
+// Resumen para el usuario (solo si hubo duplicados)
+void dedup_report(const dedup_plan_t *plan);
+
+// Longitud del siguiente chunk de data[0..size); size == 0 devuelve 0
+size_t cdc_next_boundary(const unsigned char *data, size_t size);
+
+int dedup_index_init(dedup_index_t *index, size_t expected);
+// Siguiente id con ese hash a partir de *cursor (0 al empezar); UINT32_MAX si no hay más
+uint32_t dedup_index_find(const dedup_index_t *index, uint64_t hash, size_t *cursor);
+int dedup_index_insert(dedup_index_t *index, uint64_t hash, uint32_t id);
+void dedup_index_free(dedup_index_t *index);
+
+#endif
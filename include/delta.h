@@ -0,0 +1,34 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stdint.h>
+#include "args_parser.h"
+
+// Codificación de un archivo como diferencias frente a una versión anterior (--delta-base)
+#define DELTA_MAGIC "GSDL"
+#define DELTA_VERSION 1
+#define DELTA_HEADER_SIZE 40
+#define DELTA_MIN_BLOCK 32                  // Coincidencia mínima que se busca en la base
+#define DELTA_MAX_INDEX_BLOCKS (1u << 22)   // Con bases mayores se agranda el bloque, no el índice
+
+typedef struct {
+    uint64_t copied_bytes;      // Bytes que se toman de la base
+    uint64_t inserted_bytes;    // Bytes nuevos que viajan dentro del delta
+    uint64_t copy_ops;
+    uint64_t insert_ops;
+    uint64_t delta_size;        // Tamaño del delta antes de pasar por los codecs
+} delta_stats_t;
+
+// Escribe en delta_path las operaciones COPY/INSERT que reconstruyen target a partir de base
+int delta_encode(const char *base_path, const char *target_path, const char *delta_path,
+                 delta_stats_t *stats);
+// Reconstruye el archivo original; falla si la base no es la usada al codificar
+int delta_apply(const char *base_path, const char *delta_path, const char *output_path,
+                int sync_to_disk);
+
+// Delta frente a config->delta_base y después el pipeline normal (-c, -e, -ce)
+int delta_compress_file(const program_config_t *config, const char *input_path, const char *output_path);
+// Deshace el pipeline (-d, -u, -du) y aplica el delta sobre config->delta_base
+int delta_reconstruct_file(const program_config_t *config, const char *input_path, const char *output_path);
+
+#endif
@@ -2,12 +2,32 @@
 #define DIR_UTILS_H
 
 #include <stddef.h>
+#include <sys/types.h>
+
+struct file_list_block;
 
 typedef struct {
-    char **paths;
+    char **paths;       // Apuntan a la arena de la lista: no se liberan una a una
+    off_t *sizes;       // Tamaño de cada archivo, capturado durante el recorrido
     size_t count;
+    size_t capacity;    // Ranuras reservadas en paths/sizes (crecimiento geométrico)
+    struct file_list_block *arena;  // Bloques donde se guardan las rutas
 } FileList;
 
+#define DIR_WALK_MAX_THREADS 16     // Hilos del recorrido paralelo si no se indican
+
+// Se llama con cada archivo regular en cuanto se encuentra; un valor distinto de 0 detiene el recorrido
+typedef int (*file_visit_fn)(void *context, const char *path, size_t path_length, off_t size);
+
 void read_directory_recursive(const char *base_path, FileList *list);
+// Recorrido secuencial sin lista; 0 si terminó, -1 o lo que devolvió visit si no
+int walk_directory_tree(const char *base_path, file_visit_fn visit, void *context);
+// Recorre con varios hilos (threads <= 0: CPUs en línea); la lista queda ordenada por ruta
+void read_directory_parallel(const char *base_path, FileList *list, int threads);
+// Copia la ruta a la arena de la lista y la añade al final; 0 si se pudo
+int file_list_add(FileList *list, const char *path, size_t path_length, off_t size);
+void sort_file_list_by_size(FileList *list);
+void sort_file_list_by_path(FileList *list);
+void free_file_list(FileList *list);
 
-#endif
\ No newline at end of file
+#endif
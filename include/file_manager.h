@@ -7,9 +7,37 @@
 
 #define FILE_READ_BUFFER_SIZE 4096
 #define MAX_PATH_LENGTH 1024
+#define FILE_MAP_MIN_SIZE (64 * 1024)
+#define FILE_COPY_BUFFER_SIZE (256 * 1024)
+#define FILE_DIRECT_IO_ALIGNMENT 4096
+#define FILE_CACHE_DROP_WINDOW (8 * 1024 * 1024)
+
+// Vista de solo lectura de un archivo completo
+typedef struct {
+    unsigned char* data;
+    size_t size;
+    int mapped;     // 1 si proviene de mmap, 0 si es memoria del heap
+} file_mapping_t;
 
 int read_file(const char* path, unsigned char** buffer, size_t* size);
+int map_file_readonly(const char* path, file_mapping_t* mapping);
+void unmap_file(file_mapping_t* mapping);
 int write_file(const char* path, const unsigned char* data, size_t size);
+int write_file_synced(const char* path, const unsigned char* data, size_t size, int sync_to_disk);
+int write_full(int fd, const void* data, size_t size);
+int sync_file_descriptor(int fd, const char* path);
+int sync_filesystem(const char* path);
+int copy_file_region(int in_fd, off_t* in_offset, int out_fd, size_t length);
+int copy_file_region_sparse(int in_fd, off_t* in_offset, int out_fd, size_t length);
+int file_is_sparse(int fd);
+int region_has_holes(int fd, off_t offset, size_t length);
+off_t next_data_offset(int fd, off_t offset);
+int open_uncached_readonly(const char* path, int* direct);
+int disable_direct_io(int fd);
+void* alloc_aligned_buffer(size_t size);
+int drop_file_cache(int fd, off_t offset, off_t length, int write_back);
+int preallocate_file(int fd, off_t size);
+int release_preallocation(int fd);
 int get_file_info(const char* path, struct stat* stat_buf);
 int file_exists(const char* path);
 int is_directory(const char* path);
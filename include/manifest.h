@@ -0,0 +1,65 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "args_parser.h"
+#include "dir_utils.h"
+
+// Nombre del manifiesto dentro del directorio de salida de --per-file --incremental
+#define MANIFEST_FILE_NAME ".gsea-manifest"
+
+// Estado de un archivo de entrada cuando se procesó por última vez
+typedef struct {
+    char *path;             // Relativa al directorio de entrada
+    uint64_t size;
+    int64_t mtime_sec;
+    long mtime_nsec;
+    uint64_t inode;
+    uint64_t hash;          // XXH64 del contenido (dedup_hash_file)
+} manifest_entry_t;
+
+typedef struct {
+    unsigned char operations;   // Codec con el que se generaron las salidas
+    unsigned char comp_alg;
+    unsigned char enc_alg;
+    uint64_t chunk_size;        // Tamaño de chunk de los streams comprimidos
+    uint64_t key_hash;          // Huella de la clave (nunca la clave); 0 sin encriptación
+    manifest_entry_t *entries;  // Ordenadas por ruta al cargar
+    size_t count;
+    size_t capacity;
+} manifest_t;
+
+// Resultado de comparar el recorrido actual con el manifiesto anterior
+typedef struct {
+    size_t unchanged;       // Se conserva la salida existente
+    size_t touched;         // Metadatos distintos pero mismo contenido: tampoco se reprocesa
+    size_t added;
+    size_t modified;
+    size_t removed;         // Estaban en el manifiesto y ya no existen en la entrada
+} manifest_stats_t;
+
+// Carga el manifiesto; si no existe queda vacío y devuelve 0
+int manifest_load(const char *path, manifest_t *manifest);
+// Escribe a un temporal y lo renombra: un corte nunca deja un manifiesto a medias
+int manifest_save(const char *path, const manifest_t *manifest);
+const manifest_entry_t *manifest_find(const manifest_t *manifest, const char *path);
+int manifest_add(manifest_t *manifest, const char *path, const struct stat *st, uint64_t hash);
+void manifest_free(manifest_t *manifest);
+
+/*
+ * Quita de la lista los archivos cuya salida sigue siendo válida y prepara en
+ * next el manifiesto que describe el árbol tras procesar los que quedan.
+ */
+int manifest_filter_files(const program_config_t *config, FileList *files, const manifest_t *previous,
+                          manifest_t *next, manifest_stats_t *stats);
+// 1 si path es el manifiesto de una salida incremental anterior (no es un archivo a procesar)
+int manifest_is_own_file(const program_config_t *config, const char *path);
+// Quita de la lista ese manifiesto (al reprocesar una salida incremental con -d/-u)
+void manifest_exclude(const program_config_t *config, FileList *files);
+// Borra las salidas de los archivos que ya no existen en la entrada
+void manifest_remove_stale(const program_config_t *config, const manifest_t *previous,
+                           const manifest_t *next);
+
+#endif
@@ -1,10 +1,42 @@
 #ifndef OPERATIONS_H
 #define OPERATIONS_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 #include "args_parser.h"
+#include "compression.h"
 
 int execute_file_pipeline(const program_config_t *config,
                           const char *input_path,
                           const char *output_path);
 
-#endif
\ No newline at end of file
+// Escritor de streams GSC1 alimentado con chunks ya comprimidos, en orden
+typedef struct chunk_stream_writer chunk_stream_writer_t;
+
+size_t stream_chunk_size(void);
+chunk_stream_writer_t* chunk_stream_writer_open(const program_config_t *config,
+                                                const char *output_path,
+                                                size_t chunk_size);
+int compress_stream_chunk(const program_config_t *config, const unsigned char *data,
+                          size_t size, compression_result_t *result);
+int chunk_stream_writer_append(chunk_stream_writer_t *writer, size_t original_size,
+                               compression_result_t *compressed);
+int chunk_stream_writer_close(chunk_stream_writer_t *writer, int commit);
+
+// Pipeline en streaming: bytes en claro ↔ archivo comprimido y/o encriptado
+typedef struct pipeline_writer pipeline_writer_t;
+typedef struct pipeline_reader pipeline_reader_t;
+
+pipeline_writer_t* pipeline_writer_open(const program_config_t *config, const char *output_path);
+int pipeline_writer_write(pipeline_writer_t *writer, const unsigned char *data, size_t size);
+int pipeline_writer_close(pipeline_writer_t *writer, int commit);
+
+int pipeline_reader_open(const program_config_t *config, const char *input_path,
+                         pipeline_reader_t **reader);
+int pipeline_reader_open_range(const program_config_t *config, int fd, uint64_t offset, uint64_t length,
+                               pipeline_reader_t **reader);
+ssize_t pipeline_reader_read(pipeline_reader_t *reader, unsigned char *buffer, size_t size);
+void pipeline_reader_close(pipeline_reader_t *reader);
+
+#endif
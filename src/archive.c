@@ -9,13 +9,20 @@
 #include <unistd.h>
 
 #include "../include/archive.h"
+#include "../include/concurrency.h"
+#include "../include/dedup.h"
 #include "../include/dir_utils.h"
 #include "../include/file_manager.h"
 #include "../include/operations.h"
 
 #define ARCHIVE_MAGIC "GSEAARCHv1"
+/* Mismo formato con entradas de referencia: las versiones que no las conocen
+ * rechazan el magic en lugar de leer el marcador como un tamaño */
+#define ARCHIVE_MAGIC_REFS "GSEAARCHr1"
 #define ARCHIVE_HEADER_SIZE 10
 #define ARCHIVE_IO_BUFFER (64 * 1024)
+/* En lugar del tamaño: la entrada repite el contenido de una anterior, cuyo índice sigue */
+#define ARCHIVE_ENTRY_REFERENCE ((size_t)-1)
 
 typedef struct {
     unsigned char data[ARCHIVE_IO_BUFFER];
@@ -40,19 +47,9 @@ static int create_temp_archive_file(char *buffer, size_t length) {
     return 0;
 }
 
-static void free_file_list(FileList *list) {
-    if (!list || !list->paths) {
-        return;
-    }
-
-    for (size_t i = 0; i < list->count; ++i) {
-        free(list->paths[i]);
-    }
-
-    free(list->paths);
-    list->paths = NULL;
-    list->count = 0;
-}
+static int extract_archive_with_policy(const program_config_t *config,
+                                       const char *archive_path,
+                                       const char *output_dir);
 
 static const char *compute_relative_path(const char *base, const char *absolute) {
     size_t base_len = strlen(base);
@@ -89,6 +86,30 @@ static int ensure_parent_directory(const char *full_path) {
 }
 
 static int copy_stream(FILE *in, FILE *out, size_t total_bytes, io_buffer_t *buffer) {
+    /*
+     * Copia en el kernel entre los descriptores subyacentes. Se vacía el
+     * buffer de escritura, se lee desde la posición lógica de 'in' y luego
+     * se reposicionan ambos FILE* para que los encabezados siguientes
+     * continúen donde terminó la copia. Los huecos del origen se conservan
+     * como huecos en el destino.
+     */
+    off_t in_offset = ftello(in);
+    if (total_bytes > 0 && in_offset != -1 && fflush(out) == 0) {
+        int rc = copy_file_region_sparse(fileno(in), &in_offset, fileno(out), total_bytes);
+        if (rc == -2) {
+            fprintf(stderr, "Error: fin de archivo inesperado\n");
+            return -1;
+        }
+        if (rc != 0) {
+            return -1;
+        }
+        if (fseeko(in, in_offset, SEEK_SET) != 0 || fseeko(out, 0, SEEK_END) != 0) {
+            fprintf(stderr, "Error: no se pudo reposicionar el archive - %s\n", strerror(errno));
+            return -1;
+        }
+        return 0;
+    }
+
     size_t remaining = total_bytes;
 
     while (remaining > 0) {
@@ -115,8 +136,24 @@ static int copy_stream(FILE *in, FILE *out, size_t total_bytes, io_buffer_t *buf
     return 0;
 }
 
-static int write_archive_header(FILE *out, size_t file_count) {
-    if (fwrite(ARCHIVE_MAGIC, 1, ARCHIVE_HEADER_SIZE, out) != ARCHIVE_HEADER_SIZE) {
+/* Sin duplicados el archive es idéntico al de versiones anteriores */
+static const char *archive_magic(const dedup_plan_t *plan) {
+    return plan->duplicates > 0 ? ARCHIVE_MAGIC_REFS : ARCHIVE_MAGIC;
+}
+
+/* 0 archive sin referencias, 1 con referencias, -1 si no es un archive */
+static int archive_magic_kind(const unsigned char *header) {
+    if (memcmp(header, ARCHIVE_MAGIC, ARCHIVE_HEADER_SIZE) == 0) {
+        return 0;
+    }
+    if (memcmp(header, ARCHIVE_MAGIC_REFS, ARCHIVE_HEADER_SIZE) == 0) {
+        return 1;
+    }
+    return -1;
+}
+
+static int write_archive_header(FILE *out, const char *magic, size_t file_count) {
+    if (fwrite(magic, 1, ARCHIVE_HEADER_SIZE, out) != ARCHIVE_HEADER_SIZE) {
         fprintf(stderr, "Error: no se pudo escribir el encabezado del archive.\n");
         return -1;
     }
@@ -129,14 +166,15 @@ static int write_archive_header(FILE *out, size_t file_count) {
     return 0;
 }
 
-static int read_archive_header(FILE *in, size_t *file_count) {
+static int read_archive_header(FILE *in, size_t *file_count, int *references) {
     unsigned char header[ARCHIVE_HEADER_SIZE];
     if (fread(header, 1, ARCHIVE_HEADER_SIZE, in) != ARCHIVE_HEADER_SIZE) {
         fprintf(stderr, "Error: encabezado inválido en archive.\n");
         return -1;
     }
 
-    if (memcmp(header, ARCHIVE_MAGIC, ARCHIVE_HEADER_SIZE) != 0) {
+    *references = archive_magic_kind(header);
+    if (*references < 0) {
         fprintf(stderr, "Error: el archivo no es un archive válido.\n");
         return -1;
     }
@@ -193,9 +231,41 @@ static int write_archive_entry(FILE *out,
     return status;
 }
 
-static int extract_archive_entry(FILE *in,
-                                 const char *output_dir,
-                                 io_buffer_t *buffer) {
+/* Entrada idéntica a una anterior: solo se guarda la ruta y el índice del original */
+static int write_archive_reference(FILE *out, const char *base_dir, const char *absolute_path,
+                                   size_t original) {
+    const char *relative = compute_relative_path(base_dir, absolute_path);
+    size_t path_len = strlen(relative);
+    size_t marker = ARCHIVE_ENTRY_REFERENCE;
+
+    if (fwrite(&path_len, sizeof(size_t), 1, out) != 1 ||
+        fwrite(relative, 1, path_len, out) != path_len ||
+        fwrite(&marker, sizeof(size_t), 1, out) != 1 ||
+        fwrite(&original, sizeof(size_t), 1, out) != 1) {
+        fprintf(stderr, "Error: no se pudo escribir la referencia de '%s' en el archive.\n", relative);
+        return -1;
+    }
+
+    printf("  = Duplicado '%s' (mismo contenido que la entrada %zu)\n", relative, original);
+    return 0;
+}
+
+/* Posición de una entrada dentro del archive, obtenida al recorrer sus encabezados */
+typedef struct {
+    char *relative;
+    off_t data_offset;
+    size_t size;
+} archive_entry_ref_t;
+
+typedef struct {
+    int archive_fd;             // Compartido por los hilos: solo lecturas posicionales
+    const char *output_dir;
+    const archive_entry_ref_t *entries;
+    int sync_to_disk;
+} archive_extract_context_t;
+
+static int read_archive_entry_ref(FILE *in, archive_entry_ref_t *entries, size_t index, int references) {
+    archive_entry_ref_t *entry = &entries[index];
     size_t path_len = 0;
     if (fread(&path_len, sizeof(size_t), 1, in) != 1) {
         fprintf(stderr, "Error: no se pudo leer la longitud de la ruta del archive.\n");
@@ -207,53 +277,96 @@ static int extract_archive_entry(FILE *in,
         return -1;
     }
 
-    char *relative = (char *)malloc(path_len + 1);
-    if (!relative) {
+    entry->relative = (char *)malloc(path_len + 1);
+    if (!entry->relative) {
         fprintf(stderr, "Error: sin memoria para ruta del archivo dentro del archive.\n");
         return -1;
     }
 
-    if (fread(relative, 1, path_len, in) != path_len) {
+    if (fread(entry->relative, 1, path_len, in) != path_len) {
         fprintf(stderr, "Error: no se pudo leer ruta del archive.\n");
-        free(relative);
         return -1;
     }
-    relative[path_len] = '\0';
+    entry->relative[path_len] = '\0';
 
-    size_t file_size = 0;
-    if (fread(&file_size, sizeof(size_t), 1, in) != 1) {
+    if (fread(&entry->size, sizeof(size_t), 1, in) != 1) {
         fprintf(stderr, "Error: no se pudo leer tamaño de archivo en archive.\n");
-        free(relative);
         return -1;
     }
 
+    /* Un duplicado comparte el rango de datos de su original */
+    if (entry->size == ARCHIVE_ENTRY_REFERENCE) {
+        size_t original = 0;
+        if (!references || fread(&original, sizeof(size_t), 1, in) != 1 || original >= index) {
+            fprintf(stderr, "Error: referencia inválida en la entrada '%s'.\n", entry->relative);
+            return -1;
+        }
+        entry->size = entries[original].size;
+        entry->data_offset = entries[original].data_offset;
+        return 0;
+    }
+
+    /* Los datos no se leen aquí: solo se salta hasta el siguiente encabezado */
+    entry->data_offset = ftello(in);
+    if (entry->data_offset == -1 || fseeko(in, (off_t)entry->size, SEEK_CUR) != 0) {
+        fprintf(stderr, "Error: no se pudo recorrer el archive - %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_entry_refs_by_size(const void *a, const void *b) {
+    const archive_entry_ref_t *left = (const archive_entry_ref_t *)a;
+    const archive_entry_ref_t *right = (const archive_entry_ref_t *)b;
+    if (left->size != right->size) {
+        return left->size > right->size ? -1 : 1;
+    }
+    return strcmp(left->relative, right->relative);
+}
+
+/* Tarea del pool: copia los datos de una entrada desde el descriptor compartido */
+static int extract_archive_entry(void *context, const char *relative, size_t index) {
+    const archive_extract_context_t *ctx = (const archive_extract_context_t *)context;
+    const archive_entry_ref_t *entry = &ctx->entries[index];
+
     char full_path[MAX_PATH_LENGTH];
-    if (snprintf(full_path, sizeof(full_path), "%s/%s", output_dir, relative) >= (int)sizeof(full_path)) {
+    if (snprintf(full_path, sizeof(full_path), "%s/%s", ctx->output_dir, relative) >= (int)sizeof(full_path)) {
         fprintf(stderr, "Error: la ruta destino es demasiado larga.\n");
-        free(relative);
         return -1;
     }
 
-    if (ensure_parent_directory(full_path) != 0) {
-        fprintf(stderr, "Error: no se pudo crear directorio para '%s'.\n", full_path);
-        free(relative);
+    int out_fd = open(full_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd == -1) {
+        fprintf(stderr, "Error: no se pudo crear '%s' - %s\n", full_path, strerror(errno));
         return -1;
     }
 
-    FILE *out = open_stream(full_path, "wb", "crear");
-    if (!out) {
-        free(relative);
-        return -1;
+    /* El tamaño de la entrada es exacto: reservar los bloques antes de copiar,
+     * salvo que la entrada contenga huecos que deben seguir siéndolo */
+    if (!region_has_holes(ctx->archive_fd, entry->data_offset, entry->size)) {
+        preallocate_file(out_fd, (off_t)entry->size);
     }
 
-    int status = copy_stream(in, out, file_size, buffer);
-    fclose(out);
+    off_t in_offset = entry->data_offset;
+    int status = 0;
+    if (entry->size > 0) {
+        int rc = copy_file_region_sparse(ctx->archive_fd, &in_offset, out_fd, entry->size);
+        if (rc == -2) {
+            fprintf(stderr, "Error: fin de archivo inesperado\n");
+        }
+        status = rc == 0 ? 0 : -1;
+    }
+    if (status == 0 && ctx->sync_to_disk) {
+        sync_file_descriptor(out_fd, full_path);
+    }
+    if (status != 0) {
+        release_preallocation(out_fd);
+    }
+    close(out_fd);
 
     if (status == 0) {
-        printf("  + Extraído '%s' (%zu bytes)\n", relative, file_size);
+        printf("  + Extraído '%s' (%zu bytes)\n", relative, entry->size);
     }
-
-    free(relative);
     return status;
 }
 
@@ -271,13 +384,25 @@ char *process_output_path(const program_config_t *config) {
     return strdup("salida.gsea");
 }
 
+/* Extensión de la salida comprimida: la del algoritmo, para poder reconocerla al volver */
+static const char *compression_extension(compression_alg_t alg) {
+    switch (alg) {
+        case COMP_ALG_HUFFMAN:
+            return ".huff";
+        case COMP_ALG_LZW:
+            return ".lzw";
+        default:
+            return ".rle";
+    }
+}
+
 const char *get_auto_extension(const program_config_t *config) {
     if ((config->operations & OP_COMPRESS) && (config->operations & OP_ENCRYPT)) {
         return ".gsea";
     }
 
     if (config->operations & OP_COMPRESS) {
-        return ".rle";
+        return compression_extension(config->comp_alg);
     }
 
     if (config->operations & OP_ENCRYPT) {
@@ -295,6 +420,23 @@ const char *get_auto_extension(const program_config_t *config) {
     return "";
 }
 
+/* Extensión que añadió la operación directa y que la inversa debe quitar */
+const char *get_reverse_extension(const program_config_t *config) {
+    if ((config->operations & OP_DECOMPRESS) && (config->operations & OP_DECRYPT)) {
+        return ".gsea";
+    }
+
+    if (config->operations & OP_DECOMPRESS) {
+        return compression_extension(config->comp_alg);
+    }
+
+    if (config->operations & OP_DECRYPT) {
+        return ".enc";
+    }
+
+    return "";
+}
+
 char *generate_auto_output_path(const char *input_path, const program_config_t *config) {
     const char *base_name = strrchr(input_path, '/');
     if (base_name == NULL) {
@@ -334,7 +476,7 @@ int create_directory_archive_file(const char *dir_path, const char *archive_path
     }
 
     FileList list = {0};
-    read_directory_recursive(dir_path, &list);
+    read_directory_parallel(dir_path, &list, 0);
 
     if (list.count == 0) {
         fprintf(stderr, "Error: el directorio '%s' está vacío o no se pudo leer.\n", dir_path);
@@ -342,31 +484,61 @@ int create_directory_archive_file(const char *dir_path, const char *archive_path
         return -1;
     }
 
+    // Los archivos idénticos se guardan una sola vez
+    dedup_plan_t plan;
+    if (dedup_plan_files(&list, &plan) != 0) {
+        fprintf(stderr, "Error: sin memoria para deduplicar el directorio.\n");
+        free_file_list(&list);
+        return -1;
+    }
+
     FILE *out = open_stream(archive_path, "wb", "crear");
     if (!out) {
+        dedup_plan_free(&plan);
         free_file_list(&list);
         return -1;
     }
 
     io_buffer_t buffer = {0};
-    int status = write_archive_header(out, list.count);
+    int status = write_archive_header(out, archive_magic(&plan), list.count);
 
     for (size_t i = 0; status == 0 && i < list.count; ++i) {
-        status = write_archive_entry(out, dir_path, list.paths[i], &buffer);
+        if (plan.original_of[i] != i) {
+            status = write_archive_reference(out, dir_path, list.paths[i], plan.original_of[i]);
+        } else {
+            status = write_archive_entry(out, dir_path, list.paths[i], &buffer);
+        }
     }
 
     if (status == 0) {
+        dedup_report(&plan);
         printf("Archive generado en '%s'\n", archive_path);
     } else {
         unlink(archive_path);
     }
 
     fclose(out);
+    dedup_plan_free(&plan);
     free_file_list(&list);
     return status;
 }
 
 int extract_directory_archive_file(const char *archive_path, const char *output_dir) {
+    program_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.durability = DURABILITY_NONE;
+    return extract_archive_with_policy(&config, archive_path, output_dir);
+}
+
+/*
+ * Extracción en dos fases: se recorren los encabezados saltando los datos
+ * para conocer la posición de cada entrada, se crean los directorios y luego
+ * el pool de hilos copia las entradas (de mayor a menor) con lecturas
+ * posicionales sobre un único descriptor del archive.
+ */
+static int extract_archive_with_policy(const program_config_t *config,
+                                       const char *archive_path,
+                                       const char *output_dir) {
     if (!archive_path || !output_dir) {
         return -1;
     }
@@ -377,7 +549,23 @@ int extract_directory_archive_file(const char *archive_path, const char *output_
     }
 
     size_t file_count = 0;
-    int status = read_archive_header(in, &file_count);
+    int references = 0;
+    int status = read_archive_header(in, &file_count, &references);
+
+    archive_entry_ref_t *entries = NULL;
+    if (status == 0 && file_count > 0) {
+        entries = (archive_entry_ref_t *)calloc(file_count, sizeof(archive_entry_ref_t));
+        if (!entries) {
+            fprintf(stderr, "Error: sin memoria para las entradas del archive.\n");
+            status = -1;
+        }
+    }
+
+    size_t scanned = 0;
+    while (status == 0 && scanned < file_count) {
+        status = read_archive_entry_ref(in, entries, scanned, references);
+        scanned++;
+    }
 
     if (status == 0) {
         status = create_directory(output_dir);
@@ -386,15 +574,58 @@ int extract_directory_archive_file(const char *archive_path, const char *output_
         }
     }
 
-    io_buffer_t buffer = {0};
+    /* Los directorios se crean antes de repartir: create_directory no es segura entre hilos */
     for (size_t i = 0; status == 0 && i < file_count; ++i) {
-        status = extract_archive_entry(in, output_dir, &buffer);
+        char full_path[MAX_PATH_LENGTH];
+        if (snprintf(full_path, sizeof(full_path), "%s/%s", output_dir, entries[i].relative) >=
+            (int)sizeof(full_path)) {
+            fprintf(stderr, "Error: la ruta destino es demasiado larga.\n");
+            status = -1;
+        } else if (ensure_parent_directory(full_path) != 0) {
+            fprintf(stderr, "Error: no se pudo crear directorio para '%s'.\n", full_path);
+            status = -1;
+        }
+    }
+
+    FileList list = {0};
+    if (status == 0 && file_count > 0) {
+        qsort(entries, file_count, sizeof(archive_entry_ref_t), compare_entry_refs_by_size);
+        list.paths = (char **)malloc(file_count * sizeof(char *));
+        list.sizes = (off_t *)malloc(file_count * sizeof(off_t));
+        if (!list.paths || !list.sizes) {
+            fprintf(stderr, "Error: sin memoria para las entradas del archive.\n");
+            status = -1;
+        } else {
+            for (size_t i = 0; i < file_count; ++i) {
+                list.paths[i] = entries[i].relative;
+                list.sizes[i] = (off_t)entries[i].size;
+            }
+            list.count = file_count;
+        }
+    }
+
+    if (status == 0 && list.count > 0) {
+        archive_extract_context_t ctx = {
+            fileno(in), output_dir, entries, config->durability == DURABILITY_PER_FILE
+        };
+        int failed = run_file_pool(config, &list, extract_archive_entry, &ctx);
+        if (failed != 0) {
+            fprintf(stderr, "Error: %d entradas no se pudieron extraer\n", failed);
+            status = -1;
+        }
     }
 
     if (status == 0) {
         printf("Archive extraído en '%s'\n", output_dir);
     }
 
+    // Las rutas pertenecen a las entradas: la lista solo se libera por fuera
+    free(list.paths);
+    free(list.sizes);
+    for (size_t i = 0; i < scanned; ++i) {
+        free(entries[i].relative);
+    }
+    free(entries);
     fclose(in);
     return status;
 }
@@ -417,44 +648,372 @@ int is_gsea_archive_file(const char *file_path) {
         return 0;
     }
 
-    return (memcmp(header, ARCHIVE_MAGIC, ARCHIVE_HEADER_SIZE) == 0);
+    return archive_magic_kind(header) >= 0;
+}
+
+/*
+ * Directorio → archive en streaming: los encabezados y el contenido de cada
+ * archivo se entregan al pipeline (compresión y/o encriptación) a medida que
+ * se leen, sin materializar el archive sin comprimir en disco.
+ */
+static int stream_archive_bytes(pipeline_writer_t *writer, const void *data, size_t size,
+                                const char *what) {
+    if (pipeline_writer_write(writer, (const unsigned char *)data, size) != 0) {
+        fprintf(stderr, "Error: no se pudo escribir %s en el archive.\n", what);
+        return -1;
+    }
+    return 0;
+}
+
+static int stream_archive_entry(pipeline_writer_t *writer, const char *base_dir,
+                                const char *absolute_path, io_buffer_t *buffer) {
+    const char *relative = compute_relative_path(base_dir, absolute_path);
+    size_t path_len = strlen(relative);
+
+    int fd = open(absolute_path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error: no se pudo abrir '%s' - %s\n", absolute_path, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    size_t file_size = (size_t)st.st_size;
+    int status = stream_archive_bytes(writer, &path_len, sizeof(size_t), "la longitud de la ruta");
+    if (status == 0) {
+        status = stream_archive_bytes(writer, relative, path_len, "la ruta");
+    }
+    if (status == 0) {
+        status = stream_archive_bytes(writer, &file_size, sizeof(size_t), "el tamaño");
+    }
+
+    size_t remaining = file_size;
+    while (status == 0 && remaining > 0) {
+        size_t request = remaining < sizeof(buffer->data) ? remaining : sizeof(buffer->data);
+        ssize_t got = read(fd, buffer->data, request);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            /* El tamaño ya está en el encabezado: un archivo que encoge no puede completarse */
+            fprintf(stderr, "Error: no se pudo leer '%s' completo - %s\n", absolute_path,
+                    got == 0 ? "el archivo cambió de tamaño" : strerror(errno));
+            status = -1;
+            break;
+        }
+        status = stream_archive_bytes(writer, buffer->data, (size_t)got, "datos");
+        remaining -= (size_t)got;
+    }
+    close(fd);
+
+    if (status == 0) {
+        printf("  + Añadido '%s' (%zu bytes)\n", relative, file_size);
+    }
+    return status;
+}
+
+static int stream_archive_reference(pipeline_writer_t *writer, const char *base_dir,
+                                    const char *absolute_path, size_t original) {
+    const char *relative = compute_relative_path(base_dir, absolute_path);
+    size_t path_len = strlen(relative);
+    size_t marker = ARCHIVE_ENTRY_REFERENCE;
+
+    int status = stream_archive_bytes(writer, &path_len, sizeof(size_t), "la longitud de la ruta");
+    if (status == 0) {
+        status = stream_archive_bytes(writer, relative, path_len, "la ruta");
+    }
+    if (status == 0) {
+        status = stream_archive_bytes(writer, &marker, sizeof(size_t), "la referencia");
+    }
+    if (status == 0) {
+        status = stream_archive_bytes(writer, &original, sizeof(size_t), "la referencia");
+    }
+    if (status == 0) {
+        printf("  = Duplicado '%s' (mismo contenido que la entrada %zu)\n", relative, original);
+    }
+    return status;
 }
 
 static int process_directory_with_pipeline(const program_config_t *config,
                                            const char *output_path) {
-    char temp_path[MAX_PATH_LENGTH];
-    if (create_temp_archive_file(temp_path, sizeof(temp_path)) != 0) {
+    if (config->archive_format == ARCHIVE_FORMAT_V2) {
+        return create_archive_v2(config, output_path);
+    }
+
+    FileList list = {0};
+    read_directory_parallel(config->input_path, &list, config->num_threads);
+    if (list.count == 0) {
+        fprintf(stderr, "Error: el directorio '%s' está vacío o no se pudo leer.\n", config->input_path);
+        free_file_list(&list);
         return -1;
     }
 
-    if (create_directory_archive_file(config->input_path, temp_path) != 0) {
-        unlink(temp_path);
+    // Los archivos idénticos no vuelven a pasar por el pipeline
+    dedup_plan_t plan;
+    if (dedup_plan_files(&list, &plan) != 0) {
+        fprintf(stderr, "Error: sin memoria para deduplicar el directorio.\n");
+        free_file_list(&list);
         return -1;
     }
 
-    int result = execute_file_pipeline(config, temp_path, output_path);
-    unlink(temp_path);
-    return result;
+    pipeline_writer_t *writer = pipeline_writer_open(config, output_path);
+    if (!writer) {
+        dedup_plan_free(&plan);
+        free_file_list(&list);
+        return -1;
+    }
+
+    io_buffer_t *buffer = (io_buffer_t *)malloc(sizeof(io_buffer_t));
+    int status = buffer ? 0 : -1;
+    if (status == 0) {
+        status = stream_archive_bytes(writer, archive_magic(&plan), ARCHIVE_HEADER_SIZE, "el encabezado");
+    }
+    if (status == 0) {
+        status = stream_archive_bytes(writer, &list.count, sizeof(size_t), "el número de archivos");
+    }
+    for (size_t i = 0; status == 0 && i < list.count; ++i) {
+        if (plan.original_of[i] != i) {
+            status = stream_archive_reference(writer, config->input_path, list.paths[i], plan.original_of[i]);
+        } else {
+            status = stream_archive_entry(writer, config->input_path, list.paths[i], buffer);
+        }
+    }
+
+    if (pipeline_writer_close(writer, status == 0) != 0) {
+        status = -1;
+    }
+    if (status == 0) {
+        dedup_report(&plan);
+        printf("Archive generado en '%s'\n", output_path);
+    } else {
+        unlink(output_path);
+    }
+
+    free(buffer);
+    dedup_plan_free(&plan);
+    free_file_list(&list);
+    return status;
 }
 
-static int process_archive_to_directory(const program_config_t *config,
-                                        const char *output_path) {
+static int read_stream_exact(pipeline_reader_t *reader, void *data, size_t size, const char *what) {
+    ssize_t got = pipeline_reader_read(reader, (unsigned char *)data, size);
+    if (got != (ssize_t)size) {
+        if (got >= 0) {
+            fprintf(stderr, "Error: fin inesperado del archive leyendo %s.\n", what);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/* Un duplicado se restaura copiando el archivo ya extraído de su original */
+static int copy_extracted_duplicate(const char *source_path, const char *full_path, int sync_to_disk) {
+    int in_fd = open(source_path, O_RDONLY);
+    struct stat st;
+    if (in_fd == -1 || fstat(in_fd, &st) != 0) {
+        fprintf(stderr, "Error: no se pudo abrir '%s' - %s\n", source_path, strerror(errno));
+        if (in_fd != -1) {
+            close(in_fd);
+        }
+        return -1;
+    }
+
+    int out_fd = open(full_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd == -1) {
+        fprintf(stderr, "Error: no se pudo crear '%s' - %s\n", full_path, strerror(errno));
+        close(in_fd);
+        return -1;
+    }
+
+    off_t in_offset = 0;
+    int status = 0;
+    if (st.st_size > 0 && copy_file_region_sparse(in_fd, &in_offset, out_fd, (size_t)st.st_size) != 0) {
+        fprintf(stderr, "Error: no se pudo copiar '%s' a '%s'\n", source_path, full_path);
+        status = -1;
+    }
+    if (status == 0 && sync_to_disk) {
+        sync_file_descriptor(out_fd, full_path);
+    }
+    close(out_fd);
+    close(in_fd);
+    return status;
+}
+
+/* Extrae una entrada del stream; los bloques a cero quedan como huecos */
+static int stream_extract_entry(pipeline_reader_t *reader, const char *output_dir,
+                                io_buffer_t *buffer, int sync_to_disk, int references,
+                                char **extracted, size_t index) {
+    size_t path_len = 0;
+    if (read_stream_exact(reader, &path_len, sizeof(size_t), "la longitud de la ruta") != 0) {
+        return -1;
+    }
+    if (path_len == 0 || path_len >= MAX_PATH_LENGTH) {
+        fprintf(stderr, "Error: ruta inválida dentro del archive.\n");
+        return -1;
+    }
+
+    char relative[MAX_PATH_LENGTH];
+    size_t file_size = 0;
+    if (read_stream_exact(reader, relative, path_len, "la ruta") != 0 ||
+        read_stream_exact(reader, &file_size, sizeof(size_t), "el tamaño") != 0) {
+        return -1;
+    }
+    relative[path_len] = '\0';
+
+    char full_path[MAX_PATH_LENGTH];
+    if (snprintf(full_path, sizeof(full_path), "%s/%s", output_dir, relative) >= (int)sizeof(full_path)) {
+        fprintf(stderr, "Error: la ruta destino es demasiado larga.\n");
+        return -1;
+    }
+    if (ensure_parent_directory(full_path) != 0) {
+        fprintf(stderr, "Error: no se pudo crear directorio para '%s'.\n", full_path);
+        return -1;
+    }
+    extracted[index] = strdup(relative);
+    if (!extracted[index]) {
+        fprintf(stderr, "Error: sin memoria para ruta del archivo dentro del archive.\n");
+        return -1;
+    }
+
+    if (file_size == ARCHIVE_ENTRY_REFERENCE) {
+        size_t original = 0;
+        if (read_stream_exact(reader, &original, sizeof(size_t), "la referencia") != 0) {
+            return -1;
+        }
+        if (!references || original >= index) {
+            fprintf(stderr, "Error: referencia inválida en la entrada '%s'.\n", relative);
+            return -1;
+        }
+        char source_path[MAX_PATH_LENGTH];
+        snprintf(source_path, sizeof(source_path), "%s/%s", output_dir, extracted[original]);
+        if (copy_extracted_duplicate(source_path, full_path, sync_to_disk) != 0) {
+            return -1;
+        }
+        printf("  = Duplicado '%s' restaurado desde '%s'\n", relative, extracted[original]);
+        return 0;
+    }
+
+    int out_fd = open(full_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd == -1) {
+        fprintf(stderr, "Error: no se pudo crear '%s' - %s\n", full_path, strerror(errno));
+        return -1;
+    }
+
+    int status = 0;
+    size_t remaining = file_size;
+    while (status == 0 && remaining > 0) {
+        size_t request = remaining < sizeof(buffer->data) ? remaining : sizeof(buffer->data);
+        status = read_stream_exact(reader, buffer->data, request, "datos");
+        if (status != 0) {
+            break;
+        }
+        if (buffer->data[0] == 0 && memcmp(buffer->data, buffer->data + 1, request - 1) == 0) {
+            status = lseek(out_fd, (off_t)request, SEEK_CUR) == (off_t)-1 ? -1 : 0;
+        } else if (write_full(out_fd, buffer->data, request) != 0) {
+            fprintf(stderr, "Error: no se pudo escribir '%s' - %s\n", full_path, strerror(errno));
+            status = -1;
+        }
+        remaining -= request;
+    }
+
+    /* Un archivo que termina en ceros necesita su tamaño final explícito */
+    if (status == 0 && ftruncate(out_fd, (off_t)file_size) != 0) {
+        fprintf(stderr, "Error: no se pudo ajustar el tamaño de '%s' - %s\n", full_path, strerror(errno));
+        status = -1;
+    }
+    if (status == 0 && sync_to_disk) {
+        sync_file_descriptor(out_fd, full_path);
+    }
+    close(out_fd);
+
+    if (status == 0) {
+        printf("  + Extraído '%s' (%zu bytes)\n", relative, file_size);
+    }
+    return status;
+}
+
+/* Formato anterior a GSC1: se deshace a un archive temporal y se extrae de él */
+static int extract_legacy_stream(const program_config_t *config, const char *output_path) {
     char temp_path[MAX_PATH_LENGTH];
     if (create_temp_archive_file(temp_path, sizeof(temp_path)) != 0) {
         return -1;
     }
 
     int result = execute_file_pipeline(config, config->input_path, temp_path);
-    if (result != 0) {
-        unlink(temp_path);
-        return result;
+    if (result == 0) {
+        result = extract_archive_with_policy(config, temp_path, output_path);
     }
-
-    result = extract_directory_archive_file(temp_path, output_path);
     unlink(temp_path);
     return result;
 }
 
+static int process_archive_to_directory(const program_config_t *config,
+                                        const char *output_path) {
+    // Un archive v2 guarda cada entrada por separado: no hay stream global que deshacer
+    if (is_archive_v2_file(config->input_path)) {
+        return extract_archive_v2(config, config->input_path, output_path);
+    }
+
+    pipeline_reader_t *reader = NULL;
+    int rc = pipeline_reader_open(config, config->input_path, &reader);
+    if (rc == 1) {
+        return extract_legacy_stream(config, output_path);
+    }
+    if (rc != 0) {
+        return -1;
+    }
+
+    io_buffer_t *buffer = (io_buffer_t *)malloc(sizeof(io_buffer_t));
+    unsigned char header[ARCHIVE_HEADER_SIZE];
+    size_t file_count = 0;
+    int references = 0;
+    int status = buffer ? 0 : -1;
+    if (status == 0) {
+        status = read_stream_exact(reader, header, sizeof(header), "el encabezado");
+    }
+    if (status == 0 && (references = archive_magic_kind(header)) < 0) {
+        fprintf(stderr, "Error: el archivo no es un archive válido.\n");
+        status = -1;
+    }
+    if (status == 0) {
+        status = read_stream_exact(reader, &file_count, sizeof(size_t), "el número de archivos");
+    }
+    if (status == 0 && create_directory(output_path) != 0) {
+        fprintf(stderr, "Error: no se pudo preparar el directorio de salida '%s'.\n", output_path);
+        status = -1;
+    }
+
+    // Rutas ya extraídas: los duplicados se restauran desde su original
+    char **extracted = NULL;
+    if (status == 0 && file_count > 0) {
+        extracted = (char **)calloc(file_count, sizeof(char *));
+        if (!extracted) {
+            fprintf(stderr, "Error: sin memoria para las entradas del archive.\n");
+            status = -1;
+        }
+    }
+
+    for (size_t i = 0; status == 0 && i < file_count; ++i) {
+        status = stream_extract_entry(reader, output_path, buffer,
+                                      config->durability == DURABILITY_PER_FILE, references,
+                                      extracted, i);
+    }
+
+    if (status == 0) {
+        printf("Archive extraído en '%s'\n", output_path);
+    }
+
+    for (size_t i = 0; extracted != NULL && i < file_count; ++i) {
+        free(extracted[i]);
+    }
+    free(extracted);
+    pipeline_reader_close(reader);
+    free(buffer);
+    return status;
+}
+
 int compress_directory_only(const program_config_t *config, const char *output_path) {
     printf("Comprimiendo directorio: %s\n", config->input_path);
     return process_directory_with_pipeline(config, output_path);
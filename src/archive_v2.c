@@ -0,0 +1,2069 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/archive.h"
+#include "../include/concurrency.h"
+#include "../include/dedup.h"
+#include "../include/dir_utils.h"
+#include "../include/file_manager.h"
+#include "../include/operations.h"
+
+/*
+ * Archive v2: cada archivo se procesa por separado (comprimido y/o encriptado)
+ * por el pool de hilos y su resultado se añade al archive en cuanto termina.
+ * Al final se escribe un directorio central con la posición, el codec y el
+ * CRC32 del contenido original de cada entrada:
+ *
+ *   "GSEAARCHv2" | u8 operaciones | u8 alg_compresión | u8 alg_encriptación | u8 flags
+ *   datos de las entradas y bloques, en orden de finalización
+ *   "GSDR" | u32 count | count × (u16 len_ruta, ruta, u64 offset, u64 tamaño_almacenado,
+ *                                  u64 tamaño_original, u8 operaciones, u8 alg_compresión,
+ *                                  u8 alg_encriptación, u8 flags_entrada, u32 crc32
+ *                                  [, u32 bloque si flags_entrada & SOLID]
+ *                                  [, u32 n, n × u32 id_chunk si flags_entrada & CHUNKED])
+ *   ["GSBK" | u32 bloques | bloques × (u64 offset, u64 tamaño_almacenado, u64 tamaño_original)
+ *    si flags & (SOLID | CHUNKS)]
+ *   ["GSCH" | u32 chunks | chunks × (u32 bloque, u32 offset_en_bloque, u32 tamaño) si flags & CHUNKS]
+ *   u64 offset_directorio | u32 count | "GSDE"
+ *
+ * Con --solid, los archivos pequeños se concatenan en bloques sólidos de hasta
+ * un chunk que se procesan como una sola unidad con el codec del encabezado;
+ * sus entradas guardan el bloque y en offset la posición dentro del bloque ya
+ * deshecho (tamaño_almacenado 0). Los archivos grandes siguen teniendo su
+ * propio stream.
+ *
+ * Los archivos con contenido idéntico se procesan y guardan una sola vez: el
+ * duplicado repite en el directorio la ubicación de su original (flag DUPLICATE).
+ *
+ * Con --dedup-chunks, cada archivo se corta en chunks definidos por contenido
+ * (FastCDC) y la entrada guarda la lista de sus chunks. Cada chunk distinto se
+ * guarda una sola vez: los únicos se concatenan en bloques de hasta un chunk
+ * del stream que se procesan como los bloques sólidos, de modo que las
+ * regiones repetidas entre archivos se comprimen y escriben una sola vez.
+ *
+ * Todos los enteros en little-endian. Listar o extraer unas pocas entradas
+ * solo lee el trailer, el directorio y los rangos de esas entradas o bloques.
+ */
+#define ARCHIVE_V2_MAGIC "GSEAARCHv2"
+#define ARCHIVE_V2_MAGIC_SIZE 10
+#define ARCHIVE_V2_HEADER_SIZE 14
+#define ARCHIVE_V2_DIR_MAGIC "GSDR"
+#define ARCHIVE_V2_BLOCKS_MAGIC "GSBK"
+#define ARCHIVE_V2_CHUNKS_MAGIC "GSCH"
+#define ARCHIVE_V2_END_MAGIC "GSDE"
+#define ARCHIVE_V2_TRAILER_SIZE 16
+#define ARCHIVE_V2_ENTRY_FIXED_SIZE 34
+#define ARCHIVE_V2_ENTRY_BLOCK_SIZE 4
+#define ARCHIVE_V2_BLOCK_RECORD_SIZE 24
+#define ARCHIVE_V2_CHUNK_RECORD_SIZE 12
+#define ARCHIVE_V2_CDC_BUFFER_SIZE (4 * CDC_MAX_CHUNK)
+#define ARCHIVE_V2_CRC_BUFFER_SIZE (64 * 1024)
+#define ARCHIVE_V2_IO_BUFFER_SIZE (1024 * 1024)
+#define ARCHIVE_V2_FLAG_SOLID 0x01          // Encabezado: hay tabla de bloques sólidos
+#define ARCHIVE_V2_FLAG_CHUNKS 0x02         // Encabezado: hay tabla de chunks deduplicados
+#define ARCHIVE_V2_HEADER_FLAGS (ARCHIVE_V2_FLAG_SOLID | ARCHIVE_V2_FLAG_CHUNKS)
+#define ARCHIVE_V2_ENTRY_SOLID 0x01         // Entrada: vive dentro de un bloque sólido
+#define ARCHIVE_V2_ENTRY_DUPLICATE 0x02     // Entrada: comparte los datos de otra idéntica
+#define ARCHIVE_V2_ENTRY_CHUNKED 0x04       // Entrada: lista de chunks deduplicados
+#define ARCHIVE_V2_ENTRY_FLAGS (ARCHIVE_V2_ENTRY_SOLID | ARCHIVE_V2_ENTRY_DUPLICATE | ARCHIVE_V2_ENTRY_CHUNKED)
+#define ARCHIVE_V2_SOLID_MAX_FILE (64 * 1024)   // Mayor archivo que se empaqueta en bloques
+
+typedef struct {
+    char *path;                 // Ruta relativa dentro del archive
+    uint64_t offset;            // En el archive, o dentro del bloque si es sólida
+    uint64_t stored_size;
+    uint64_t original_size;
+    unsigned char operations;   // OP_COMPRESS / OP_ENCRYPT aplicados a la entrada
+    unsigned char comp_alg;
+    unsigned char enc_alg;
+    unsigned char flags;        // ARCHIVE_V2_ENTRY_*
+    uint32_t block;
+    uint32_t crc32;             // CRC32 del contenido original
+    uint32_t *chunks;           // Ids de chunk en orden (entradas CHUNKED)
+    uint32_t chunk_count;
+} archive_v2_entry_t;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t stored_size;
+    uint64_t original_size;
+    size_t first;               // Al crear: primera entrada del bloque
+    size_t count;               // Al crear: entradas del bloque
+    uint64_t source_offset;     // Al crear con chunks: inicio en el almacén temporal
+} archive_v2_block_t;
+
+typedef struct {
+    uint32_t block;
+    uint32_t offset;            // Dentro del bloque ya deshecho
+    uint32_t size;
+    uint64_t source_offset;     // Al crear: posición en el almacén temporal
+} archive_v2_chunk_t;
+
+/* Directorio central leído de un archive */
+typedef struct {
+    unsigned char operations;   // Codec del encabezado, el de los bloques sólidos
+    unsigned char comp_alg;
+    unsigned char enc_alg;
+    archive_v2_entry_t *entries;
+    size_t count;
+    archive_v2_block_t *blocks;
+    size_t block_count;
+    archive_v2_chunk_t *chunks;
+    size_t chunk_count;
+} archive_v2_directory_t;
+
+/* Unidad de trabajo del pool: una entrada con stream propio o un bloque sólido */
+typedef struct {
+    archive_v2_entry_t *entry;
+    archive_v2_block_t *block;
+    archive_v2_entry_t **members;       // Al extraer: entradas elegidas del bloque
+    size_t member_count;
+    uint64_t size;                      // Para repartir de mayor a menor
+} archive_v2_task_t;
+
+typedef struct {
+    const program_config_t *config;     // Pipeline de cada entrada
+    const char *archive_path;
+    int fd;
+    uint64_t offset;                    // Siguiente posición libre del archive
+    archive_v2_entry_t *entries;
+    size_t count;
+    char **sources;                     // Ruta de origen de cada entrada
+    size_t *original_of;                // Entrada cuyo contenido repite (ella misma si es única)
+    archive_v2_block_t *blocks;
+    size_t block_count;
+    size_t block_capacity;
+    archive_v2_task_t *tasks;
+    archive_v2_chunk_t *chunks;         // Chunks únicos (--dedup-chunks)
+    size_t chunk_count;
+    size_t chunk_capacity;
+    size_t chunk_refs;                  // Chunks cortados en total, repetidos incluidos
+    int store_fd;                       // Almacén temporal: los chunks únicos en orden
+    uint64_t store_size;
+    char temp_dir[MAX_PATH_LENGTH];
+    pthread_mutex_t mutex;
+} archive_v2_builder_t;
+
+static void store_u16_le(unsigned char *dst, uint16_t value) {
+    dst[0] = (unsigned char)(value & 0xFF);
+    dst[1] = (unsigned char)((value >> 8) & 0xFF);
+}
+
+static void store_u32_le(unsigned char *dst, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        dst[i] = (unsigned char)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static void store_u64_le(unsigned char *dst, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        dst[i] = (unsigned char)((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static uint32_t crc32_table[256];
+static pthread_once_t crc32_table_once = PTHREAD_ONCE_INIT;
+
+static void init_crc32_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; bit++) {
+            value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+        }
+        crc32_table[i] = value;
+    }
+}
+
+static uint32_t crc32_update(uint32_t crc, const unsigned char *data, size_t size) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = crc32_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t crc32_buffer(const unsigned char *data, size_t size) {
+    pthread_once(&crc32_table_once, init_crc32_table);
+    return crc32_update(0, data, size);
+}
+
+static const char *entry_codec_name(const archive_v2_entry_t *entry) {
+    static const char *names[2][4] = {
+        {"ninguno", "rle", "huffman", "lzw"},
+        {"vigenere", "rle+vigenere", "huffman+vigenere", "lzw+vigenere"}
+    };
+    int comp = (entry->operations & OP_COMPRESS) ? entry->comp_alg : 0;
+    return names[(entry->operations & OP_ENCRYPT) ? 1 : 0][comp];
+}
+
+static uint16_t load_u16_le(const unsigned char *src) {
+    return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static uint32_t load_u32_le(const unsigned char *src) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+static uint64_t load_u64_le(const unsigned char *src) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+static int write_all_fd(int fd, const unsigned char *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+static int read_exact_at_fd(int fd, unsigned char *buffer, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t got = pread(fd, buffer, size, offset);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (got == 0) {
+            return -1;
+        }
+        buffer += got;
+        size -= (size_t)got;
+        offset += got;
+    }
+    return 0;
+}
+
+static const char *relative_to(const char *base, const char *path) {
+    size_t base_len = strlen(base);
+    while (base_len > 1 && base[base_len - 1] == '/') {
+        base_len--;
+    }
+    if (strncmp(base, path, base_len) == 0 && path[base_len] == '/') {
+        path += base_len;
+        while (*path == '/') {
+            path++;
+        }
+    }
+    return path;
+}
+
+/* Rechaza rutas absolutas o con componentes ".." que escaparían del destino */
+static int is_safe_entry_path(const char *path) {
+    if (path[0] == '\0' || path[0] == '/') {
+        return 0;
+    }
+    const char *component = path;
+    while (component != NULL) {
+        if (strncmp(component, "..", 2) == 0 && (component[2] == '/' || component[2] == '\0')) {
+            return 0;
+        }
+        component = strchr(component, '/');
+        if (component != NULL) {
+            component++;
+        }
+    }
+    return 1;
+}
+
+static int ensure_entry_parent(const char *path) {
+    char parent[MAX_PATH_LENGTH];
+    snprintf(parent, sizeof(parent), "%s", path);
+    char *slash = strrchr(parent, '/');
+    if (slash == NULL || slash == parent) {
+        return 0;
+    }
+    *slash = '\0';
+    return create_directory(parent);
+}
+
+int is_archive_v2_file(const char *file_path) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+
+    unsigned char magic[ARCHIVE_V2_MAGIC_SIZE];
+    int matches = read_exact_at_fd(fd, magic, sizeof(magic), 0) == 0 &&
+                  memcmp(magic, ARCHIVE_V2_MAGIC, ARCHIVE_V2_MAGIC_SIZE) == 0;
+    close(fd);
+    return matches;
+}
+
+/* Añade al archive el resultado de una tarea; las partes quedan en orden de finalización */
+static int append_archive_v2_part(archive_v2_builder_t *builder, const char *temp_path,
+                                  uint64_t *offset_out, uint64_t *stored_out) {
+    int temp_fd = open(temp_path, O_RDONLY);
+    struct stat st;
+    if (temp_fd == -1 || fstat(temp_fd, &st) != 0) {
+        fprintf(stderr, "Error: No se pudo abrir el resultado '%s' - %s\n", temp_path, strerror(errno));
+        if (temp_fd != -1) {
+            close(temp_fd);
+        }
+        return -1;
+    }
+
+    pthread_mutex_lock(&builder->mutex);
+    off_t in_offset = 0;
+    int status = copy_file_region(temp_fd, &in_offset, builder->fd, (size_t)st.st_size);
+    if (status == 0) {
+        *offset_out = builder->offset;
+        *stored_out = (uint64_t)st.st_size;
+        builder->offset += (uint64_t)st.st_size;
+    }
+    pthread_mutex_unlock(&builder->mutex);
+
+    close(temp_fd);
+    if (status != 0) {
+        fprintf(stderr, "Error: No se pudo añadir '%s' al archive '%s'\n", temp_path, builder->archive_path);
+    }
+    return status;
+}
+
+static void record_entry_codec(const archive_v2_builder_t *builder, archive_v2_entry_t *entry) {
+    entry->operations = (unsigned char)(builder->config->operations & (OP_COMPRESS | OP_ENCRYPT));
+    entry->comp_alg = (unsigned char)builder->config->comp_alg;
+    entry->enc_alg = (unsigned char)builder->config->enc_alg;
+}
+
+/* Procesa una entrada con stream propio a un temporal y la añade al archive */
+static int add_archive_v2_entry(archive_v2_builder_t *builder, archive_v2_entry_t *entry,
+                                const char *path, size_t index) {
+    char temp_path[MAX_PATH_LENGTH];
+    if (snprintf(temp_path, sizeof(temp_path), "%s/%zu", builder->temp_dir, index) >= (int)sizeof(temp_path)) {
+        fprintf(stderr, "Error: ruta temporal demasiado larga para '%s'\n", entry->path);
+        return -1;
+    }
+
+    record_entry_codec(builder, entry);
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error: No se pudo leer '%s' - %s\n", path, strerror(errno));
+        return -1;
+    }
+    unsigned char *buffer = (unsigned char *)malloc(ARCHIVE_V2_CRC_BUFFER_SIZE);
+    pipeline_writer_t *writer = buffer ? pipeline_writer_open(builder->config, temp_path) : NULL;
+    if (!writer) {
+        fprintf(stderr, "Error: Falló el procesamiento de la entrada '%s'\n", entry->path);
+        free(buffer);
+        close(fd);
+        return -1;
+    }
+
+    /* Una sola lectura alimenta el CRC32 y el pipeline: ambos ven los mismos bytes */
+    pthread_once(&crc32_table_once, init_crc32_table);
+    uint32_t crc = 0;
+    uint64_t copied = 0;
+    int status = 0;
+    for (;;) {
+        ssize_t got = read(fd, buffer, ARCHIVE_V2_CRC_BUFFER_SIZE);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error: No se pudo leer '%s' - %s\n", path, strerror(errno));
+            status = -1;
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        copied += (uint64_t)got;
+        if (copied > entry->original_size) {
+            break;
+        }
+        crc = crc32_update(crc, buffer, (size_t)got);
+        if (pipeline_writer_write(writer, buffer, (size_t)got) != 0) {
+            status = -1;
+            break;
+        }
+    }
+    close(fd);
+    free(buffer);
+
+    /* El directorio guarda el tamaño leído al planificar */
+    if (status == 0 && copied != entry->original_size) {
+        fprintf(stderr, "Error: '%s' cambió de tamaño durante el archivado\n", path);
+        status = -1;
+    }
+    if (pipeline_writer_close(writer, status == 0) != 0 || status != 0) {
+        fprintf(stderr, "Error: Falló el procesamiento de la entrada '%s'\n", entry->path);
+        unlink(temp_path);
+        return -1;
+    }
+    entry->crc32 = crc;
+
+    status = append_archive_v2_part(builder, temp_path, &entry->offset, &entry->stored_size);
+    unlink(temp_path);
+    if (status != 0) {
+        return -1;
+    }
+    printf("  + Añadido '%s' (%llu → %llu bytes)\n", entry->path,
+           (unsigned long long)entry->original_size, (unsigned long long)entry->stored_size);
+    return 0;
+}
+
+/* Copia un archivo pequeño al final del bloque en construcción calculando su CRC32 */
+static int append_solid_member(const char *source, int block_fd, unsigned char *buffer,
+                               archive_v2_entry_t *entry) {
+    int fd = open(source, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error: No se pudo leer '%s' - %s\n", source, strerror(errno));
+        return -1;
+    }
+
+    uint32_t crc = 0;
+    uint64_t copied = 0;
+    int status = 0;
+    for (;;) {
+        ssize_t got = read(fd, buffer, ARCHIVE_V2_CRC_BUFFER_SIZE);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error: No se pudo leer '%s' - %s\n", source, strerror(errno));
+            status = -1;
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        copied += (uint64_t)got;
+        if (copied > entry->original_size) {
+            break;
+        }
+        crc = crc32_update(crc, buffer, (size_t)got);
+        if (write_all_fd(block_fd, buffer, (size_t)got) != 0) {
+            fprintf(stderr, "Error: No se pudo escribir el bloque sólido - %s\n", strerror(errno));
+            status = -1;
+            break;
+        }
+    }
+    close(fd);
+
+    /* El directorio ya reservó el hueco del archivo dentro del bloque */
+    if (status == 0 && copied != entry->original_size) {
+        fprintf(stderr, "Error: '%s' cambió de tamaño durante el archivado\n", source);
+        status = -1;
+    }
+    entry->crc32 = crc;
+    return status;
+}
+
+/* Concatena los archivos pequeños del bloque y lo procesa como una sola unidad */
+static int add_archive_v2_block(archive_v2_builder_t *builder, archive_v2_block_t *block, size_t index) {
+    char raw_path[MAX_PATH_LENGTH];
+    char temp_path[MAX_PATH_LENGTH];
+    if (snprintf(raw_path, sizeof(raw_path), "%s/%zu.raw", builder->temp_dir, index) >= (int)sizeof(raw_path) ||
+        snprintf(temp_path, sizeof(temp_path), "%s/%zu", builder->temp_dir, index) >= (int)sizeof(temp_path)) {
+        fprintf(stderr, "Error: ruta temporal demasiado larga para el bloque sólido\n");
+        return -1;
+    }
+
+    pthread_once(&crc32_table_once, init_crc32_table);
+    int raw_fd = open(raw_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    unsigned char *buffer = (unsigned char *)malloc(ARCHIVE_V2_CRC_BUFFER_SIZE);
+    int status = 0;
+    if (raw_fd == -1 || !buffer) {
+        fprintf(stderr, "Error: no se pudo preparar el bloque sólido - %s\n", strerror(errno));
+        status = -1;
+    }
+
+    /* Los miembros siguen el orden de las entradas, intercalados con duplicados */
+    uint32_t block_index = (uint32_t)(block - builder->blocks);
+    uint64_t position = 0;
+    size_t added = 0;
+    for (size_t i = block->first; status == 0 && added < block->count; i++) {
+        archive_v2_entry_t *entry = &builder->entries[i];
+        if (!(entry->flags & ARCHIVE_V2_ENTRY_SOLID) || entry->block != block_index) {
+            continue;
+        }
+        entry->offset = position;
+        record_entry_codec(builder, entry);
+        status = append_solid_member(builder->sources[i], raw_fd, buffer, entry);
+        position += entry->original_size;
+        added++;
+    }
+    free(buffer);
+    if (raw_fd != -1) {
+        close(raw_fd);
+    }
+
+    if (status == 0 && execute_file_pipeline(builder->config, raw_path, temp_path) != 0) {
+        fprintf(stderr, "Error: Falló el procesamiento del bloque sólido de '%s'\n",
+                builder->entries[block->first].path);
+        status = -1;
+    }
+    unlink(raw_path);
+
+    if (status == 0) {
+        status = append_archive_v2_part(builder, temp_path, &block->offset, &block->stored_size);
+    }
+    unlink(temp_path);
+    if (status != 0) {
+        return -1;
+    }
+    printf("  + Bloque sólido con %zu archivos (%llu → %llu bytes)\n", block->count,
+           (unsigned long long)block->original_size, (unsigned long long)block->stored_size);
+    return 0;
+}
+
+/* Procesa un bloque de chunks únicos leyéndolo del almacén temporal */
+static int add_archive_v2_chunk_block(archive_v2_builder_t *builder, archive_v2_block_t *block, size_t index) {
+    char temp_path[MAX_PATH_LENGTH];
+    if (snprintf(temp_path, sizeof(temp_path), "%s/%zu", builder->temp_dir, index) >= (int)sizeof(temp_path)) {
+        fprintf(stderr, "Error: ruta temporal demasiado larga para el bloque de chunks\n");
+        return -1;
+    }
+
+    unsigned char *buffer = (unsigned char *)malloc(ARCHIVE_V2_CRC_BUFFER_SIZE);
+    pipeline_writer_t *writer = buffer ? pipeline_writer_open(builder->config, temp_path) : NULL;
+    if (!writer) {
+        fprintf(stderr, "Error: no se pudo preparar el bloque de chunks\n");
+        free(buffer);
+        return -1;
+    }
+
+    int status = 0;
+    uint64_t done = 0;
+    while (status == 0 && done < block->original_size) {
+        size_t piece = block->original_size - done < ARCHIVE_V2_CRC_BUFFER_SIZE ?
+                       (size_t)(block->original_size - done) : ARCHIVE_V2_CRC_BUFFER_SIZE;
+        if (read_exact_at_fd(builder->store_fd, buffer, piece, (off_t)(block->source_offset + done)) != 0 ||
+            pipeline_writer_write(writer, buffer, piece) != 0) {
+            status = -1;
+        }
+        done += piece;
+    }
+    if (pipeline_writer_close(writer, status == 0) != 0) {
+        status = -1;
+    }
+    free(buffer);
+    if (status != 0) {
+        fprintf(stderr, "Error: Falló el procesamiento de un bloque de chunks\n");
+        unlink(temp_path);
+        return -1;
+    }
+
+    status = append_archive_v2_part(builder, temp_path, &block->offset, &block->stored_size);
+    unlink(temp_path);
+    if (status != 0) {
+        return -1;
+    }
+    printf("  + Bloque con %zu chunks únicos (%llu → %llu bytes)\n", block->count,
+           (unsigned long long)block->original_size, (unsigned long long)block->stored_size);
+    return 0;
+}
+
+/* Tarea del pool al crear: una entrada grande o un bloque de archivos pequeños o de chunks */
+static int add_archive_v2_task(void *context, const char *path, size_t index) {
+    archive_v2_builder_t *builder = (archive_v2_builder_t *)context;
+    archive_v2_task_t *task = &builder->tasks[index];
+    if (task->block != NULL && builder->store_fd != -1) {
+        return add_archive_v2_chunk_block(builder, task->block, index);
+    }
+    if (task->block != NULL) {
+        return add_archive_v2_block(builder, task->block, index);
+    }
+    return add_archive_v2_entry(builder, task->entry, path, index);
+}
+
+static int write_archive_v2_header(int fd, const program_config_t *config) {
+    unsigned char header[ARCHIVE_V2_HEADER_SIZE];
+    memcpy(header, ARCHIVE_V2_MAGIC, ARCHIVE_V2_MAGIC_SIZE);
+    header[10] = (unsigned char)(config->operations & (OP_COMPRESS | OP_ENCRYPT));
+    header[11] = (unsigned char)config->comp_alg;
+    header[12] = (unsigned char)config->enc_alg;
+    header[13] = (unsigned char)((config->solid_blocks ? ARCHIVE_V2_FLAG_SOLID : 0) |
+                                 (config->dedup_chunks ? ARCHIVE_V2_FLAG_CHUNKS : 0));
+    return write_all_fd(fd, header, sizeof(header));
+}
+
+static int write_archive_v2_directory(int fd, const archive_v2_builder_t *builder, unsigned char flags) {
+    size_t size = 8 + ARCHIVE_V2_TRAILER_SIZE;
+    for (size_t i = 0; i < builder->count; i++) {
+        size += ARCHIVE_V2_ENTRY_FIXED_SIZE + strlen(builder->entries[i].path);
+        if (builder->entries[i].flags & ARCHIVE_V2_ENTRY_SOLID) {
+            size += ARCHIVE_V2_ENTRY_BLOCK_SIZE;
+        }
+        if (builder->entries[i].flags & ARCHIVE_V2_ENTRY_CHUNKED) {
+            size += 4 + (size_t)builder->entries[i].chunk_count * 4;
+        }
+    }
+    if (flags & ARCHIVE_V2_HEADER_FLAGS) {
+        size += 8 + builder->block_count * ARCHIVE_V2_BLOCK_RECORD_SIZE;
+    }
+    if (flags & ARCHIVE_V2_FLAG_CHUNKS) {
+        size += 8 + builder->chunk_count * ARCHIVE_V2_CHUNK_RECORD_SIZE;
+    }
+
+    unsigned char *buffer = (unsigned char *)malloc(size);
+    if (!buffer) {
+        return -1;
+    }
+
+    unsigned char *ptr = buffer;
+    memcpy(ptr, ARCHIVE_V2_DIR_MAGIC, 4);
+    store_u32_le(ptr + 4, (uint32_t)builder->count);
+    ptr += 8;
+    for (size_t i = 0; i < builder->count; i++) {
+        const archive_v2_entry_t *entry = &builder->entries[i];
+        size_t path_len = strlen(entry->path);
+        store_u16_le(ptr, (uint16_t)path_len);
+        memcpy(ptr + 2, entry->path, path_len);
+        ptr += 2 + path_len;
+        store_u64_le(ptr, entry->offset);
+        store_u64_le(ptr + 8, entry->stored_size);
+        store_u64_le(ptr + 16, entry->original_size);
+        ptr[24] = entry->operations;
+        ptr[25] = entry->comp_alg;
+        ptr[26] = entry->enc_alg;
+        ptr[27] = entry->flags;
+        store_u32_le(ptr + 28, entry->crc32);
+        ptr += 32;
+        if (entry->flags & ARCHIVE_V2_ENTRY_SOLID) {
+            store_u32_le(ptr, entry->block);
+            ptr += ARCHIVE_V2_ENTRY_BLOCK_SIZE;
+        }
+        if (entry->flags & ARCHIVE_V2_ENTRY_CHUNKED) {
+            store_u32_le(ptr, entry->chunk_count);
+            ptr += 4;
+            for (uint32_t c = 0; c < entry->chunk_count; c++) {
+                store_u32_le(ptr, entry->chunks[c]);
+                ptr += 4;
+            }
+        }
+    }
+    if (flags & ARCHIVE_V2_HEADER_FLAGS) {
+        memcpy(ptr, ARCHIVE_V2_BLOCKS_MAGIC, 4);
+        store_u32_le(ptr + 4, (uint32_t)builder->block_count);
+        ptr += 8;
+        for (size_t i = 0; i < builder->block_count; i++) {
+            store_u64_le(ptr, builder->blocks[i].offset);
+            store_u64_le(ptr + 8, builder->blocks[i].stored_size);
+            store_u64_le(ptr + 16, builder->blocks[i].original_size);
+            ptr += ARCHIVE_V2_BLOCK_RECORD_SIZE;
+        }
+    }
+    if (flags & ARCHIVE_V2_FLAG_CHUNKS) {
+        memcpy(ptr, ARCHIVE_V2_CHUNKS_MAGIC, 4);
+        store_u32_le(ptr + 4, (uint32_t)builder->chunk_count);
+        ptr += 8;
+        for (size_t i = 0; i < builder->chunk_count; i++) {
+            store_u32_le(ptr, builder->chunks[i].block);
+            store_u32_le(ptr + 4, builder->chunks[i].offset);
+            store_u32_le(ptr + 8, builder->chunks[i].size);
+            ptr += ARCHIVE_V2_CHUNK_RECORD_SIZE;
+        }
+    }
+    store_u64_le(ptr, builder->offset);
+    store_u32_le(ptr + 8, (uint32_t)builder->count);
+    memcpy(ptr + 12, ARCHIVE_V2_END_MAGIC, 4);
+
+    int status = write_all_fd(fd, buffer, size);
+    free(buffer);
+    return status;
+}
+
+static int compare_tasks_by_size(const void *a, const void *b) {
+    const archive_v2_task_t *left = (const archive_v2_task_t *)a;
+    const archive_v2_task_t *right = (const archive_v2_task_t *)b;
+    if (left->size != right->size) {
+        return left->size > right->size ? -1 : 1;
+    }
+    return 0;
+}
+
+/*
+ * Reparte las entradas: con --solid, los archivos pequeños van primero, en el
+ * orden del recorrido (los de un mismo directorio suelen parecerse), agrupados
+ * en bloques de hasta un chunk; el resto tiene su propia tarea.
+ */
+static int plan_archive_v2(const program_config_t *config, const FileList *list,
+                           archive_v2_builder_t *builder) {
+    size_t block_limit = stream_chunk_size();
+    size_t solid_max = block_limit < ARCHIVE_V2_SOLID_MAX_FILE ? block_limit : ARCHIVE_V2_SOLID_MAX_FILE;
+
+    builder->entries = (archive_v2_entry_t *)calloc(list->count, sizeof(archive_v2_entry_t));
+    builder->sources = (char **)calloc(list->count, sizeof(char *));
+    builder->blocks = (archive_v2_block_t *)calloc(list->count, sizeof(archive_v2_block_t));
+    builder->block_capacity = list->count;
+    builder->original_of = (size_t *)calloc(list->count, sizeof(size_t));
+    size_t *entry_of = (size_t *)calloc(list->count, sizeof(size_t));
+    dedup_plan_t dedup;
+    if (!builder->entries || !builder->sources || !builder->blocks ||
+        !builder->original_of || !entry_of || dedup_plan_files(list, &dedup) != 0) {
+        fprintf(stderr, "Error: sin memoria para el directorio del archive.\n");
+        free(entry_of);
+        return -1;
+    }
+
+    /* Un duplicado tiene el mismo tamaño que su original: cae en la misma pasada, después */
+    int status = 0;
+    size_t next = 0;
+    for (int pass = 0; status == 0 && pass < 2; pass++) {
+        for (size_t i = 0; i < list->count; i++) {
+            int small = config->solid_blocks && (size_t)list->sizes[i] < solid_max;
+            if (small != (pass == 0)) {
+                continue;
+            }
+            const char *relative = relative_to(config->input_path, list->paths[i]);
+            if (strlen(relative) > UINT16_MAX) {
+                fprintf(stderr, "Error: ruta demasiado larga para el archive: '%s'\n", relative);
+                status = -1;
+                break;
+            }
+            archive_v2_entry_t *entry = &builder->entries[next];
+            entry->path = strdup(relative);
+            if (!entry->path) {
+                status = -1;
+                break;
+            }
+            entry->original_size = (uint64_t)list->sizes[i];
+            builder->sources[next] = list->paths[i];
+            builder->original_of[next] = next;
+            entry_of[i] = next;
+            builder->count = ++next;
+
+            if (dedup.original_of[i] != i) {
+                builder->original_of[next - 1] = entry_of[dedup.original_of[i]];
+                entry->flags = ARCHIVE_V2_ENTRY_DUPLICATE;
+                continue;
+            }
+            if (!small) {
+                continue;
+            }
+
+            archive_v2_block_t *block = builder->block_count > 0 ?
+                                        &builder->blocks[builder->block_count - 1] : NULL;
+            if (block == NULL || block->original_size + entry->original_size > block_limit) {
+                block = &builder->blocks[builder->block_count++];
+                block->first = next - 1;
+            }
+            entry->flags = ARCHIVE_V2_ENTRY_SOLID;
+            entry->block = (uint32_t)(block - builder->blocks);
+            block->count++;
+            block->original_size += entry->original_size;
+        }
+    }
+
+    if (status == 0) {
+        dedup_report(&dedup);
+    }
+    dedup_plan_free(&dedup);
+    free(entry_of);
+    return status;
+}
+
+/* Bloque abierto para el siguiente chunk único; se abre otro al superar un chunk del stream */
+static archive_v2_block_t *chunk_block_for(archive_v2_builder_t *builder, size_t entry_index, size_t size) {
+    archive_v2_block_t *block = builder->block_count > 0 ? &builder->blocks[builder->block_count - 1] : NULL;
+    if (block != NULL && block->original_size + size <= stream_chunk_size()) {
+        return block;
+    }
+    if (builder->block_count >= UINT32_MAX) {
+        return NULL;
+    }
+    if (builder->block_count == builder->block_capacity) {
+        size_t capacity = builder->block_capacity ? builder->block_capacity * 2 : 16;
+        archive_v2_block_t *blocks = (archive_v2_block_t *)realloc(builder->blocks, capacity * sizeof(*blocks));
+        if (!blocks) {
+            return NULL;
+        }
+        builder->blocks = blocks;
+        builder->block_capacity = capacity;
+    }
+    block = &builder->blocks[builder->block_count++];
+    memset(block, 0, sizeof(*block));
+    block->first = entry_index;
+    block->source_offset = builder->store_size;
+    return block;
+}
+
+/*
+ * Id del chunk con este contenido: si el índice tiene uno con el mismo hash se
+ * confirma byte a byte contra el almacén; si no, se añade como chunk único.
+ */
+static int store_archive_v2_chunk(archive_v2_builder_t *builder, dedup_index_t *index, size_t entry_index,
+                                  const unsigned char *data, size_t size, unsigned char *scratch,
+                                  uint32_t *id_out) {
+    uint64_t hash = dedup_hash64(data, size, 0);
+    size_t cursor = 0;
+    uint32_t id;
+    while ((id = dedup_index_find(index, hash, &cursor)) != UINT32_MAX) {
+        const archive_v2_chunk_t *chunk = &builder->chunks[id];
+        if (chunk->size == size &&
+            read_exact_at_fd(builder->store_fd, scratch, size, (off_t)chunk->source_offset) == 0 &&
+            memcmp(scratch, data, size) == 0) {
+            *id_out = id;
+            return 0;
+        }
+    }
+
+    if (builder->chunk_count >= UINT32_MAX - 1) {
+        fprintf(stderr, "Error: demasiados chunks para un archive v2.\n");
+        return -1;
+    }
+    if (builder->chunk_count == builder->chunk_capacity) {
+        size_t capacity = builder->chunk_capacity ? builder->chunk_capacity * 2 : 1024;
+        archive_v2_chunk_t *chunks = (archive_v2_chunk_t *)realloc(builder->chunks, capacity * sizeof(*chunks));
+        if (!chunks) {
+            return -1;
+        }
+        builder->chunks = chunks;
+        builder->chunk_capacity = capacity;
+    }
+    archive_v2_block_t *block = chunk_block_for(builder, entry_index, size);
+    if (!block) {
+        return -1;
+    }
+    if (write_all_fd(builder->store_fd, data, size) != 0) {
+        fprintf(stderr, "Error: no se pudo escribir el almacén de chunks - %s\n", strerror(errno));
+        return -1;
+    }
+
+    id = (uint32_t)builder->chunk_count;
+    archive_v2_chunk_t *chunk = &builder->chunks[builder->chunk_count++];
+    chunk->block = (uint32_t)(block - builder->blocks);
+    chunk->offset = (uint32_t)block->original_size;
+    chunk->size = (uint32_t)size;
+    chunk->source_offset = builder->store_size;
+    block->original_size += size;
+    block->count++;
+    builder->store_size += size;
+    *id_out = id;
+    return dedup_index_insert(index, hash, id);
+}
+
+/* Corta un archivo en chunks por contenido y registra la lista de ids en su entrada */
+static int chunk_archive_v2_entry(archive_v2_builder_t *builder, dedup_index_t *index, size_t entry_index,
+                                  unsigned char *buffer, unsigned char *scratch) {
+    archive_v2_entry_t *entry = &builder->entries[entry_index];
+    const char *source = builder->sources[entry_index];
+    int fd = open(source, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error: No se pudo leer '%s' - %s\n", source, strerror(errno));
+        return -1;
+    }
+
+    size_t capacity = 0;
+    size_t filled = 0;
+    size_t start = 0;
+    uint64_t total = 0;
+    uint32_t crc = 0;
+    int eof = 0;
+    int status = 0;
+    while (status == 0) {
+        /* Siempre hay un chunk máximo completo por delante, salvo al final del archivo */
+        if (!eof && filled - start < CDC_MAX_CHUNK) {
+            memmove(buffer, buffer + start, filled - start);
+            filled -= start;
+            start = 0;
+            ssize_t got = read(fd, buffer + filled, ARCHIVE_V2_CDC_BUFFER_SIZE - filled);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got < 0) {
+                fprintf(stderr, "Error: No se pudo leer '%s' - %s\n", source, strerror(errno));
+                status = -1;
+                break;
+            }
+            eof = got == 0;
+            filled += (size_t)got;
+            continue;
+        }
+        size_t length = cdc_next_boundary(buffer + start, filled - start);
+        if (length == 0) {
+            break;
+        }
+
+        if (entry->chunk_count == capacity) {
+            size_t grown = capacity ? capacity * 2 : 8;
+            uint32_t *chunks = (uint32_t *)realloc(entry->chunks, grown * sizeof(uint32_t));
+            if (!chunks) {
+                status = -1;
+                break;
+            }
+            entry->chunks = chunks;
+            capacity = grown;
+        }
+        crc = crc32_update(crc, buffer + start, length);
+        status = store_archive_v2_chunk(builder, index, entry_index, buffer + start, length, scratch,
+                                        &entry->chunks[entry->chunk_count]);
+        entry->chunk_count++;
+        builder->chunk_refs++;
+        total += length;
+        start += length;
+    }
+    close(fd);
+
+    if (status == 0 && total != entry->original_size) {
+        fprintf(stderr, "Error: '%s' cambió de tamaño durante el archivado\n", source);
+        status = -1;
+    }
+    entry->crc32 = crc;
+    return status;
+}
+
+/*
+ * Con --dedup-chunks: recorre las entradas en orden y reparte sus chunks únicos
+ * en bloques. Va en el hilo principal porque el índice no es compartido; la
+ * compresión de los bloques sí se reparte después en el pool.
+ */
+static int chunk_archive_v2(archive_v2_builder_t *builder) {
+    char store_path[MAX_PATH_LENGTH];
+    if (snprintf(store_path, sizeof(store_path), "%s/chunks", builder->temp_dir) >= (int)sizeof(store_path)) {
+        fprintf(stderr, "Error: ruta temporal demasiado larga para el almacén de chunks\n");
+        return -1;
+    }
+    builder->store_fd = open(store_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (builder->store_fd == -1) {
+        fprintf(stderr, "Error: no se pudo crear el almacén de chunks - %s\n", strerror(errno));
+        return -1;
+    }
+    unlink(store_path);
+
+    pthread_once(&crc32_table_once, init_crc32_table);
+    unsigned char *buffer = (unsigned char *)malloc(ARCHIVE_V2_CDC_BUFFER_SIZE);
+    unsigned char *scratch = (unsigned char *)malloc(CDC_MAX_CHUNK);
+    dedup_index_t index;
+    int status = 0;
+    if (!buffer || !scratch || dedup_index_init(&index, builder->count * 4) != 0) {
+        fprintf(stderr, "Error: sin memoria para el índice de chunks.\n");
+        free(buffer);
+        free(scratch);
+        return -1;
+    }
+
+    for (size_t i = 0; status == 0 && i < builder->count; i++) {
+        archive_v2_entry_t *entry = &builder->entries[i];
+        if (entry->flags & ARCHIVE_V2_ENTRY_DUPLICATE) {
+            continue;
+        }
+        entry->flags = ARCHIVE_V2_ENTRY_CHUNKED;
+        record_entry_codec(builder, entry);
+        status = chunk_archive_v2_entry(builder, &index, i, buffer, scratch);
+    }
+
+    dedup_index_free(&index);
+    free(buffer);
+    free(scratch);
+    return status;
+}
+
+/* Resumen de --dedup-chunks: bytes lógicos frente a únicos y a lo almacenado */
+static void report_chunk_dedup(const archive_v2_builder_t *builder) {
+    uint64_t logical = 0;
+    uint64_t stored = 0;
+    for (size_t i = 0; i < builder->count; i++) {
+        if (!(builder->entries[i].flags & ARCHIVE_V2_ENTRY_DUPLICATE)) {
+            logical += builder->entries[i].original_size;
+        }
+    }
+    for (size_t i = 0; i < builder->block_count; i++) {
+        stored += builder->blocks[i].stored_size;
+    }
+    double ratio = builder->store_size > 0 ? (double)logical / (double)builder->store_size : 1.0;
+    printf("Deduplicación por chunks: %zu chunks, %zu únicos; %llu → %llu bytes (ratio %.2f:1), "
+           "%llu bytes almacenados\n", builder->chunk_refs, builder->chunk_count,
+           (unsigned long long)logical, (unsigned long long)builder->store_size, ratio,
+           (unsigned long long)stored);
+}
+
+int create_archive_v2(const program_config_t *config, const char *archive_path) {
+    FileList list = {0};
+    read_directory_parallel(config->input_path, &list, config->num_threads);
+    if (list.count == 0) {
+        fprintf(stderr, "Error: el directorio '%s' está vacío o no se pudo leer.\n", config->input_path);
+        free_file_list(&list);
+        return -1;
+    }
+    if (list.count > UINT32_MAX) {
+        fprintf(stderr, "Error: demasiados archivos para un archive v2.\n");
+        free_file_list(&list);
+        return -1;
+    }
+
+    /* Las entradas son temporales del pool: se sincroniza solo el archive */
+    program_config_t entry_config = *config;
+    entry_config.durability = DURABILITY_NONE;
+
+    archive_v2_builder_t builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.config = &entry_config;
+    builder.archive_path = archive_path;
+    builder.offset = ARCHIVE_V2_HEADER_SIZE;
+    builder.fd = -1;
+    builder.store_fd = -1;
+
+    int status = plan_archive_v2(config, &list, &builder);
+
+    /* Temporales junto al archive: mismo sistema de archivos para copiar en el kernel */
+    snprintf(builder.temp_dir, sizeof(builder.temp_dir), "%s.parts-XXXXXX", archive_path);
+    if (status == 0 && mkdtemp(builder.temp_dir) == NULL) {
+        fprintf(stderr, "Error: no se pudo crear directorio temporal - %s\n", strerror(errno));
+        status = -1;
+    }
+    if (status != 0) {
+        builder.temp_dir[0] = '\0';
+    }
+
+    if (status == 0 && config->dedup_chunks) {
+        status = chunk_archive_v2(&builder);
+    }
+
+    /* Una tarea por bloque y por entrada propia; las más grandes primero (LPT) */
+    FileList tasks = {0};
+    if (status == 0) {
+        size_t slots = builder.count + builder.block_count;
+        builder.tasks = (archive_v2_task_t *)calloc(slots, sizeof(archive_v2_task_t));
+        tasks.paths = (char **)malloc(slots * sizeof(char *));
+        tasks.sizes = (off_t *)malloc(slots * sizeof(off_t));
+        if (!builder.tasks || !tasks.paths || !tasks.sizes) {
+            fprintf(stderr, "Error: sin memoria para las tareas del archive.\n");
+            status = -1;
+        }
+    }
+    if (status == 0) {
+        for (size_t i = 0; i < builder.block_count; i++) {
+            archive_v2_task_t *task = &builder.tasks[tasks.count++];
+            task->block = &builder.blocks[i];
+            task->size = builder.blocks[i].original_size;
+        }
+        for (size_t i = 0; i < builder.count; i++) {
+            if (builder.entries[i].flags & ARCHIVE_V2_ENTRY_FLAGS) {
+                continue;
+            }
+            archive_v2_task_t *task = &builder.tasks[tasks.count++];
+            task->entry = &builder.entries[i];
+            task->size = builder.entries[i].original_size;
+        }
+        qsort(builder.tasks, tasks.count, sizeof(*builder.tasks), compare_tasks_by_size);
+        for (size_t i = 0; i < tasks.count; i++) {
+            const archive_v2_task_t *task = &builder.tasks[i];
+            size_t source = task->block ? task->block->first : (size_t)(task->entry - builder.entries);
+            tasks.paths[i] = builder.sources[source];
+            tasks.sizes[i] = (off_t)task->size;
+        }
+    }
+
+    if (status == 0) {
+        builder.fd = open(archive_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (builder.fd == -1) {
+            fprintf(stderr, "Error: no se pudo crear '%s' - %s\n", archive_path, strerror(errno));
+            status = -1;
+        } else if (write_archive_v2_header(builder.fd, config) != 0) {
+            fprintf(stderr, "Error: no se pudo escribir el encabezado del archive.\n");
+            status = -1;
+        }
+    }
+
+    if (status == 0) {
+        pthread_mutex_init(&builder.mutex, NULL);
+        if (config->dedup_chunks) {
+            printf("Archive v2: procesando %zu entradas en paralelo (%zu bloques de chunks)\n",
+                   builder.count, builder.block_count);
+        } else if (builder.block_count > 0) {
+            printf("Archive v2: procesando %zu entradas en paralelo (%zu bloques sólidos)\n",
+                   builder.count, builder.block_count);
+        } else {
+            printf("Archive v2: procesando %zu entradas en paralelo\n", builder.count);
+        }
+        int failed = run_file_pool(config, &tasks, add_archive_v2_task, &builder);
+        pthread_mutex_destroy(&builder.mutex);
+        if (failed != 0) {
+            fprintf(stderr, "Error: %d tareas no se pudieron añadir al archive\n", failed);
+            status = -1;
+        }
+    }
+
+    /* Cada duplicado apunta a los datos que ya se guardaron para su original */
+    for (size_t i = 0; status == 0 && i < builder.count; i++) {
+        if (builder.original_of[i] == i) {
+            continue;
+        }
+        archive_v2_entry_t *entry = &builder.entries[i];
+        const archive_v2_entry_t *original = &builder.entries[builder.original_of[i]];
+        entry->offset = original->offset;
+        entry->stored_size = original->stored_size;
+        entry->operations = original->operations;
+        entry->comp_alg = original->comp_alg;
+        entry->enc_alg = original->enc_alg;
+        entry->flags = original->flags | ARCHIVE_V2_ENTRY_DUPLICATE;
+        entry->block = original->block;
+        entry->crc32 = original->crc32;
+        entry->chunks = original->chunks;
+        entry->chunk_count = original->chunk_count;
+    }
+
+    unsigned char header_flags = (unsigned char)((config->solid_blocks ? ARCHIVE_V2_FLAG_SOLID : 0) |
+                                                 (config->dedup_chunks ? ARCHIVE_V2_FLAG_CHUNKS : 0));
+    if (status == 0 && write_archive_v2_directory(builder.fd, &builder, header_flags) != 0) {
+        fprintf(stderr, "Error: no se pudo escribir el directorio del archive - %s\n", strerror(errno));
+        status = -1;
+    }
+
+    if (status == 0) {
+        if (config->durability == DURABILITY_PER_FILE) {
+            sync_file_descriptor(builder.fd, archive_path);
+        }
+        if (config->dedup_chunks) {
+            report_chunk_dedup(&builder);
+        }
+        printf("Archive v2 generado en '%s' (%zu entradas)\n", archive_path, builder.count);
+    }
+
+    if (builder.fd != -1) {
+        close(builder.fd);
+        if (status != 0) {
+            unlink(archive_path);
+        }
+    }
+    if (builder.store_fd != -1) {
+        close(builder.store_fd);
+    }
+    if (builder.temp_dir[0] != '\0') {
+        rmdir(builder.temp_dir);
+    }
+    for (size_t i = 0; i < builder.count; i++) {
+        free(builder.entries[i].path);
+        // Los duplicados comparten la lista de chunks de su original
+        if (!(builder.entries[i].flags & ARCHIVE_V2_ENTRY_DUPLICATE)) {
+            free(builder.entries[i].chunks);
+        }
+    }
+    free(builder.chunks);
+    free(builder.entries);
+    free(builder.sources);
+    free(builder.original_of);
+    free(builder.blocks);
+    free(builder.tasks);
+    free(tasks.paths);
+    free(tasks.sizes);
+    free_file_list(&list);
+    return status;
+}
+
+static void free_archive_v2_directory(archive_v2_directory_t *directory) {
+    for (size_t i = 0; i < directory->count; i++) {
+        free(directory->entries[i].path);
+        free(directory->entries[i].chunks);
+    }
+    free(directory->entries);
+    free(directory->blocks);
+    free(directory->chunks);
+    memset(directory, 0, sizeof(*directory));
+}
+
+static int is_valid_codec(unsigned char operations, unsigned char comp_alg, unsigned char enc_alg) {
+    return (operations & ~(OP_COMPRESS | OP_ENCRYPT)) == 0 &&
+           comp_alg <= COMP_ALG_LZW && enc_alg <= ENC_ALG_VIGENERE &&
+           !((operations & OP_COMPRESS) && comp_alg == COMP_ALG_NONE) &&
+           !((operations & OP_ENCRYPT) && enc_alg == ENC_ALG_NONE);
+}
+
+/* Lee la tabla de bloques que sigue a las entradas del directorio */
+static int read_archive_v2_blocks(const unsigned char *dir, size_t dir_size, size_t *pos_inout,
+                                  uint64_t dir_offset, archive_v2_directory_t *directory) {
+    size_t pos = *pos_inout;
+    if (pos + 8 > dir_size || memcmp(dir + pos, ARCHIVE_V2_BLOCKS_MAGIC, 4) != 0) {
+        return -1;
+    }
+    uint32_t block_count = load_u32_le(dir + pos + 4);
+    pos += 8;
+    if ((dir_size - pos) / ARCHIVE_V2_BLOCK_RECORD_SIZE < block_count) {
+        return -1;
+    }
+
+    directory->blocks = (archive_v2_block_t *)calloc(block_count ? block_count : 1, sizeof(archive_v2_block_t));
+    if (!directory->blocks) {
+        return -1;
+    }
+    directory->block_count = block_count;
+    for (uint32_t i = 0; i < block_count; i++) {
+        archive_v2_block_t *block = &directory->blocks[i];
+        block->offset = load_u64_le(dir + pos);
+        block->stored_size = load_u64_le(dir + pos + 8);
+        block->original_size = load_u64_le(dir + pos + 16);
+        pos += ARCHIVE_V2_BLOCK_RECORD_SIZE;
+        if (block->offset < ARCHIVE_V2_HEADER_SIZE || block->stored_size > dir_offset ||
+            block->offset > dir_offset - block->stored_size) {
+            return -1;
+        }
+    }
+    *pos_inout = pos;
+    return 0;
+}
+
+/* Lee la tabla de chunks únicos; cada chunk debe caber en su bloque ya deshecho */
+static int read_archive_v2_chunks(const unsigned char *dir, size_t dir_size, size_t *pos_inout,
+                                  archive_v2_directory_t *directory) {
+    size_t pos = *pos_inout;
+    if (pos + 8 > dir_size || memcmp(dir + pos, ARCHIVE_V2_CHUNKS_MAGIC, 4) != 0) {
+        return -1;
+    }
+    uint32_t chunk_count = load_u32_le(dir + pos + 4);
+    pos += 8;
+    if ((dir_size - pos) / ARCHIVE_V2_CHUNK_RECORD_SIZE < chunk_count) {
+        return -1;
+    }
+
+    directory->chunks = (archive_v2_chunk_t *)calloc(chunk_count ? chunk_count : 1, sizeof(archive_v2_chunk_t));
+    if (!directory->chunks) {
+        return -1;
+    }
+    directory->chunk_count = chunk_count;
+    for (uint32_t i = 0; i < chunk_count; i++) {
+        archive_v2_chunk_t *chunk = &directory->chunks[i];
+        chunk->block = load_u32_le(dir + pos);
+        chunk->offset = load_u32_le(dir + pos + 4);
+        chunk->size = load_u32_le(dir + pos + 8);
+        pos += ARCHIVE_V2_CHUNK_RECORD_SIZE;
+        if (chunk->block >= directory->block_count || chunk->size == 0 || chunk->size > CDC_MAX_CHUNK ||
+            chunk->size > directory->blocks[chunk->block].original_size ||
+            chunk->offset > directory->blocks[chunk->block].original_size - chunk->size) {
+            return -1;
+        }
+    }
+    *pos_inout = pos;
+    return 0;
+}
+
+/* Lee el directorio del final del archive; las rutas quedan en memoria propia */
+static int read_archive_v2_directory(int fd, archive_v2_directory_t *directory) {
+    memset(directory, 0, sizeof(*directory));
+
+    struct stat st;
+    unsigned char header[ARCHIVE_V2_HEADER_SIZE];
+    unsigned char trailer[ARCHIVE_V2_TRAILER_SIZE];
+    if (fstat(fd, &st) != 0 || st.st_size < ARCHIVE_V2_HEADER_SIZE + ARCHIVE_V2_TRAILER_SIZE + 8 ||
+        read_exact_at_fd(fd, header, sizeof(header), 0) != 0 ||
+        memcmp(header, ARCHIVE_V2_MAGIC, ARCHIVE_V2_MAGIC_SIZE) != 0 ||
+        (header[13] & ~ARCHIVE_V2_HEADER_FLAGS) != 0 ||
+        read_exact_at_fd(fd, trailer, sizeof(trailer), st.st_size - ARCHIVE_V2_TRAILER_SIZE) != 0 ||
+        memcmp(trailer + 12, ARCHIVE_V2_END_MAGIC, 4) != 0) {
+        fprintf(stderr, "Error: el archivo no es un archive v2 válido.\n");
+        return -1;
+    }
+    int solid = (header[13] & ARCHIVE_V2_FLAG_SOLID) != 0;
+    int chunked = (header[13] & ARCHIVE_V2_FLAG_CHUNKS) != 0;
+    directory->operations = header[10];
+    directory->comp_alg = header[11];
+    directory->enc_alg = header[12];
+    if ((solid || chunked) && !is_valid_codec(header[10], header[11], header[12])) {
+        fprintf(stderr, "Error: codec de bloques inválido en el archive.\n");
+        return -1;
+    }
+
+    uint64_t dir_offset = load_u64_le(trailer);
+    uint32_t count = load_u32_le(trailer + 8);
+    uint64_t dir_end = (uint64_t)st.st_size - ARCHIVE_V2_TRAILER_SIZE;
+    if (dir_offset < ARCHIVE_V2_HEADER_SIZE || dir_offset + 8 > dir_end) {
+        fprintf(stderr, "Error: directorio del archive fuera de rango.\n");
+        return -1;
+    }
+
+    size_t dir_size = (size_t)(dir_end - dir_offset);
+    unsigned char *dir = (unsigned char *)malloc(dir_size);
+    if (!dir) {
+        return -1;
+    }
+    if (read_exact_at_fd(fd, dir, dir_size, (off_t)dir_offset) != 0 ||
+        memcmp(dir, ARCHIVE_V2_DIR_MAGIC, 4) != 0 || load_u32_le(dir + 4) != count) {
+        fprintf(stderr, "Error: directorio del archive corrupto.\n");
+        free(dir);
+        return -1;
+    }
+
+    directory->entries = (archive_v2_entry_t *)calloc(count ? count : 1, sizeof(archive_v2_entry_t));
+    if (!directory->entries) {
+        free(dir);
+        return -1;
+    }
+
+    int status = 0;
+    size_t pos = 8;
+    for (uint32_t i = 0; status == 0 && i < count; i++) {
+        archive_v2_entry_t *entry = &directory->entries[i];
+        if (pos + 2 > dir_size) {
+            status = -1;
+            break;
+        }
+        size_t path_len = load_u16_le(dir + pos);
+        if (pos + ARCHIVE_V2_ENTRY_FIXED_SIZE + path_len > dir_size) {
+            status = -1;
+            break;
+        }
+        entry->path = (char *)malloc(path_len + 1);
+        if (!entry->path) {
+            status = -1;
+            break;
+        }
+        directory->count = i + 1;
+        memcpy(entry->path, dir + pos + 2, path_len);
+        entry->path[path_len] = '\0';
+        pos += 2 + path_len;
+        entry->offset = load_u64_le(dir + pos);
+        entry->stored_size = load_u64_le(dir + pos + 8);
+        entry->original_size = load_u64_le(dir + pos + 16);
+        entry->operations = dir[pos + 24];
+        entry->comp_alg = dir[pos + 25];
+        entry->enc_alg = dir[pos + 26];
+        entry->flags = dir[pos + 27];
+        entry->crc32 = load_u32_le(dir + pos + 28);
+        pos += 32;
+        if (entry->flags & ARCHIVE_V2_ENTRY_SOLID) {
+            if (!solid || pos + ARCHIVE_V2_ENTRY_BLOCK_SIZE > dir_size) {
+                status = -1;
+                break;
+            }
+            entry->block = load_u32_le(dir + pos);
+            pos += ARCHIVE_V2_ENTRY_BLOCK_SIZE;
+        }
+        if (entry->flags & ARCHIVE_V2_ENTRY_CHUNKED) {
+            if (!chunked || pos + 4 > dir_size) {
+                status = -1;
+                break;
+            }
+            uint32_t chunk_count = load_u32_le(dir + pos);
+            pos += 4;
+            if ((dir_size - pos) / 4 < chunk_count) {
+                status = -1;
+                break;
+            }
+            entry->chunks = (uint32_t *)malloc((chunk_count ? chunk_count : 1) * sizeof(uint32_t));
+            if (!entry->chunks) {
+                status = -1;
+                break;
+            }
+            entry->chunk_count = chunk_count;
+            for (uint32_t c = 0; c < chunk_count; c++) {
+                entry->chunks[c] = load_u32_le(dir + pos);
+                pos += 4;
+            }
+        }
+    }
+    if (status == 0 && (solid || chunked) &&
+        read_archive_v2_blocks(dir, dir_size, &pos, dir_offset, directory) != 0) {
+        status = -1;
+    }
+    if (status == 0 && chunked && read_archive_v2_chunks(dir, dir_size, &pos, directory) != 0) {
+        status = -1;
+    }
+    if (status == 0 && pos != dir_size) {
+        status = -1;
+    }
+    free(dir);
+
+    for (size_t i = 0; status == 0 && i < directory->count; i++) {
+        const archive_v2_entry_t *entry = &directory->entries[i];
+        int in_range;
+        if (entry->flags & ARCHIVE_V2_ENTRY_CHUNKED) {
+            /* Los chunks deben existir y sumar exactamente el tamaño original */
+            uint64_t total = 0;
+            in_range = !(entry->flags & ARCHIVE_V2_ENTRY_SOLID) && entry->stored_size == 0;
+            for (uint32_t c = 0; in_range && c < entry->chunk_count; c++) {
+                in_range = entry->chunks[c] < directory->chunk_count;
+                if (in_range) {
+                    total += directory->chunks[entry->chunks[c]].size;
+                }
+            }
+            in_range = in_range && total == entry->original_size;
+        } else if (entry->flags & ARCHIVE_V2_ENTRY_SOLID) {
+            /* El rango de la entrada es relativo al bloque ya deshecho */
+            const archive_v2_block_t *block = entry->block < directory->block_count ?
+                                              &directory->blocks[entry->block] : NULL;
+            in_range = block != NULL && entry->stored_size == 0 &&
+                       entry->original_size <= block->original_size &&
+                       entry->offset <= block->original_size - entry->original_size;
+        } else {
+            in_range = entry->offset >= ARCHIVE_V2_HEADER_SIZE &&
+                       entry->stored_size <= dir_offset &&
+                       entry->offset <= dir_offset - entry->stored_size;
+        }
+        if (!is_safe_entry_path(entry->path) || (entry->flags & ~ARCHIVE_V2_ENTRY_FLAGS) != 0 ||
+            !is_valid_codec(entry->operations, entry->comp_alg, entry->enc_alg) || !in_range) {
+            fprintf(stderr, "Error: entrada inválida en el archive: '%s'\n", entry->path);
+            status = -1;
+        }
+    }
+
+    if (status != 0) {
+        fprintf(stderr, "Error: directorio del archive corrupto.\n");
+        free_archive_v2_directory(directory);
+        return -1;
+    }
+    return 0;
+}
+
+/* Sin patrón se extrae todo; con patrón, las rutas que encajan con fnmatch */
+static int entry_matches(const char *pattern, const char *path) {
+    return pattern == NULL || pattern[0] == '\0' || fnmatch(pattern, path, 0) == 0;
+}
+
+int list_archive_v2(const char *archive_path) {
+    int fd = open(archive_path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error: no se pudo abrir '%s' - %s\n", archive_path, strerror(errno));
+        return -1;
+    }
+
+    archive_v2_directory_t directory;
+    if (read_archive_v2_directory(fd, &directory) != 0) {
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    uint64_t total_original = 0;
+    uint64_t total_stored = 0;
+    size_t duplicates = 0;
+    printf("%12s %12s  %-18s %-8s %6s  %s\n", "Original", "Almacenado", "Codec", "CRC32", "Bloque", "Ruta");
+    for (size_t i = 0; i < directory.count; i++) {
+        const archive_v2_entry_t *entry = &directory.entries[i];
+        char block[16] = "-";
+        if (entry->flags & ARCHIVE_V2_ENTRY_SOLID) {
+            snprintf(block, sizeof(block), "#%u", entry->block);
+        } else if (entry->flags & ARCHIVE_V2_ENTRY_CHUNKED) {
+            snprintf(block, sizeof(block), "%uch", entry->chunk_count);
+        }
+        // Un duplicado no ocupa espacio propio: se marca con "=" y no suma a lo almacenado
+        printf("%12llu %12llu  %-18s %08x %6s  %s%s\n",
+               (unsigned long long)entry->original_size,
+               (unsigned long long)entry->stored_size,
+               entry_codec_name(entry), entry->crc32, block,
+               (entry->flags & ARCHIVE_V2_ENTRY_DUPLICATE) ? "= " : "", entry->path);
+        total_original += entry->original_size;
+        if (entry->flags & ARCHIVE_V2_ENTRY_DUPLICATE) {
+            duplicates++;
+        } else {
+            total_stored += entry->stored_size;
+        }
+    }
+    // Lo almacenado de las entradas sólidas o por chunks se cuenta en sus bloques
+    for (size_t i = 0; i < directory.block_count; i++) {
+        total_stored += directory.blocks[i].stored_size;
+    }
+    printf("%12llu %12llu  %zu entradas", (unsigned long long)total_original,
+           (unsigned long long)total_stored, directory.count);
+    if (directory.chunk_count > 0) {
+        printf(", %zu chunks únicos en %zu bloques", directory.chunk_count, directory.block_count);
+    } else if (directory.block_count > 0) {
+        printf(", %zu bloques sólidos", directory.block_count);
+    }
+    if (duplicates > 0) {
+        printf(", %zu duplicados", duplicates);
+    }
+    printf("\n");
+
+    free_archive_v2_directory(&directory);
+    return 0;
+}
+
+/*
+ * Bloques de chunks ya deshechos en memoria, compartidos por las tareas que
+ * reconstruyen entradas: un bloque se deshace una sola vez mientras siga en la
+ * caché. Cada tarea fija como mucho un bloque a la vez y hay más huecos que
+ * hilos, así que siempre queda uno libre o sin usar que reutilizar.
+ */
+typedef struct {
+    uint32_t block;                     // UINT32_MAX: hueco libre
+    int ready;                          // 0 mientras una tarea lo deshace
+    int users;                          // Tareas que lo están leyendo
+    uint64_t last_use;
+    unsigned char *data;
+    size_t capacity;
+} archive_v2_cached_block_t;
+
+typedef struct {
+    archive_v2_cached_block_t *slots;
+    size_t slot_count;
+    uint64_t clock;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+} archive_v2_block_cache_t;
+
+typedef struct {
+    const program_config_t *config;
+    int archive_fd;                     // Compartido: solo lecturas posicionales
+    const char *output_dir;
+    const archive_v2_directory_t *directory;
+    archive_v2_task_t *tasks;           // Entradas y bloques a extraer, de mayor a menor
+    archive_v2_block_cache_t *cache;    // Con entradas por chunks
+} archive_v2_extractor_t;
+
+/* Las entradas de un mismo bloque sólido quedan contiguas */
+static int compare_entries_by_block(const void *a, const void *b) {
+    const archive_v2_entry_t *left = *(archive_v2_entry_t *const *)a;
+    const archive_v2_entry_t *right = *(archive_v2_entry_t *const *)b;
+    int left_solid = (left->flags & ARCHIVE_V2_ENTRY_SOLID) != 0;
+    int right_solid = (right->flags & ARCHIVE_V2_ENTRY_SOLID) != 0;
+    if (left_solid != right_solid) {
+        return left_solid - right_solid;
+    }
+    if (left_solid && left->block != right->block) {
+        return left->block < right->block ? -1 : 1;
+    }
+    return strcmp(left->path, right->path);
+}
+
+/* Cada entrada registra qué se le hizo: se deshace con su propio codec */
+static void build_undo_config(const program_config_t *base, unsigned char operations,
+                              unsigned char comp_alg, unsigned char enc_alg, program_config_t *out) {
+    *out = *base;
+    out->operations = OP_NONE;
+    if (operations & OP_COMPRESS) {
+        out->operations |= OP_DECOMPRESS;
+    }
+    if (operations & OP_ENCRYPT) {
+        out->operations |= OP_DECRYPT;
+    }
+    out->comp_alg = (compression_alg_t)comp_alg;
+    out->enc_alg = (encryption_alg_t)enc_alg;
+    out->range_enabled = 0;
+}
+
+/* Abre un lector sobre un rango del archive compartido: se deshace sin copiarlo antes */
+static int open_archive_v2_range(const archive_v2_extractor_t *extractor, const program_config_t *undo_config,
+                                 uint64_t offset, uint64_t stored_size, const char *label,
+                                 pipeline_reader_t **reader) {
+    int rc = pipeline_reader_open_range(undo_config, extractor->archive_fd, offset, stored_size, reader);
+    if (rc == 1) {
+        fprintf(stderr, "Error: '%s' no contiene un stream comprimido válido\n", label);
+    }
+    return rc == 0 ? 0 : -1;
+}
+
+static int buffer_is_zero(const unsigned char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Los tramos a cero se saltan: la salida conserva los huecos del original */
+static int write_or_skip_fd(int fd, const unsigned char *data, size_t size) {
+    if (buffer_is_zero(data, size)) {
+        return lseek(fd, (off_t)size, SEEK_CUR) == -1 ? -1 : 0;
+    }
+    return write_all_fd(fd, data, size);
+}
+
+/* Deshace un rango del archive directamente hacia output_path; opcionalmente da su CRC32 */
+static int undo_archive_v2_range(const archive_v2_extractor_t *extractor, const program_config_t *undo_config,
+                                 uint64_t offset, uint64_t stored_size, const char *label,
+                                 const char *output_path, uint32_t *crc_out) {
+    pipeline_reader_t *reader = NULL;
+    if (open_archive_v2_range(extractor, undo_config, offset, stored_size, label, &reader) != 0) {
+        return -1;
+    }
+
+    unsigned char *buffer = (unsigned char *)malloc(ARCHIVE_V2_IO_BUFFER_SIZE);
+    int fd = buffer ? open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    if (fd == -1) {
+        fprintf(stderr, "Error: no se pudo crear '%s' - %s\n", output_path, strerror(errno));
+        free(buffer);
+        pipeline_reader_close(reader);
+        return -1;
+    }
+
+    pthread_once(&crc32_table_once, init_crc32_table);
+    uint32_t crc = 0;
+    uint64_t total = 0;
+    int status = 0;
+    for (;;) {
+        ssize_t got = pipeline_reader_read(reader, buffer, ARCHIVE_V2_IO_BUFFER_SIZE);
+        if (got <= 0) {
+            status = got == 0 ? 0 : -1;
+            break;
+        }
+        crc = crc32_update(crc, buffer, (size_t)got);
+        if (write_or_skip_fd(fd, buffer, (size_t)got) != 0) {
+            fprintf(stderr, "Error: no se pudo escribir '%s' - %s\n", output_path, strerror(errno));
+            status = -1;
+            break;
+        }
+        total += (uint64_t)got;
+    }
+    if (status == 0 && ftruncate(fd, (off_t)total) != 0) {
+        fprintf(stderr, "Error: no se pudo ajustar el tamaño de '%s' - %s\n", output_path, strerror(errno));
+        status = -1;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Error: Falló la extracción de '%s'\n", label);
+    } else if (undo_config->durability == DURABILITY_PER_FILE) {
+        sync_file_descriptor(fd, output_path);
+    }
+    close(fd);
+    free(buffer);
+    pipeline_reader_close(reader);
+
+    if (crc_out != NULL) {
+        *crc_out = crc;
+    }
+    return status;
+}
+
+static int extract_archive_v2_entry(const archive_v2_extractor_t *extractor, const archive_v2_entry_t *entry) {
+    char full_path[MAX_PATH_LENGTH];
+    if (snprintf(full_path, sizeof(full_path), "%s/%s", extractor->output_dir, entry->path) >=
+        (int)sizeof(full_path)) {
+        fprintf(stderr, "Error: la ruta destino es demasiado larga.\n");
+        return -1;
+    }
+
+    program_config_t entry_config;
+    build_undo_config(extractor->config, entry->operations, entry->comp_alg, entry->enc_alg, &entry_config);
+    uint32_t crc = 0;
+    int status = undo_archive_v2_range(extractor, &entry_config, entry->offset, entry->stored_size,
+                                       entry->path, full_path, &crc);
+    if (status == 0 && crc != entry->crc32) {
+        fprintf(stderr, "Error: CRC32 no coincide en '%s' (esperado %08x, obtenido %08x)\n",
+                entry->path, entry->crc32, crc);
+        unlink(full_path);
+        status = -1;
+    }
+    if (status == 0) {
+        printf("  + Extraído '%s' (%llu bytes)\n", entry->path, (unsigned long long)entry->original_size);
+    }
+    return status;
+}
+
+/* Escribe un archivo del bloque ya deshecho comprobando su CRC32 */
+static int write_solid_member(const archive_v2_extractor_t *extractor, const unsigned char *data,
+                              const archive_v2_entry_t *entry) {
+    char full_path[MAX_PATH_LENGTH];
+    if (snprintf(full_path, sizeof(full_path), "%s/%s", extractor->output_dir, entry->path) >=
+        (int)sizeof(full_path)) {
+        fprintf(stderr, "Error: la ruta destino es demasiado larga.\n");
+        return -1;
+    }
+
+    const unsigned char *member = data + entry->offset;
+    uint32_t crc = crc32_buffer(member, (size_t)entry->original_size);
+    if (crc != entry->crc32) {
+        fprintf(stderr, "Error: CRC32 no coincide en '%s' (esperado %08x, obtenido %08x)\n",
+                entry->path, entry->crc32, crc);
+        return -1;
+    }
+
+    int fd = open(full_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        fprintf(stderr, "Error: no se pudo crear '%s' - %s\n", full_path, strerror(errno));
+        return -1;
+    }
+    int status = write_all_fd(fd, member, (size_t)entry->original_size);
+    if (status != 0) {
+        fprintf(stderr, "Error: no se pudo escribir '%s' - %s\n", full_path, strerror(errno));
+    } else if (extractor->config->durability == DURABILITY_PER_FILE) {
+        sync_file_descriptor(fd, full_path);
+    }
+    close(fd);
+    return status;
+}
+
+/* Deshace un bloque (sólido o de chunks) entero en data, directamente desde el archive */
+static int read_archive_v2_block(const archive_v2_extractor_t *extractor, const archive_v2_block_t *block,
+                                 const char *label, unsigned char *data) {
+    const archive_v2_directory_t *directory = extractor->directory;
+    program_config_t block_config;
+    build_undo_config(extractor->config, directory->operations, directory->comp_alg, directory->enc_alg,
+                      &block_config);
+
+    pipeline_reader_t *reader = NULL;
+    if (open_archive_v2_range(extractor, &block_config, block->offset, block->stored_size,
+                              label, &reader) != 0) {
+        return -1;
+    }
+    int status = 0;
+    unsigned char extra;
+    ssize_t got = pipeline_reader_read(reader, data, (size_t)block->original_size);
+    if (got != (ssize_t)block->original_size || pipeline_reader_read(reader, &extra, 1) != 0) {
+        fprintf(stderr, "Error: bloque de '%s' inválido o ilegible\n", label);
+        status = -1;
+    }
+    pipeline_reader_close(reader);
+    return status;
+}
+
+/* Deshace el bloque una sola vez y reparte de él los archivos elegidos */
+static int extract_archive_v2_block(const archive_v2_extractor_t *extractor, const archive_v2_task_t *task) {
+    const archive_v2_block_t *block = task->block;
+    const char *label = task->members[0]->path;
+
+    unsigned char *data = (unsigned char *)malloc(block->original_size ? (size_t)block->original_size : 1);
+    if (!data) {
+        fprintf(stderr, "Error: no hay memoria para el bloque sólido de '%s'\n", label);
+        return -1;
+    }
+
+    /* El bloque se deshace directamente a memoria: sus archivos salen de ahí */
+    int status = read_archive_v2_block(extractor, block, label, data);
+
+    for (size_t i = 0; status == 0 && i < task->member_count; i++) {
+        status = write_solid_member(extractor, data, task->members[i]);
+    }
+    free(data);
+
+    if (status == 0) {
+        printf("  + Extraídos %zu archivos de un bloque sólido (%llu bytes)\n", task->member_count,
+               (unsigned long long)block->original_size);
+    }
+    return status;
+}
+
+static int init_block_cache(archive_v2_block_cache_t *cache, size_t slot_count) {
+    memset(cache, 0, sizeof(*cache));
+    cache->slots = (archive_v2_cached_block_t *)calloc(slot_count, sizeof(*cache->slots));
+    if (!cache->slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < slot_count; i++) {
+        cache->slots[i].block = UINT32_MAX;
+    }
+    cache->slot_count = slot_count;
+    pthread_mutex_init(&cache->mutex, NULL);
+    pthread_cond_init(&cache->changed, NULL);
+    return 0;
+}
+
+static void free_block_cache(archive_v2_block_cache_t *cache) {
+    if (!cache->slots) {
+        return;
+    }
+    for (size_t i = 0; i < cache->slot_count; i++) {
+        free(cache->slots[i].data);
+    }
+    free(cache->slots);
+    pthread_mutex_destroy(&cache->mutex);
+    pthread_cond_destroy(&cache->changed);
+}
+
+/* Fija un bloque de chunks ya deshecho; si no está, lo deshace en el hueco usado hace más tiempo */
+static archive_v2_cached_block_t *acquire_chunk_block(const archive_v2_extractor_t *extractor,
+                                                      uint32_t block_index) {
+    archive_v2_block_cache_t *cache = extractor->cache;
+    archive_v2_cached_block_t *victim = NULL;
+
+    pthread_mutex_lock(&cache->mutex);
+    for (;;) {
+        archive_v2_cached_block_t *found = NULL;
+        victim = NULL;
+        for (size_t i = 0; i < cache->slot_count; i++) {
+            archive_v2_cached_block_t *slot = &cache->slots[i];
+            if (slot->block == block_index) {
+                found = slot;
+                break;
+            }
+            if (slot->users == 0 && (victim == NULL || slot->last_use < victim->last_use)) {
+                victim = slot;
+            }
+        }
+        if (found != NULL && found->ready) {
+            found->users++;
+            found->last_use = ++cache->clock;
+            pthread_mutex_unlock(&cache->mutex);
+            return found;
+        }
+        if (found == NULL && victim != NULL) {
+            break;
+        }
+        /* Otra tarea lo está deshaciendo, o todos los huecos están en uso */
+        pthread_cond_wait(&cache->changed, &cache->mutex);
+    }
+    victim->block = block_index;
+    victim->ready = 0;
+    victim->users = 1;
+    victim->last_use = ++cache->clock;
+    pthread_mutex_unlock(&cache->mutex);
+
+    const archive_v2_block_t *block = &extractor->directory->blocks[block_index];
+    char label[32];
+    snprintf(label, sizeof(label), "chunks #%u", block_index);
+    int status = 0;
+    if (victim->capacity < block->original_size) {
+        unsigned char *data = (unsigned char *)realloc(victim->data, (size_t)block->original_size);
+        if (!data) {
+            fprintf(stderr, "Error: no hay memoria para el bloque de %s\n", label);
+            status = -1;
+        } else {
+            victim->data = data;
+            victim->capacity = (size_t)block->original_size;
+        }
+    }
+    if (status == 0) {
+        status = read_archive_v2_block(extractor, block, label, victim->data);
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    if (status == 0) {
+        victim->ready = 1;
+    } else {
+        victim->block = UINT32_MAX;
+        victim->users = 0;
+    }
+    pthread_cond_broadcast(&cache->changed);
+    pthread_mutex_unlock(&cache->mutex);
+    return status == 0 ? victim : NULL;
+}
+
+static void release_chunk_block(archive_v2_block_cache_t *cache, archive_v2_cached_block_t *slot) {
+    pthread_mutex_lock(&cache->mutex);
+    if (--slot->users == 0) {
+        pthread_cond_broadcast(&cache->changed);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+/* Reconstruye una entrada concatenando sus chunks; los chunks a cero quedan como huecos */
+static int assemble_archive_v2_entry(const archive_v2_extractor_t *extractor, const archive_v2_entry_t *entry) {
+    const archive_v2_directory_t *directory = extractor->directory;
+    char full_path[MAX_PATH_LENGTH];
+    if (snprintf(full_path, sizeof(full_path), "%s/%s", extractor->output_dir, entry->path) >=
+        (int)sizeof(full_path)) {
+        fprintf(stderr, "Error: la ruta destino es demasiado larga.\n");
+        return -1;
+    }
+
+    int fd = open(full_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        fprintf(stderr, "Error: no se pudo crear '%s' - %s\n", full_path, strerror(errno));
+        return -1;
+    }
+
+    pthread_once(&crc32_table_once, init_crc32_table);
+    /* Chunks consecutivos suelen venir del mismo bloque: se mantiene fijado el último */
+    archive_v2_cached_block_t *cached = NULL;
+    uint32_t crc = 0;
+    int status = 0;
+    for (uint32_t c = 0; status == 0 && c < entry->chunk_count; c++) {
+        const archive_v2_chunk_t *chunk = &directory->chunks[entry->chunks[c]];
+        if (cached == NULL || cached->block != chunk->block) {
+            if (cached != NULL) {
+                release_chunk_block(extractor->cache, cached);
+            }
+            cached = acquire_chunk_block(extractor, chunk->block);
+            if (cached == NULL) {
+                fprintf(stderr, "Error: no se pudo leer un chunk de '%s'\n", entry->path);
+                status = -1;
+                break;
+            }
+        }
+        const unsigned char *data = cached->data + chunk->offset;
+        crc = crc32_update(crc, data, chunk->size);
+        if (write_or_skip_fd(fd, data, chunk->size) != 0) {
+            fprintf(stderr, "Error: no se pudo escribir '%s' - %s\n", full_path, strerror(errno));
+            status = -1;
+        }
+    }
+    if (cached != NULL) {
+        release_chunk_block(extractor->cache, cached);
+    }
+
+    /* Un archivo que termina en chunks de ceros necesita su tamaño final explícito */
+    if (status == 0 && ftruncate(fd, (off_t)entry->original_size) != 0) {
+        fprintf(stderr, "Error: no se pudo ajustar el tamaño de '%s' - %s\n", full_path, strerror(errno));
+        status = -1;
+    }
+    if (status == 0 && crc != entry->crc32) {
+        fprintf(stderr, "Error: CRC32 no coincide en '%s' (esperado %08x, obtenido %08x)\n",
+                entry->path, entry->crc32, crc);
+        status = -1;
+    }
+    if (status == 0 && extractor->config->durability == DURABILITY_PER_FILE) {
+        sync_file_descriptor(fd, full_path);
+    }
+    close(fd);
+    /* No se deja en disco un archivo a medias o que no pasó la verificación */
+    if (status != 0) {
+        unlink(full_path);
+    }
+    if (status == 0) {
+        printf("  + Extraído '%s' (%llu bytes, %u chunks)\n", entry->path,
+               (unsigned long long)entry->original_size, entry->chunk_count);
+    }
+    return status;
+}
+
+/* Tarea del pool al extraer: una entrada con stream propio o por chunks, o un bloque sólido */
+static int extract_archive_v2_task(void *context, const char *path, size_t index) {
+    const archive_v2_extractor_t *extractor = (const archive_v2_extractor_t *)context;
+    const archive_v2_task_t *task = &extractor->tasks[index];
+    (void)path;
+    if (task->block != NULL) {
+        return extract_archive_v2_block(extractor, task);
+    }
+    if (task->entry->flags & ARCHIVE_V2_ENTRY_CHUNKED) {
+        return assemble_archive_v2_entry(extractor, task->entry);
+    }
+    return extract_archive_v2_entry(extractor, task->entry);
+}
+
+int extract_archive_v2(const program_config_t *config, const char *archive_path, const char *output_dir) {
+    int fd = open(archive_path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error: no se pudo abrir '%s' - %s\n", archive_path, strerror(errno));
+        return -1;
+    }
+
+    archive_v2_directory_t directory;
+    if (read_archive_v2_directory(fd, &directory) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t count = directory.count;
+    size_t slots = count + directory.block_count + 1;
+    const char *pattern = config->extract_pattern;
+    archive_v2_entry_t **selected = (archive_v2_entry_t **)malloc(slots * sizeof(*selected));
+    archive_v2_task_t *tasks = (archive_v2_task_t *)calloc(slots, sizeof(*tasks));
+    FileList list = {0};
+    list.paths = (char **)malloc(slots * sizeof(char *));
+    list.sizes = (off_t *)malloc(slots * sizeof(off_t));
+    int status = 0;
+    if (!selected || !tasks || !list.paths || !list.sizes) {
+        fprintf(stderr, "Error: sin memoria para las entradas del archive.\n");
+        status = -1;
+    }
+
+    size_t selected_count = 0;
+    for (size_t i = 0; status == 0 && i < count; i++) {
+        if (!entry_matches(pattern, directory.entries[i].path)) {
+            continue;
+        }
+        if ((directory.entries[i].operations & OP_ENCRYPT) && config->key[0] == '\0') {
+            fprintf(stderr, "Error: Se requiere clave (-k) para desencriptar '%s'\n", directory.entries[i].path);
+            status = -1;
+            break;
+        }
+        selected[selected_count++] = &directory.entries[i];
+    }
+    if (status == 0 && count == 0) {
+        fprintf(stderr, "Error: el archive '%s' está vacío\n", archive_path);
+        status = -1;
+    } else if (status == 0 && selected_count == 0) {
+        fprintf(stderr, "Error: ninguna entrada del archive coincide con '%s'\n",
+                pattern[0] != '\0' ? pattern : "*");
+        status = -1;
+    }
+
+    if (status == 0 && create_directory(output_dir) != 0) {
+        fprintf(stderr, "Error: no se pudo preparar el directorio de salida '%s'.\n", output_dir);
+        status = -1;
+    }
+
+    /* Directorios antes de repartir: create_directory no es segura entre hilos */
+    for (size_t i = 0; status == 0 && i < selected_count; i++) {
+        char full_path[MAX_PATH_LENGTH];
+        if (snprintf(full_path, sizeof(full_path), "%s/%s", output_dir, selected[i]->path) >=
+            (int)sizeof(full_path)) {
+            fprintf(stderr, "Error: la ruta destino es demasiado larga.\n");
+            status = -1;
+        } else if (ensure_entry_parent(full_path) != 0) {
+            fprintf(stderr, "Error: no se pudo crear directorio para '%s'.\n", full_path);
+            status = -1;
+        }
+    }
+
+    /*
+     * Una tarea por entrada con stream propio o por chunks y una por bloque
+     * sólido con algo elegido: el bloque se deshace una vez aunque se extraigan
+     * varios archivos. Las entradas por chunks deshacen sus bloques en memoria,
+     * a medida que los necesitan, a través de la caché compartida.
+     */
+    size_t task_count = 0;
+    size_t chunked_count = 0;
+    if (status == 0) {
+        qsort(selected, selected_count, sizeof(*selected), compare_entries_by_block);
+        for (size_t i = 0; i < selected_count; i++) {
+            archive_v2_entry_t *entry = selected[i];
+            if (entry->flags & ARCHIVE_V2_ENTRY_CHUNKED) {
+                tasks[task_count].entry = entry;
+                tasks[task_count].size = entry->original_size;
+                task_count++;
+                chunked_count++;
+                continue;
+            }
+            if (!(entry->flags & ARCHIVE_V2_ENTRY_SOLID)) {
+                tasks[task_count].entry = entry;
+                tasks[task_count].size = entry->stored_size;
+                task_count++;
+                continue;
+            }
+            if (i == 0 || !(selected[i - 1]->flags & ARCHIVE_V2_ENTRY_SOLID) ||
+                selected[i - 1]->block != entry->block) {
+                archive_v2_block_t *block = &directory.blocks[entry->block];
+                tasks[task_count].block = block;
+                tasks[task_count].members = &selected[i];
+                tasks[task_count].size = block->stored_size;
+                task_count++;
+            }
+            tasks[task_count - 1].member_count++;
+        }
+    }
+
+    archive_v2_block_cache_t cache = {0};
+    if (status == 0 && chunked_count > 0 &&
+        init_block_cache(&cache, 2 * (size_t)resolve_thread_count(config, task_count)) != 0) {
+        fprintf(stderr, "Error: sin memoria para la caché de bloques de chunks.\n");
+        status = -1;
+    }
+
+    archive_v2_extractor_t extractor = {config, fd, output_dir, &directory, tasks, &cache};
+    if (status == 0) {
+        qsort(tasks, task_count, sizeof(*tasks), compare_tasks_by_size);
+        for (size_t i = 0; i < task_count; i++) {
+            list.paths[i] = tasks[i].block ? tasks[i].members[0]->path : tasks[i].entry->path;
+            list.sizes[i] = (off_t)tasks[i].size;
+        }
+        list.count = task_count;
+
+        int failed = run_file_pool(config, &list, extract_archive_v2_task, &extractor);
+        if (failed != 0) {
+            fprintf(stderr, "Error: %d tareas de extracción fallaron\n", failed);
+            status = -1;
+        }
+    }
+
+    free_block_cache(&cache);
+
+    if (status == 0) {
+        printf("Archive v2: %zu de %zu entradas extraídas en '%s'\n", selected_count, count, output_dir);
+    }
+
+    // Las rutas pertenecen a las entradas del directorio
+    free(list.paths);
+    free(list.sizes);
+    free(selected);
+    free(tasks);
+    free_archive_v2_directory(&directory);
+    close(fd);
+    return status;
+}
@@ -4,13 +4,17 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <ctype.h>
+#include <errno.h>
 #include "../include/args_parser.h"
+#include "../include/chunk_cache.h"
 
 int parse_arguments(int argc, char *argv[], program_config_t *config) {
     // Inicializar configuración con valores por defecto
     memset(config, 0, sizeof(program_config_t));
     config->comp_alg = COMP_ALG_RLE;
     config->enc_alg = ENC_ALG_VIGENERE;
+    config->durability = DURABILITY_DEFAULT;
+    config->cache_max_bytes = CHUNK_CACHE_DEFAULT_SIZE;
     
     if (argc < 2) {
         fprintf(stderr, "Error: Se requieren argumentos.\n");
@@ -72,6 +76,163 @@ int parse_arguments(int argc, char *argv[], program_config_t *config) {
                     }
                     i += 2;
                 }
+                // Índice de chunks para acceso aleatorio
+                else if (strcmp(argv[i], "--index") == 0) {
+                    config->stream_index = 1;
+                    i++;
+                }
+                // E/S asíncrona de chunks (io_uring)
+                else if (strcmp(argv[i], "--io-uring") == 0) {
+                    config->async_io = 1;
+                    i++;
+                }
+                // Evitar el page cache en trabajos masivos
+                else if (strcmp(argv[i], "--direct-io") == 0) {
+                    config->direct_io = 1;
+                    i++;
+                }
+                // Tamaño del pool de hilos
+                else if (strcmp(argv[i], "--threads") == 0) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Error: --threads requiere un argumento.\n");
+                        return -1;
+                    }
+                    char *end = NULL;
+                    long threads = strtol(argv[i + 1], &end, 10);
+                    if (end == argv[i + 1] || *end != '\0' || threads <= 0 || threads > MAX_THREADS) {
+                        fprintf(stderr, "Error: Número de hilos inválido '%s' (1-%d)\n", argv[i + 1], MAX_THREADS);
+                        return -1;
+                    }
+                    config->num_threads = (int)threads;
+                    i += 2;
+                }
+                // Directorios: salida por archivo en lugar de un archive
+                else if (strcmp(argv[i], "--per-file") == 0) {
+                    config->per_file = 1;
+                    i++;
+                }
+                // --per-file: saltar los archivos sin cambios desde la última ejecución
+                else if (strcmp(argv[i], "--incremental") == 0) {
+                    config->incremental = 1;
+                    i++;
+                }
+                // Planificador de directorios
+                else if (strcmp(argv[i], "--scheduler") == 0) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Error: --scheduler requiere un argumento.\n");
+                        return -1;
+                    }
+                    if (parse_scheduler_policy(argv[i + 1], &config->scheduler) != 0) {
+                        fprintf(stderr, "Error: Planificador desconocido '%s'\n", argv[i + 1]);
+                        fprintf(stderr, "Planificadores disponibles: steal, queue, stream\n");
+                        return -1;
+                    }
+                    i += 2;
+                }
+                // Formato del archive de directorios
+                else if (strcmp(argv[i], "--archive-format") == 0) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Error: --archive-format requiere un argumento.\n");
+                        return -1;
+                    }
+                    if (parse_archive_format(argv[i + 1], &config->archive_format) != 0) {
+                        fprintf(stderr, "Error: Formato de archive desconocido '%s'\n", argv[i + 1]);
+                        fprintf(stderr, "Formatos disponibles: v1, v2\n");
+                        return -1;
+                    }
+                    i += 2;
+                }
+                // Archive v2: archivos pequeños en bloques sólidos
+                else if (strcmp(argv[i], "--solid") == 0) {
+                    config->solid_blocks = 1;
+                    i++;
+                }
+                // Archive v2: deduplicación por chunks definidos por contenido
+                else if (strcmp(argv[i], "--dedup-chunks") == 0) {
+                    config->dedup_chunks = 1;
+                    i++;
+                }
+                // Listado del contenido de un archive v2
+                else if (strcmp(argv[i], "--list") == 0) {
+                    config->list_archive = 1;
+                    i++;
+                }
+                // Extracción selectiva de entradas de un archive v2
+                else if (strcmp(argv[i], "--extract") == 0) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Error: --extract requiere un patrón.\n");
+                        return -1;
+                    }
+                    if (strlen(argv[i + 1]) == 0 || strlen(argv[i + 1]) >= MAX_PATH_LENGTH) {
+                        fprintf(stderr, "Error: Patrón de extracción inválido\n");
+                        return -1;
+                    }
+                    strcpy(config->extract_pattern, argv[i + 1]);
+                    i += 2;
+                }
+                // Extracción de un rango de bytes
+                else if (strcmp(argv[i], "--range") == 0) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Error: --range requiere un argumento OFFSET:LEN.\n");
+                        return -1;
+                    }
+                    if (parse_range(argv[i + 1], &config->range_offset, &config->range_length) != 0) {
+                        fprintf(stderr, "Error: Rango inválido '%s' (formato OFFSET:LEN)\n", argv[i + 1]);
+                        return -1;
+                    }
+                    config->range_enabled = 1;
+                    i += 2;
+                }
+                // Caché persistente de chunks comprimidos
+                else if (strcmp(argv[i], "--cache-dir") == 0) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Error: --cache-dir requiere un directorio.\n");
+                        return -1;
+                    }
+                    if (strlen(argv[i + 1]) == 0 || strlen(argv[i + 1]) >= MAX_PATH_LENGTH - 64) {
+                        fprintf(stderr, "Error: Directorio de caché inválido\n");
+                        return -1;
+                    }
+                    strcpy(config->cache_dir, argv[i + 1]);
+                    i += 2;
+                }
+                // Delta frente a una versión anterior del archivo
+                else if (strcmp(argv[i], "--delta-base") == 0) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Error: --delta-base requiere un archivo.\n");
+                        return -1;
+                    }
+                    if (strlen(argv[i + 1]) == 0 || strlen(argv[i + 1]) >= MAX_PATH_LENGTH) {
+                        fprintf(stderr, "Error: Ruta de la base del delta inválida\n");
+                        return -1;
+                    }
+                    strcpy(config->delta_base, argv[i + 1]);
+                    i += 2;
+                }
+                else if (strcmp(argv[i], "--cache-size") == 0) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Error: --cache-size requiere un tamaño.\n");
+                        return -1;
+                    }
+                    if (parse_byte_size(argv[i + 1], &config->cache_max_bytes) != 0) {
+                        fprintf(stderr, "Error: Tamaño de caché inválido '%s' (ej: 512M, 4G)\n", argv[i + 1]);
+                        return -1;
+                    }
+                    i += 2;
+                }
+                // Política de durabilidad
+                else if (strcmp(argv[i], "--sync") == 0) {
+                    if (i + 1 >= argc) {
+                        fprintf(stderr, "Error: --sync requiere un argumento.\n");
+                        return -1;
+                    }
+                    if (parse_durability_policy(argv[i + 1], &config->durability) != 0) {
+                        fprintf(stderr, "Error: Política de sincronización desconocida '%s'\n", argv[i + 1]);
+                        fprintf(stderr, "Políticas disponibles: none, file, batch\n");
+                        return -1;
+                    }
+                    i += 2;
+                }
                 // Ruta de entrada
                 else if (strcmp(argv[i], "-i") == 0) {
                     if (i + 1 >= argc) {
@@ -191,7 +352,117 @@ encryption_alg_t parse_encryption_alg(const char *alg_str) {
     return ENC_ALG_NONE;
 }
 
+int parse_durability_policy(const char *policy_str, durability_policy_t *policy) {
+    if (strcmp(policy_str, "none") == 0) {
+        *policy = DURABILITY_NONE;
+    } else if (strcmp(policy_str, "file") == 0) {
+        *policy = DURABILITY_PER_FILE;
+    } else if (strcmp(policy_str, "batch") == 0) {
+        *policy = DURABILITY_BATCH;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int parse_scheduler_policy(const char *policy_str, scheduler_policy_t *policy) {
+    if (strcmp(policy_str, "steal") == 0) {
+        *policy = SCHEDULER_WORK_STEALING;
+    } else if (strcmp(policy_str, "queue") == 0) {
+        *policy = SCHEDULER_SHARED_QUEUE;
+    } else if (strcmp(policy_str, "stream") == 0) {
+        *policy = SCHEDULER_STREAMING;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int parse_archive_format(const char *format_str, archive_format_t *format) {
+    if (strcmp(format_str, "v1") == 0) {
+        *format = ARCHIVE_FORMAT_V1;
+    } else if (strcmp(format_str, "v2") == 0) {
+        *format = ARCHIVE_FORMAT_V2;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* Tamaño en bytes con sufijo opcional K, M o G (potencias de 1024) */
+int parse_byte_size(const char *size_str, uint64_t *size) {
+    if (size_str == NULL || size == NULL || !isdigit((unsigned char)size_str[0])) {
+        return -1;
+    }
+
+    char *end = NULL;
+    errno = 0;
+    unsigned long long value = strtoull(size_str, &end, 10);
+    if (errno != 0 || value == 0) {
+        return -1;
+    }
+
+    unsigned shift = 0;
+    switch (toupper((unsigned char)*end)) {
+        case '\0': break;
+        case 'K': shift = 10; end++; break;
+        case 'M': shift = 20; end++; break;
+        case 'G': shift = 30; end++; break;
+        default: return -1;
+    }
+    if (*end != '\0' || value > (UINT64_MAX >> shift)) {
+        return -1;
+    }
+    *size = (uint64_t)value << shift;
+    return 0;
+}
+
+int parse_range(const char *range_str, size_t *offset, size_t *length) {
+    if (range_str == NULL || offset == NULL || length == NULL) {
+        return -1;
+    }
+
+    const char *colon = strchr(range_str, ':');
+    if (colon == NULL || colon == range_str || colon[1] == '\0') {
+        return -1;
+    }
+
+    // strtoull acepta signos, así que se exige que ambas partes empiecen con dígito
+    if (!isdigit((unsigned char)range_str[0]) || !isdigit((unsigned char)colon[1])) {
+        return -1;
+    }
+
+    char *end = NULL;
+    errno = 0;
+    unsigned long long parsed_offset = strtoull(range_str, &end, 10);
+    if (errno != 0 || end != colon) {
+        return -1;
+    }
+
+    unsigned long long parsed_length = strtoull(colon + 1, &end, 10);
+    if (errno != 0 || *end != '\0' || parsed_length == 0) {
+        return -1;
+    }
+
+    *offset = (size_t)parsed_offset;
+    *length = (size_t)parsed_length;
+    return 0;
+}
+
 int validate_config(const program_config_t *config) {
+    // El listado solo lee el directorio del archive: no admite operaciones
+    if (config->list_archive) {
+        if (config->operations != OP_NONE || config->extract_pattern[0] != '\0') {
+            fprintf(stderr, "Error: --list no puede combinarse con operaciones ni con --extract\n");
+            return -1;
+        }
+        if (strlen(config->input_path) == 0) {
+            fprintf(stderr, "Error: Debe especificar una ruta de entrada (-i)\n");
+            return -1;
+        }
+        return 0;
+    }
+
     // Verificar que se especificó al menos una operación
     if (config->operations == OP_NONE) {
         fprintf(stderr, "Error: Debe especificar al menos una operación (-c, -d, -e, -u)\n");
@@ -223,6 +494,82 @@ int validate_config(const program_config_t *config) {
         }
     }
 
+    // La extracción por rango solo aplica a la descompresión de un stream GSC1
+    if (config->range_enabled && config->operations != OP_DECOMPRESS) {
+        fprintf(stderr, "Error: --range solo puede usarse con -d (descompresión)\n");
+        return -1;
+    }
+    if (config->range_enabled && (config->per_file || config->extract_pattern[0] != '\0')) {
+        fprintf(stderr, "Error: --range no puede combinarse con --per-file ni con --extract\n");
+        return -1;
+    }
+
+    // El índice se escribe al generar el stream comprimido
+    if (config->stream_index && !(config->operations & OP_COMPRESS)) {
+        fprintf(stderr, "Error: --index solo puede usarse con -c (compresión)\n");
+        return -1;
+    }
+
+    // Los bloques sólidos solo existen en el formato v2 y se generan al crear el archive
+    if (config->solid_blocks &&
+        (config->archive_format != ARCHIVE_FORMAT_V2 ||
+         (config->operations & (OP_COMPRESS | OP_ENCRYPT)) == 0)) {
+        fprintf(stderr, "Error: --solid requiere --archive-format v2 y -c, -e o -ce\n");
+        return -1;
+    }
+
+    // Con chunks deduplicados todos los datos ya van en bloques compartidos
+    if (config->dedup_chunks &&
+        (config->archive_format != ARCHIVE_FORMAT_V2 ||
+         (config->operations & (OP_COMPRESS | OP_ENCRYPT)) == 0)) {
+        fprintf(stderr, "Error: --dedup-chunks requiere --archive-format v2 y -c, -e o -ce\n");
+        return -1;
+    }
+    if (config->dedup_chunks && config->solid_blocks) {
+        fprintf(stderr, "Error: --dedup-chunks y --solid no pueden combinarse\n");
+        return -1;
+    }
+
+    // El manifiesto describe salidas generadas a partir de los originales
+    if (config->incremental &&
+        (!config->per_file || (config->operations & (OP_DECOMPRESS | OP_DECRYPT)) != 0)) {
+        fprintf(stderr, "Error: --incremental requiere --per-file y -c, -e o -ce\n");
+        return -1;
+    }
+
+    // En streaming no existe la lista completa que el manifiesto compara con la anterior
+    if (config->scheduler == SCHEDULER_STREAMING && (!config->per_file || config->incremental)) {
+        fprintf(stderr, "Error: --scheduler stream requiere --per-file y no admite --incremental\n");
+        return -1;
+    }
+
+    // La caché guarda chunks comprimidos en claro: no se usa si la salida va encriptada
+    if (config->cache_dir[0] != '\0' &&
+        (!(config->operations & OP_COMPRESS) || (config->operations & OP_ENCRYPT))) {
+        fprintf(stderr, "Error: --cache-dir solo puede usarse con -c (sin encriptación)\n");
+        return -1;
+    }
+
+    // El delta se codifica y se aplica sobre un único archivo, en un solo sentido
+    if (config->delta_base[0] != '\0') {
+        if (config->per_file || config->range_enabled || config->extract_pattern[0] != '\0') {
+            fprintf(stderr, "Error: --delta-base no puede combinarse con --per-file, --range ni --extract\n");
+            return -1;
+        }
+        if ((config->operations & (OP_COMPRESS | OP_ENCRYPT)) != 0 &&
+            (config->operations & (OP_DECOMPRESS | OP_DECRYPT)) != 0) {
+            fprintf(stderr, "Error: --delta-base requiere -c, -e, -ce (codificar) o -d, -u, -du (reconstruir)\n");
+            return -1;
+        }
+    }
+
+    // La extracción selectiva deshace lo que registró cada entrada
+    if (config->extract_pattern[0] != '\0' &&
+        (config->operations & (OP_COMPRESS | OP_ENCRYPT)) != 0) {
+        fprintf(stderr, "Error: --extract solo puede usarse con -d, -u o -du\n");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -241,6 +588,37 @@ void print_usage(const char *program_name) {
     printf("  -i RUTA               Ruta de entrada (archivo o directorio)\n");
     printf("  -o RUTA               Ruta de salida (archivo o directorio)\n");
     printf("  -k CLAVE              Clave para encriptación/desencriptación\n");
+    printf("  --index               Añadir índice de chunks al comprimir (acceso aleatorio)\n");
+    printf("  --range OFFSET:LEN    Descomprimir solo LEN bytes desde OFFSET (con -d)\n");
+    printf("  --sync POLÍTICA       Durabilidad de salidas: file (fsync de cada salida), batch (una\n");
+    printf("                        sincronización al final) o none; por defecto solo se sincronizan\n");
+    printf("                        las salidas que se escriben de una vez, no las de streaming\n");
+    printf("  --io-uring            Usar io_uring para leer y escribir chunks (Linux; si no está\n");
+    printf("                        disponible se usa E/S bloqueante)\n");
+    printf("  --direct-io           No llenar el page cache: lectura con O_DIRECT y descarte de\n");
+    printf("                        páginas ya escritas (tiene prioridad sobre --io-uring)\n");
+    printf("  --per-file            Con un directorio de entrada, procesar cada archivo en paralelo\n");
+    printf("                        hacia un árbol de salida espejo en lugar de un único archive\n");
+    printf("  --incremental         Con --per-file, procesar solo los archivos nuevos o modificados\n");
+    printf("                        según el manifiesto guardado en la salida (.gsea-manifest)\n");
+    printf("  --cache-dir DIR       Caché en disco de chunks ya comprimidos (con -c): los chunks\n");
+    printf("                        repetidos entre ejecuciones no se recomprimen\n");
+    printf("  --cache-size TAMAÑO   Límite de la caché (por defecto 1G); expulsa lo menos usado\n");
+    printf("  --delta-base BASE     Con -c/-e/-ce, guardar solo las diferencias frente a la versión\n");
+    printf("                        anterior BASE; con -d/-u/-du, reconstruir el archivo a partir de BASE\n");
+    printf("  --threads N           Hilos para procesar directorios (por defecto, CPUs en línea)\n");
+    printf("  --scheduler MODO      Reparto entre hilos: steal (por defecto; los archivos grandes\n");
+    printf("                        se dividen en chunks que roban los hilos libres), queue o\n");
+    printf("                        stream (se empieza a procesar mientras se recorre el árbol)\n");
+    printf("  --archive-format F    Archive de directorios: v1 (por defecto; un solo stream) o v2\n");
+    printf("                        (cada archivo se comprime en paralelo, con directorio al final)\n");
+    printf("  --solid               Con v2, agrupar los archivos pequeños en bloques sólidos del\n");
+    printf("                        tamaño de un chunk que se comprimen como una sola unidad\n");
+    printf("  --dedup-chunks        Con v2, cortar los archivos en chunks definidos por contenido\n");
+    printf("                        (FastCDC) y guardar una sola vez cada chunk repetido\n");
+    printf("  --list                Listar las entradas de un archive v2 (sin operaciones)\n");
+    printf("  --extract PATRÓN      Extraer de un archive v2 solo las rutas que encajan con el\n");
+    printf("                        patrón (comodines de shell: *, ?, [...]; con -d, -u o -du)\n");
     printf("  -h, --help            Mostrar esta ayuda\n\n");
     
     printf("EJEMPLOS:\n");
@@ -249,4 +627,15 @@ void print_usage(const char *program_name) {
     printf("  %s -c --comp-alg lzw -i archivo.bin -o archivo.lzw\n", program_name);
     printf("  %s -c --comp-alg rle -i archivo.txt -o archivo.rle\n", program_name);
     printf("  %s -e --enc-alg vigenere -i datos.txt -o datos.enc -k clave123\n", program_name);
+    printf("  %s -d --comp-alg lzw -i log.lzw -o parte.log --range 1048576:4096\n", program_name);
+    printf("  %s -c --comp-alg lzw --per-file -i datos/ -o datos_lzw/\n", program_name);
+    printf("  %s -c --comp-alg lzw --per-file --incremental -i datos/ -o datos_lzw/\n", program_name);
+    printf("  %s -c --comp-alg lzw --cache-dir ~/.cache/gsea --cache-size 4G -i build.tar -o build.lzw\n",
+           program_name);
+    printf("  %s -c --comp-alg lzw --delta-base disco-v1.img -i disco-v2.img -o disco-v2.delta\n", program_name);
+    printf("  %s -d --comp-alg lzw --delta-base disco-v1.img -i disco-v2.delta -o disco-v2.img\n", program_name);
+    printf("  %s -c --comp-alg huffman --archive-format v2 -i datos/ -o datos.gsea\n", program_name);
+    printf("  %s -c --comp-alg lzw --archive-format v2 --solid -i src/ -o src.gsea\n", program_name);
+    printf("  %s --list -i datos.gsea\n", program_name);
+    printf("  %s -d --extract 'config/*.conf' -i datos.gsea -o restaurado/\n", program_name);
 }
\ No newline at end of file
@@ -0,0 +1,616 @@
+#define _GNU_SOURCE     // syscall(), MAP_POPULATE
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/async_io.h"
+
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+/*
+ * Backend io_uring mínimo mediante syscalls directas (sin liburing). Cada
+ * lector/escritor tiene su propio anillo; las operaciones usan READ_FIXED
+ * sobre buffers registrados cuando el kernel lo permite y READV/WRITEV en
+ * caso contrario, disponibles desde Linux 5.1.
+ */
+
+typedef struct {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    size_t sqes_len;
+    unsigned pending_submit;
+} io_ring_t;
+
+static int ring_setup(io_ring_t *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+
+    ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && ring->cq_len > ring->sq_len) {
+        ring->sq_len = ring->cq_len;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+
+    if (single_mmap) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            munmap(ring->sq_ptr, ring->sq_len);
+            close(ring->fd);
+            return -1;
+        }
+    }
+
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (!single_mmap) {
+            munmap(ring->cq_ptr, ring->cq_len);
+        }
+        munmap(ring->sq_ptr, ring->sq_len);
+        close(ring->fd);
+        return -1;
+    }
+
+    unsigned char *sq = (unsigned char *)ring->sq_ptr;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+
+    unsigned char *cq = (unsigned char *)ring->cq_ptr;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+static void ring_teardown(io_ring_t *ring) {
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+}
+
+static struct io_uring_sqe *ring_get_sqe(io_ring_t *ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *ring->sq_tail;
+    if (tail - head >= ring->sq_entries) {
+        return NULL;
+    }
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->pending_submit++;
+    return sqe;
+}
+
+static int ring_enter(io_ring_t *ring, unsigned min_complete) {
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (1) {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->pending_submit,
+                                 min_complete, flags, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        ring->pending_submit -= (unsigned)submitted;
+        return 0;
+    }
+}
+
+/* Espera una finalización. Envía antes las solicitudes pendientes. */
+static int ring_wait(io_ring_t *ring, uint64_t *user_data, int *result) {
+    while (1) {
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            *user_data = cqe->user_data;
+            *result = cqe->res;
+            __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+
+        if (ring_enter(ring, 1) != 0) {
+            return -1;
+        }
+    }
+}
+
+int async_io_available(void) {
+    static int cached = -1;
+    if (cached == -1) {
+        io_ring_t probe;
+        if (ring_setup(&probe, 2) == 0) {
+            ring_teardown(&probe);
+            cached = 1;
+        } else {
+            cached = 0;
+        }
+    }
+    return cached;
+}
+
+/* ---------------------------- Lector ---------------------------- */
+
+typedef struct {
+    off_t offset;
+    size_t length;
+} read_request_t;
+
+typedef struct {
+    unsigned char *buffer;
+    size_t capacity;
+    int registered;     // el buffer actual es el registrado en el kernel
+    int done;
+    int result;
+    struct iovec iov;
+} read_slot_t;
+
+struct async_reader {
+    io_ring_t ring;
+    int fd;
+    unsigned depth;
+    unsigned in_flight;
+    read_slot_t *slots;
+    read_request_t *requests;
+    size_t request_count;
+    size_t request_capacity;
+    size_t next_submit;
+    size_t next_deliver;
+};
+
+async_reader_t *async_reader_open(int fd, size_t slot_size, unsigned depth) {
+    if (!async_io_available() || slot_size == 0 || depth == 0) {
+        return NULL;
+    }
+
+    async_reader_t *reader = (async_reader_t *)calloc(1, sizeof(*reader));
+    if (!reader) {
+        return NULL;
+    }
+
+    if (ring_setup(&reader->ring, depth) != 0) {
+        free(reader);
+        return NULL;
+    }
+
+    reader->fd = fd;
+    reader->depth = depth;
+    reader->slots = (read_slot_t *)calloc(depth, sizeof(read_slot_t));
+    struct iovec *iov = (struct iovec *)calloc(depth, sizeof(struct iovec));
+    if (!reader->slots || !iov) {
+        free(iov);
+        async_reader_close(reader);
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < depth; ++i) {
+        reader->slots[i].buffer = (unsigned char *)malloc(slot_size);
+        if (!reader->slots[i].buffer) {
+            free(iov);
+            async_reader_close(reader);
+            return NULL;
+        }
+        reader->slots[i].capacity = slot_size;
+        iov[i].iov_base = reader->slots[i].buffer;
+        iov[i].iov_len = slot_size;
+    }
+
+    /* Buffers registrados: el kernel los fija una vez y evita mapearlos en cada lectura */
+    int registered = syscall(__NR_io_uring_register, reader->ring.fd,
+                             IORING_REGISTER_BUFFERS, iov, depth) == 0;
+    for (unsigned i = 0; i < depth; ++i) {
+        reader->slots[i].registered = registered;
+    }
+    free(iov);
+    return reader;
+}
+
+int async_reader_enqueue(async_reader_t *reader, off_t offset, size_t length) {
+    if (reader->request_count == reader->request_capacity) {
+        size_t new_capacity = reader->request_capacity == 0 ? 64 : reader->request_capacity * 2;
+        read_request_t *bigger = (read_request_t *)realloc(reader->requests,
+                                                          new_capacity * sizeof(*bigger));
+        if (!bigger) {
+            return -1;
+        }
+        reader->requests = bigger;
+        reader->request_capacity = new_capacity;
+    }
+
+    reader->requests[reader->request_count].offset = offset;
+    reader->requests[reader->request_count].length = length;
+    reader->request_count++;
+    return 0;
+}
+
+static int reader_submit_one(async_reader_t *reader) {
+    size_t request_index = reader->next_submit;
+    read_request_t *request = &reader->requests[request_index];
+    unsigned slot_index = (unsigned)(request_index % reader->depth);
+    read_slot_t *slot = &reader->slots[slot_index];
+
+    if (request->length > slot->capacity) {
+        /* Registro fijo solo cubre la capacidad inicial: crecer sale del modo fijo */
+        unsigned char *bigger = (unsigned char *)malloc(request->length);
+        if (!bigger) {
+            return -1;
+        }
+        free(slot->buffer);
+        slot->buffer = bigger;
+        slot->capacity = request->length;
+        slot->registered = 0;
+    }
+
+    struct io_uring_sqe *sqe = ring_get_sqe(&reader->ring);
+    if (!sqe) {
+        return -1;
+    }
+
+    if (slot->registered) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)slot->buffer;
+        sqe->len = (uint32_t)request->length;
+        sqe->buf_index = (uint16_t)slot_index;
+    } else {
+        slot->iov.iov_base = slot->buffer;
+        slot->iov.iov_len = request->length;
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = (uint64_t)(uintptr_t)&slot->iov;
+        sqe->len = 1;
+    }
+    sqe->fd = reader->fd;
+    sqe->off = (uint64_t)request->offset;
+    sqe->user_data = slot_index;
+
+    slot->done = 0;
+    reader->in_flight++;
+    reader->next_submit++;
+    return 0;
+}
+
+ssize_t async_reader_next(async_reader_t *reader, const unsigned char **data) {
+    if (reader->next_deliver == reader->request_count) {
+        return 0;
+    }
+
+    /* Mantener hasta 'depth' lecturas en vuelo por delante del consumidor */
+    while (reader->next_submit < reader->request_count &&
+           reader->next_submit - reader->next_deliver < reader->depth) {
+        if (reader_submit_one(reader) != 0) {
+            return -1;
+        }
+    }
+
+    unsigned slot_index = (unsigned)(reader->next_deliver % reader->depth);
+    read_slot_t *slot = &reader->slots[slot_index];
+    while (!slot->done) {
+        uint64_t user_data = 0;
+        int result = 0;
+        if (ring_wait(&reader->ring, &user_data, &result) != 0) {
+            return -1;
+        }
+        reader->slots[user_data].done = 1;
+        reader->slots[user_data].result = result;
+        reader->in_flight--;
+    }
+
+    read_request_t *request = &reader->requests[reader->next_deliver];
+    if (slot->result < 0) {
+        errno = -slot->result;
+        return -1;
+    }
+
+    /* Lectura corta: completar de forma síncrona hasta el tamaño pedido o EOF */
+    size_t total = (size_t)slot->result;
+    while (total < request->length) {
+        ssize_t extra = pread(reader->fd, slot->buffer + total, request->length - total,
+                              request->offset + (off_t)total);
+        if (extra == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (extra == 0) {
+            break;
+        }
+        total += (size_t)extra;
+    }
+
+    reader->next_deliver++;
+    *data = slot->buffer;
+    return (ssize_t)total;
+}
+
+void async_reader_close(async_reader_t *reader) {
+    if (!reader) {
+        return;
+    }
+
+    /* No liberar buffers con lecturas todavía en curso en el kernel */
+    while (reader->in_flight > 0) {
+        uint64_t user_data = 0;
+        int result = 0;
+        if (ring_wait(&reader->ring, &user_data, &result) != 0) {
+            break;
+        }
+        reader->in_flight--;
+    }
+
+    if (reader->slots) {
+        for (unsigned i = 0; i < reader->depth; ++i) {
+            free(reader->slots[i].buffer);
+        }
+    }
+    if (reader->ring.fd > 0) {
+        ring_teardown(&reader->ring);
+    }
+    free(reader->slots);
+    free(reader->requests);
+    free(reader);
+}
+
+/* ---------------------------- Escritor ---------------------------- */
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t written;
+    off_t offset;
+    int in_use;
+    struct iovec iov;
+} write_op_t;
+
+struct async_writer {
+    io_ring_t ring;
+    int fd;
+    unsigned depth;
+    unsigned in_flight;
+    write_op_t *ops;
+    int error;
+};
+
+async_writer_t *async_writer_open(int fd, unsigned depth) {
+    if (!async_io_available() || depth == 0) {
+        return NULL;
+    }
+
+    async_writer_t *writer = (async_writer_t *)calloc(1, sizeof(*writer));
+    if (!writer) {
+        return NULL;
+    }
+
+    writer->ops = (write_op_t *)calloc(depth, sizeof(write_op_t));
+    if (!writer->ops || ring_setup(&writer->ring, depth) != 0) {
+        free(writer->ops);
+        free(writer);
+        return NULL;
+    }
+
+    writer->fd = fd;
+    writer->depth = depth;
+    return writer;
+}
+
+static int writer_submit_op(async_writer_t *writer, unsigned op_index) {
+    write_op_t *op = &writer->ops[op_index];
+    struct io_uring_sqe *sqe = ring_get_sqe(&writer->ring);
+    if (!sqe) {
+        return -1;
+    }
+
+    op->iov.iov_base = op->data + op->written;
+    op->iov.iov_len = op->size - op->written;
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = writer->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&op->iov;
+    sqe->len = 1;
+    sqe->off = (uint64_t)(op->offset + (off_t)op->written);
+    sqe->user_data = op_index;
+    writer->in_flight++;
+    return 0;
+}
+
+/* Procesa una finalización: reenvía escrituras cortas y libera las completas. */
+static int writer_reap_one(async_writer_t *writer) {
+    uint64_t user_data = 0;
+    int result = 0;
+    if (ring_wait(&writer->ring, &user_data, &result) != 0) {
+        writer->error = errno;
+        return -1;
+    }
+
+    writer->in_flight--;
+    write_op_t *op = &writer->ops[user_data];
+    if (result < 0) {
+        writer->error = -result;
+    } else {
+        op->written += (size_t)result;
+        if (result > 0 && op->written < op->size && writer->error == 0) {
+            return writer_submit_op(writer, (unsigned)user_data);
+        }
+        if (op->written < op->size && writer->error == 0) {
+            writer->error = EIO;
+        }
+    }
+
+    free(op->data);
+    op->data = NULL;
+    op->in_use = 0;
+    return 0;
+}
+
+int async_writer_write(async_writer_t *writer, unsigned char *data, size_t size, off_t offset) {
+    if (writer->error != 0) {
+        free(data);
+        errno = writer->error;
+        return -1;
+    }
+
+    if (size == 0) {
+        free(data);
+        return 0;
+    }
+
+    unsigned op_index = writer->depth;
+    while (op_index == writer->depth) {
+        for (unsigned i = 0; i < writer->depth; ++i) {
+            if (!writer->ops[i].in_use) {
+                op_index = i;
+                break;
+            }
+        }
+        if (op_index == writer->depth) {
+            if (writer_reap_one(writer) != 0) {
+                free(data);
+                return -1;
+            }
+            if (writer->error != 0) {
+                free(data);
+                errno = writer->error;
+                return -1;
+            }
+        }
+    }
+
+    write_op_t *op = &writer->ops[op_index];
+    op->data = data;
+    op->size = size;
+    op->written = 0;
+    op->offset = offset;
+    op->in_use = 1;
+    if (writer_submit_op(writer, op_index) != 0 || ring_enter(&writer->ring, 0) != 0) {
+        writer->error = errno != 0 ? errno : EIO;
+        return -1;
+    }
+    return 0;
+}
+
+int async_writer_finish(async_writer_t *writer) {
+    if (!writer) {
+        return 0;
+    }
+
+    while (writer->in_flight > 0) {
+        if (writer_reap_one(writer) != 0) {
+            break;
+        }
+    }
+
+    for (unsigned i = 0; i < writer->depth; ++i) {
+        if (writer->ops[i].in_use && writer->in_flight == 0) {
+            free(writer->ops[i].data);
+        }
+    }
+
+    int error = writer->error;
+    ring_teardown(&writer->ring);
+    free(writer->ops);
+    free(writer);
+
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+#else /* !__linux__ */
+
+int async_io_available(void) {
+    return 0;
+}
+
+async_reader_t *async_reader_open(int fd, size_t slot_size, unsigned depth) {
+    (void)fd;
+    (void)slot_size;
+    (void)depth;
+    return NULL;
+}
+
+int async_reader_enqueue(async_reader_t *reader, off_t offset, size_t length) {
+    (void)reader;
+    (void)offset;
+    (void)length;
+    return -1;
+}
+
+ssize_t async_reader_next(async_reader_t *reader, const unsigned char **data) {
+    (void)reader;
+    (void)data;
+    return -1;
+}
+
+void async_reader_close(async_reader_t *reader) {
+    (void)reader;
+}
+
+async_writer_t *async_writer_open(int fd, unsigned depth) {
+    (void)fd;
+    (void)depth;
+    return NULL;
+}
+
+int async_writer_write(async_writer_t *writer, unsigned char *data, size_t size, off_t offset) {
+    (void)writer;
+    (void)size;
+    (void)offset;
+    free(data);
+    return -1;
+}
+
+int async_writer_finish(async_writer_t *writer) {
+    (void)writer;
+    return 0;
+}
+
+#endif
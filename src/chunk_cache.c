@@ -0,0 +1,412 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/chunk_cache.h"
+#include "../include/dedup.h"
+#include "../include/file_manager.h"
+
+/*
+ * Cada entrada es un archivo <dir>/<hh>/<hash>-<alg>-<versión>-<tamaño>:
+ *
+ *   "GSCC" | u32 tamaño_original | u32 tamaño_payload | u64 xxh64(payload) | payload
+ *
+ * Se escribe a un temporal y se renombra, así que varios procesos pueden
+ * compartir la caché. La mtime marca el último uso: un acierto la renueva y la
+ * expulsión borra primero las más antiguas (LRU) hasta quedar en el 90% del
+ * límite. Los recorridos del directorio se hacen sin el mutex, que solo protege
+ * las estadísticas. Solo se guardan resultados de compresión, nunca datos
+ * encriptados.
+ */
+#define CHUNK_CACHE_MAGIC "GSCC"
+#define CHUNK_CACHE_HEADER_SIZE 20
+#define CHUNK_CACHE_CODEC_VERSION 1         // Subir si cambia la salida de algún compresor
+#define CHUNK_CACHE_HASH_SEED 0x9E3779B97F4A7C15ULL
+#define CHUNK_CACHE_TEMP_PREFIX ".tmp-"
+#define CHUNK_CACHE_STALE_TEMP_SECONDS (10 * 60)  // Ninguna escritura en curso tarda tanto
+
+typedef struct {
+    char *path;
+    struct timespec mtime;
+    uint64_t size;
+} cache_file_t;
+
+typedef struct {
+    cache_file_t *files;
+    size_t count;
+    size_t capacity;
+    uint64_t total;
+} cache_scan_t;
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int cache_scanned = 0;
+static int cache_evicting = 0;                  // Un solo hilo recorre y expulsa a la vez
+static uint64_t cache_stored_during_scan = 0;   // Guardado mientras el recorrido no lo veía
+static unsigned long cache_temp_counter = 0;
+static chunk_cache_stats_t cache_stats;
+
+static void store_u32_le(unsigned char *dst, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        dst[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static void store_u64_le(unsigned char *dst, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        dst[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint32_t load_u32_le(const unsigned char *src) {
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static uint64_t load_u64_le(const unsigned char *src) {
+    return (uint64_t)load_u32_le(src) | ((uint64_t)load_u32_le(src + 4) << 32);
+}
+
+static int entry_path(const program_config_t *config, const chunk_cache_key_t *key, char *buffer, size_t length) {
+    int written = snprintf(buffer, length, "%s/%02x/%016llx%016llx-%u-%u-%u", config->cache_dir,
+                           (unsigned)(key->hash_high >> 56), (unsigned long long)key->hash_high,
+                           (unsigned long long)key->hash_low, (unsigned)key->comp_alg,
+                           CHUNK_CACHE_CODEC_VERSION, key->size);
+    return written > 0 && (size_t)written < length ? 0 : -1;
+}
+
+static int scan_add(cache_scan_t *scan, const char *path, const struct stat *st) {
+    if (scan->count == scan->capacity) {
+        size_t capacity = scan->capacity ? scan->capacity * 2 : 256;
+        cache_file_t *files = (cache_file_t *)realloc(scan->files, capacity * sizeof(*files));
+        if (!files) {
+            return -1;
+        }
+        scan->files = files;
+        scan->capacity = capacity;
+    }
+    cache_file_t *file = &scan->files[scan->count];
+    file->path = strdup(path);
+    if (!file->path) {
+        return -1;
+    }
+    file->mtime = st->st_mtim;
+    file->size = (uint64_t)st->st_size;
+    scan->total += file->size;
+    scan->count++;
+    return 0;
+}
+
+static void scan_free(cache_scan_t *scan) {
+    for (size_t i = 0; i < scan->count; i++) {
+        free(scan->files[i].path);
+    }
+    free(scan->files);
+    memset(scan, 0, sizeof(*scan));
+}
+
+/* Temporal que nadie va a renombrar: su proceso murió a medio escribir */
+static void reap_stale_temp(const char *path, const char *name, time_t now) {
+    struct stat st;
+    if (strncmp(name, CHUNK_CACHE_TEMP_PREFIX, strlen(CHUNK_CACHE_TEMP_PREFIX)) == 0 &&
+        stat(path, &st) == 0 && S_ISREG(st.st_mode) &&
+        st.st_mtime + CHUNK_CACHE_STALE_TEMP_SECONDS < now) {
+        unlink(path);
+    }
+}
+
+/* Recorre los dos niveles de la caché; los temporales no cuentan y los abandonados se borran */
+static int scan_cache(const char *cache_dir, cache_scan_t *scan) {
+    memset(scan, 0, sizeof(*scan));
+    DIR *top = opendir(cache_dir);
+    if (!top) {
+        return -1;
+    }
+
+    int status = 0;
+    time_t now = time(NULL);
+    struct dirent *bucket;
+    while (status == 0 && (bucket = readdir(top)) != NULL) {
+        if (bucket->d_name[0] == '.') {
+            continue;
+        }
+        char bucket_path[MAX_PATH_LENGTH];
+        if (snprintf(bucket_path, sizeof(bucket_path), "%s/%s", cache_dir, bucket->d_name) >=
+            (int)sizeof(bucket_path)) {
+            continue;
+        }
+        DIR *dir = opendir(bucket_path);
+        if (!dir) {
+            continue;
+        }
+        struct dirent *item;
+        while (status == 0 && (item = readdir(dir)) != NULL) {
+            char path[MAX_PATH_LENGTH];
+            struct stat st;
+            if (snprintf(path, sizeof(path), "%s/%s", bucket_path, item->d_name) >= (int)sizeof(path)) {
+                continue;
+            }
+            if (item->d_name[0] == '.') {
+                reap_stale_temp(path, item->d_name, now);
+                continue;
+            }
+            if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+                continue;
+            }
+            status = scan_add(scan, path, &st);
+        }
+        closedir(dir);
+    }
+    closedir(top);
+    return status;
+}
+
+static int compare_by_mtime(const void *a, const void *b) {
+    const cache_file_t *left = (const cache_file_t *)a;
+    const cache_file_t *right = (const cache_file_t *)b;
+    if (left->mtime.tv_sec != right->mtime.tv_sec) {
+        return left->mtime.tv_sec < right->mtime.tv_sec ? -1 : 1;
+    }
+    if (left->mtime.tv_nsec != right->mtime.tv_nsec) {
+        return left->mtime.tv_nsec < right->mtime.tv_nsec ? -1 : 1;
+    }
+    return 0;
+}
+
+/* Con el mutex tomado: 1 si este hilo debe expulsar (nadie lo está haciendo ya) */
+static int claim_eviction_locked(const program_config_t *config) {
+    if (cache_evicting || cache_stats.used_bytes <= config->cache_max_bytes) {
+        return 0;
+    }
+    cache_evicting = 1;
+    cache_stored_during_scan = 0;
+    return 1;
+}
+
+/*
+ * Sin el mutex: el recorrido da la ocupación real aunque otros procesos
+ * escriban, y los demás hilos siguen buscando y guardando mientras tanto. Lo
+ * que guardan durante el recorrido se suma al final a lo que queda.
+ */
+static void evict_entries(const program_config_t *config) {
+    cache_scan_t scan;
+    uint64_t evicted = 0;
+    int scanned = scan_cache(config->cache_dir, &scan) == 0;
+    if (scanned) {
+        uint64_t target = config->cache_max_bytes / 10 * 9;
+        qsort(scan.files, scan.count, sizeof(*scan.files), compare_by_mtime);
+        for (size_t i = 0; i < scan.count && scan.total > target; i++) {
+            if (unlink(scan.files[i].path) == 0) {
+                scan.total -= scan.files[i].size;
+                evicted++;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+    if (scanned) {
+        cache_stats.evictions += evicted;
+        cache_stats.used_bytes = scan.total + cache_stored_during_scan;
+    }
+    cache_evicting = 0;
+    pthread_mutex_unlock(&cache_mutex);
+    scan_free(&scan);
+}
+
+/* Primer uso en el proceso: crea el directorio (antes de que nadie guarde) y mide lo que ya ocupa */
+static void ensure_scanned(const program_config_t *config) {
+    pthread_mutex_lock(&cache_mutex);
+    int first = !cache_scanned;
+    cache_scanned = 1;
+    int created = first && create_directory(config->cache_dir) == 0;
+    pthread_mutex_unlock(&cache_mutex);
+    if (!first) {
+        return;
+    }
+    if (!created) {
+        fprintf(stderr, "Advertencia: no se pudo crear la caché '%s'\n", config->cache_dir);
+        return;
+    }
+
+    cache_scan_t scan;
+    int scanned = scan_cache(config->cache_dir, &scan) == 0;
+
+    pthread_mutex_lock(&cache_mutex);
+    if (scanned) {
+        cache_stats.used_bytes += scan.total;
+    }
+    int evict = claim_eviction_locked(config);
+    pthread_mutex_unlock(&cache_mutex);
+    scan_free(&scan);
+    if (evict) {
+        evict_entries(config);
+    }
+}
+
+static void count_miss(void) {
+    pthread_mutex_lock(&cache_mutex);
+    cache_stats.misses++;
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+/* Mayor salida admisible para un chunk, la misma cota que usa la descompresión */
+static size_t max_payload_size(size_t size) {
+    size_t bound = size * 2;
+    return bound < size + 256 ? size + 256 : bound;
+}
+
+static ssize_t read_full(int fd, unsigned char *buffer, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t got = read(fd, buffer + done, size - done);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        done += (size_t)got;
+    }
+    return (ssize_t)done;
+}
+
+int chunk_cache_lookup(const program_config_t *config, const unsigned char *data, size_t size,
+                       chunk_cache_key_t *key, compression_result_t *result) {
+    memset(key, 0, sizeof(*key));
+    key->hash_high = dedup_hash64(data, size, 0);
+    key->hash_low = dedup_hash64(data, size, CHUNK_CACHE_HASH_SEED);
+    key->comp_alg = (unsigned char)config->comp_alg;
+    key->size = (uint32_t)size;
+
+    ensure_scanned(config);
+
+    char path[MAX_PATH_LENGTH];
+    int fd = entry_path(config, key, path, sizeof(path)) == 0 ? open(path, O_RDONLY) : -1;
+    if (fd == -1) {
+        count_miss();
+        return 0;
+    }
+
+    unsigned char header[CHUNK_CACHE_HEADER_SIZE];
+    unsigned char *payload = NULL;
+    uint32_t payload_size = 0;
+    int valid = read_full(fd, header, sizeof(header)) == (ssize_t)sizeof(header) &&
+                memcmp(header, CHUNK_CACHE_MAGIC, 4) == 0 && load_u32_le(header + 4) == size;
+    if (valid) {
+        // El tamaño viene del disco: se acota antes de reservar memoria
+        payload_size = load_u32_le(header + 8);
+        valid = payload_size <= max_payload_size(size);
+    }
+    if (valid) {
+        payload = (unsigned char *)malloc(payload_size ? payload_size : 1);
+        valid = payload != NULL && read_full(fd, payload, payload_size) == (ssize_t)payload_size &&
+                dedup_hash64(payload, payload_size, 0) == load_u64_le(header + 12);
+    }
+    close(fd);
+    if (valid) {
+        /*
+         * Último uso: lo más reciente se expulsa al final. Es orientativo; en
+         * una caché compartida sin permiso de escritura falla y se ignora.
+         */
+        utimensat(AT_FDCWD, path, NULL, 0);
+    }
+
+    if (!valid) {
+        // Entrada corrupta o de otro formato: se descarta y se recalcula
+        free(payload);
+        unlink(path);
+        count_miss();
+        return 0;
+    }
+
+    result->data = payload;
+    result->size = payload_size;
+    result->error = 0;
+    pthread_mutex_lock(&cache_mutex);
+    cache_stats.hits++;
+    cache_stats.bytes_saved += size;
+    pthread_mutex_unlock(&cache_mutex);
+    return 1;
+}
+
+void chunk_cache_store(const program_config_t *config, const chunk_cache_key_t *key,
+                       const compression_result_t *result) {
+    char path[MAX_PATH_LENGTH];
+    char temp_path[MAX_PATH_LENGTH];
+    if (result->size > UINT32_MAX || result->size > max_payload_size(key->size) ||
+        entry_path(config, key, path, sizeof(path)) != 0) {
+        return;
+    }
+
+    char *slash = strrchr(path, '/');
+    *slash = '\0';
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        return;
+    }
+    *slash = '/';
+
+    pthread_mutex_lock(&cache_mutex);
+    unsigned long counter = cache_temp_counter++;
+    pthread_mutex_unlock(&cache_mutex);
+    if (snprintf(temp_path, sizeof(temp_path), "%.*s/" CHUNK_CACHE_TEMP_PREFIX "%ld-%lu", (int)(slash - path),
+                 path, (long)getpid(), counter) >= (int)sizeof(temp_path)) {
+        return;
+    }
+
+    unsigned char header[CHUNK_CACHE_HEADER_SIZE];
+    memcpy(header, CHUNK_CACHE_MAGIC, 4);
+    store_u32_le(header + 4, key->size);
+    store_u32_le(header + 8, (uint32_t)result->size);
+    store_u64_le(header + 12, dedup_hash64(result->data, result->size, 0));
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd == -1) {
+        return;
+    }
+    int ok = write_full(fd, header, sizeof(header)) == 0 && write_full(fd, result->data, result->size) == 0;
+    close(fd);
+    if (!ok || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        return;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+    cache_stats.stores++;
+    cache_stats.used_bytes += sizeof(header) + result->size;
+    cache_stored_during_scan += sizeof(header) + result->size;
+    int evict = claim_eviction_locked(config);
+    pthread_mutex_unlock(&cache_mutex);
+    if (evict) {
+        evict_entries(config);
+    }
+}
+
+void chunk_cache_get_stats(chunk_cache_stats_t *stats) {
+    pthread_mutex_lock(&cache_mutex);
+    *stats = cache_stats;
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void chunk_cache_report(const program_config_t *config) {
+    chunk_cache_stats_t stats;
+    chunk_cache_get_stats(&stats);
+    uint64_t lookups = stats.hits + stats.misses;
+    if (lookups == 0) {
+        return;
+    }
+    printf("Caché de compresión: %llu aciertos, %llu fallos (%.1f%% de aciertos), %llu bytes sin recomprimir\n",
+           (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+           (double)stats.hits * 100.0 / (double)lookups, (unsigned long long)stats.bytes_saved);
+    printf("  %llu entradas nuevas, %llu expulsadas (LRU); ocupa %llu de %llu bytes en '%s'\n",
+           (unsigned long long)stats.stores, (unsigned long long)stats.evictions,
+           (unsigned long long)stats.used_bytes, (unsigned long long)config->cache_max_bytes,
+           config->cache_dir);
+}
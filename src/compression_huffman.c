@@ -315,6 +315,7 @@ compression_result_t compress_small_file(const unsigned char *input, size_t inpu
     }
     
     HuffmanHeader header;
+    memset(&header, 0, sizeof(header));  // sin basura en el relleno tras magic
     memcpy(header.magic, "SMAL", 4); // Magic diferente para archivos pequeños
     header.original_size = input_size;
     header.table_size = 0;
@@ -445,6 +446,7 @@ compression_result_t compress_huffman(const unsigned char *input, size_t input_s
     
     // Paso 6: Crear archivo comprimido final
     HuffmanHeader header;
+    memset(&header, 0, sizeof(header));  // sin basura en el relleno tras magic
     memcpy(header.magic, HUFFMAN_MAGIC, 4);
     header.original_size = input_size;
     header.table_size = table_size;
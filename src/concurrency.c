@@ -5,15 +5,34 @@
 #include <pthread.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
 #include "../include/concurrency.h"
 #include "../include/file_manager.h"
 #include "../include/operations.h"
 #include "../include/dir_utils.h"
+#include "../include/archive.h"
+#include "../include/manifest.h"
 
 int process_file_operations(const program_config_t *config, const char *input_path, const char *output_path) {
     return execute_file_pipeline(config, input_path, output_path);
 }
 
+static double monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void account_task_time(thread_data_t *data, double start) {
+    double elapsed = monotonic_seconds() - start;
+    data->busy_seconds += elapsed;
+    if (elapsed > data->longest_task) {
+        data->longest_task = elapsed;
+    }
+}
+
 void* process_single_file(void *arg) {
     thread_data_t *data = (thread_data_t *)arg;
     
@@ -34,57 +53,113 @@ void* process_single_file(void *arg) {
     return NULL;
 }
 
-char* generate_output_path(const char *input_path, const char *output_dir, const program_config_t *config) {
-    // Obtener el nombre del archivo sin la ruta
-    const char *filename = strrchr(input_path, '/');
-    if (filename == NULL) {
-        filename = input_path;
-    } else {
-        filename++; // Saltar el '/'
+/* Ruta de un archivo relativa al directorio de entrada (su nombre si está fuera de él) */
+static const char *relative_input_path(const char *input_path, const char *base_dir) {
+    size_t base_len = strlen(base_dir);
+    while (base_len > 1 && base_dir[base_len - 1] == '/') {
+        base_len--;
     }
-    
-    // Determinar extensión basada en las operaciones
-    const char *extension = "";
-    if ((config->operations & OP_COMPRESS) && (config->operations & OP_ENCRYPT)) {
-        extension = ".gsea";
-    } else if (config->operations & OP_COMPRESS) {
-        extension = ".rle";
-    } else if (config->operations & OP_ENCRYPT) {
-        extension = ".enc";
-    } else if (config->operations & OP_DECOMPRESS) {
-        extension = ".txt"; // Asumir texto para descompresión
-    } else if (config->operations & OP_DECRYPT) {
-        extension = ".dec";
+
+    if (base_len > 0 && strncmp(input_path, base_dir, base_len) == 0 && input_path[base_len] == '/') {
+        const char *relative = input_path + base_len;
+        while (*relative == '/') {
+            relative++;
+        }
+        return relative;
+    }
+
+    const char *filename = strrchr(input_path, '/');
+    return filename != NULL ? filename + 1 : input_path;
+}
+
+/*
+ * Salida de un archivo en el árbol espejo: misma ruta relativa bajo output_dir.
+ * Las operaciones directas añaden la extensión de la salida (.rle, .lzw, .huff,
+ * .enc, .gsea) y las inversas la quitan si el archivo la tiene.
+ */
+char* generate_output_path(const char *input_path, const char *output_dir, const program_config_t *config) {
+    const char *relative = relative_input_path(input_path, config->input_path);
+    size_t relative_len = strlen(relative);
+
+    const char *extension = get_auto_extension(config);
+    const char *reverse = get_reverse_extension(config);
+    size_t reverse_len = strlen(reverse);
+    if (reverse_len > 0 && relative_len > reverse_len &&
+        strcmp(relative + relative_len - reverse_len, reverse) == 0) {
+        relative_len -= reverse_len;
     }
     
     // Construir ruta completa
-    size_t path_len = strlen(output_dir) + strlen(filename) + strlen(extension) + 2;
+    size_t path_len = strlen(output_dir) + relative_len + strlen(extension) + 2;
     char *output_path = (char *)malloc(path_len);
     if (output_path == NULL) {
         return NULL;
     }
     
-    snprintf(output_path, path_len, "%s/%s%s", output_dir, filename, extension);
+    snprintf(output_path, path_len, "%s/%.*s%s", output_dir, (int)relative_len, relative, extension);
     return output_path;
 }
 
+/*
+ * Crea de antemano los subdirectorios del árbol de salida: create_directory()
+ * no es segura si varios hilos crean el mismo directorio a la vez.
+ */
+static int prepare_output_tree(const program_config_t *config, const FileList *files) {
+    char last_parent[MAX_PATH_LENGTH] = "";
+
+    for (size_t i = 0; i < files->count; i++) {
+        char *output = generate_output_path(files->paths[i], config->output_path, config);
+        if (output == NULL) {
+            return -1;
+        }
+
+        char *slash = strrchr(output, '/');
+        if (slash != NULL && slash != output) {
+            *slash = '\0';
+            if (strcmp(output, last_parent) != 0) {
+                if (create_directory(output) != 0) {
+                    free(output);
+                    return -1;
+                }
+                snprintf(last_parent, sizeof(last_parent), "%s", output);
+            }
+        }
+        free(output);
+    }
+    return 0;
+}
+
 int init_thread_pool(thread_pool_t *pool, int num_threads) {
+    memset(pool, 0, sizeof(*pool));
+
     pool->threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
     if (pool->threads == NULL) {
         return -1;
     }
     
-    pool->thread_data = (thread_data_t *)malloc(sizeof(thread_data_t) * num_threads);
+    pool->thread_data = (thread_data_t *)calloc(num_threads, sizeof(thread_data_t));
     if (pool->thread_data == NULL) {
         free(pool->threads);
         return -1;
     }
+
+    pool->deques = (task_deque_t *)calloc(num_threads, sizeof(task_deque_t));
+    if (pool->deques == NULL) {
+        free(pool->threads);
+        free(pool->thread_data);
+        return -1;
+    }
     
     if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
         free(pool->threads);
         free(pool->thread_data);
+        free(pool->deques);
         return -1;
     }
+    pthread_cond_init(&pool->work_available, NULL);
+    for (int i = 0; i < num_threads; i++) {
+        pthread_mutex_init(&pool->deques[i].mutex, NULL);
+    }
     
     pool->num_threads = num_threads;
     pool->active_threads = 0;
@@ -99,15 +174,883 @@ void free_thread_pool(thread_pool_t *pool) {
     if (pool->thread_data != NULL) {
         free(pool->thread_data);
     }
+    if (pool->deques != NULL) {
+        for (int i = 0; i < pool->num_threads; i++) {
+            free(pool->deques[i].tasks);
+            free(pool->deques[i].priorities);
+            pthread_mutex_destroy(&pool->deques[i].mutex);
+        }
+        free(pool->deques);
+    }
+    pthread_cond_destroy(&pool->work_available);
     pthread_mutex_destroy(&pool->mutex);
 }
 
+int default_thread_count(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) {
+        return 1;
+    }
+    return cpus > MAX_THREADS ? MAX_THREADS : (int)cpus;
+}
+
+/* Hilos a crear: --threads o CPUs en línea, nunca más que trabajos */
+int resolve_thread_count(const program_config_t *config, size_t job_count) {
+    int threads = config->num_threads > 0 ? config->num_threads : default_thread_count();
+    if (job_count < (size_t)threads) {
+        threads = (int)job_count;
+    }
+    return threads > 0 ? threads : 1;
+}
+
+/* Siguiente posición de la cola compartida; 0 cuando se vació */
+static int pool_next_index(thread_pool_t *pool, size_t *index) {
+    int found = 0;
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->next_index < pool->queue->count) {
+        *index = pool->next_index++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return found;
+}
+
+static void *pool_worker(void *arg) {
+    thread_data_t *data = (thread_data_t *)arg;
+
+    size_t index;
+    while (pool_next_index(data->pool, &index)) {
+        char *path = data->pool->queue->paths[index];
+        data->input_file = path;
+        data->output_file = generate_output_path(path, data->config->output_path, data->config);
+        if (data->output_file == NULL) {
+            fprintf(stderr, "Error: No se pudo generar ruta de salida para '%s'\n", path);
+            data->files_failed++;
+            continue;
+        }
+
+        double start = monotonic_seconds();
+        process_single_file(data);
+        account_task_time(data, start);
+        if (data->success) {
+            data->files_ok++;
+        } else {
+            data->files_failed++;
+        }
+
+        free(data->output_file);
+        data->output_file = NULL;
+    }
+
+    return NULL;
+}
+
+/* Como pool_worker, pero cada archivo lo procesa la tarea que pasó el llamador */
+static void *task_pool_worker(void *arg) {
+    thread_data_t *data = (thread_data_t *)arg;
+    thread_pool_t *pool = data->pool;
+
+    size_t index;
+    while (pool_next_index(pool, &index)) {
+        double start = monotonic_seconds();
+        int rc = pool->task(pool->task_context, pool->queue->paths[index], index);
+        account_task_time(data, start);
+        if (rc == 0) {
+            data->files_ok++;
+        } else {
+            data->files_failed++;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Planificador con robo de trabajo. Cada hilo tiene su cola doble de trabajos
+ * y, cuando se vacía, roba del principio de la cola de otro hilo. Un archivo
+ * mayor que un chunk que solo se comprime se reparte: quien tiene el trabajo
+ * reclama el siguiente chunk, devuelve el trabajo a su cola (donde otro hilo
+ * libre puede robarlo) y comprime el chunk reclamado. Los chunks se escriben
+ * en orden con el escritor de streams, así que la salida es idéntica a la
+ * secuencial; como mucho 'window' chunks esperan en memoria a los anteriores.
+ */
+#define STEAL_WINDOW_PER_THREAD 2
+
+typedef struct {
+    compression_result_t result;
+    int state;              // 0 pendiente, 1 comprimido, 2 chunk de ceros
+} chunk_slot_t;
+
+struct file_job {
+    char *input_path;
+    char *output_path;
+    off_t size;             // Tamaño capturado al recorrer el directorio
+    int split;
+    int started;
+    pthread_mutex_t mutex;
+    pthread_cond_t progress;
+    file_mapping_t mapping;
+    chunk_stream_writer_t *writer;
+    size_t chunk_size;
+    size_t chunk_count;
+    size_t next_chunk;      // Siguiente chunk sin reclamar
+    size_t next_write;      // Siguiente chunk a escribir
+    size_t delivered;       // Chunks reclamados que ya terminaron
+    chunk_slot_t *slots;    // Ventana circular de resultados por escribir
+    size_t window;
+    int queued;             // El trabajo está en una cola o en manos de un hilo
+    int failed;
+    int finalized;
+};
+
+/*
+ * Colas circulares. Los trabajos se reparten ordenados de mayor a menor
+ * tamaño y tanto el dueño como los ladrones toman del principio, así que
+ * siempre se empieza por lo más grande (LPT). Un archivo ya repartido por
+ * chunks vuelve al principio: terminar lo empezado tiene prioridad.
+ */
+static int deque_push(thread_pool_t *pool, int owner, file_job_t *job, int front) {
+    task_deque_t *deque = &pool->deques[owner];
+    /* Solo vuelve al principio un trabajo ya empezado; la prioridad se fija aquí
+     * para que los ladrones no lean el estado del trabajo, que es de su dueño */
+    long long priority = front ? LLONG_MAX : (long long)job->size;
+
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count == deque->capacity) {
+        size_t capacity = deque->capacity ? deque->capacity * 2 : 16;
+        file_job_t **tasks = (file_job_t **)malloc(capacity * sizeof(*tasks));
+        long long *priorities = (long long *)malloc(capacity * sizeof(*priorities));
+        if (tasks == NULL || priorities == NULL) {
+            free(tasks);
+            free(priorities);
+            pthread_mutex_unlock(&deque->mutex);
+            return -1;
+        }
+        for (size_t i = 0; i < deque->count; i++) {
+            tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+            priorities[i] = deque->priorities[(deque->head + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        free(deque->priorities);
+        deque->tasks = tasks;
+        deque->priorities = priorities;
+        deque->capacity = capacity;
+        deque->head = 0;
+    }
+    size_t slot;
+    if (front) {
+        deque->head = (deque->head + deque->capacity - 1) % deque->capacity;
+        slot = deque->head;
+    } else {
+        slot = (deque->head + deque->count) % deque->capacity;
+    }
+    deque->tasks[slot] = job;
+    deque->priorities[slot] = priority;
+    deque->count++;
+    pthread_mutex_unlock(&deque->mutex);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->pending_tasks++;
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+static file_job_t *deque_take(thread_pool_t *pool, int index) {
+    task_deque_t *deque = &pool->deques[index];
+    file_job_t *job = NULL;
+
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count > 0) {
+        job = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+
+    if (job != NULL) {
+        pthread_mutex_lock(&pool->mutex);
+        pool->pending_tasks--;
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    return job;
+}
+
+/* Prioridad del primer trabajo de una cola (-1 si está vacía) */
+static long long deque_front_priority(thread_pool_t *pool, int index) {
+    task_deque_t *deque = &pool->deques[index];
+    long long priority = -1;
+
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count > 0) {
+        priority = deque->priorities[deque->head];
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    return priority;
+}
+
+/* Tarea propia o, si no hay, robada de la cola cuyo primer trabajo es el mayor */
+static file_job_t *next_task(thread_pool_t *pool, thread_data_t *data) {
+    file_job_t *job = deque_take(pool, data->thread_id);
+    while (job == NULL) {
+        int victim = -1;
+        long long best = -1;
+        for (int i = 1; i < pool->num_threads; i++) {
+            int index = (data->thread_id + i) % pool->num_threads;
+            long long priority = deque_front_priority(pool, index);
+            if (priority > best) {
+                best = priority;
+                victim = index;
+            }
+        }
+        if (victim < 0) {
+            break;
+        }
+        /* Si otro hilo se adelantó, se vuelve a elegir víctima */
+        job = deque_take(pool, victim);
+        if (job != NULL) {
+            data->tasks_stolen++;
+        }
+    }
+    return job;
+}
+
+static void job_done(thread_pool_t *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->jobs_remaining--;
+    if (pool->jobs_remaining == 0) {
+        pthread_cond_broadcast(&pool->work_available);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void run_whole_job(thread_pool_t *pool, thread_data_t *data, file_job_t *job) {
+    data->input_file = job->input_path;
+    data->output_file = job->output_path;
+    process_single_file(data);
+    if (data->success) {
+        data->files_ok++;
+    } else {
+        data->files_failed++;
+    }
+    data->input_file = NULL;
+    data->output_file = NULL;
+    job_done(pool);
+}
+
+static int start_chunked_job(const program_config_t *config, file_job_t *job, int num_threads) {
+    if (map_file_readonly(job->input_path, &job->mapping) != 0) {
+        return -1;
+    }
+
+    job->chunk_count = (job->mapping.size + job->chunk_size - 1) / job->chunk_size;
+    job->window = (size_t)num_threads * STEAL_WINDOW_PER_THREAD;
+    job->slots = (chunk_slot_t *)calloc(job->window, sizeof(chunk_slot_t));
+
+    if (job->slots != NULL) {
+        job->writer = chunk_stream_writer_open(config, job->output_path, job->chunk_size);
+    }
+    if (job->slots == NULL || job->writer == NULL) {
+        free(job->slots);
+        job->slots = NULL;
+        unmap_file(&job->mapping);
+        return -1;
+    }
+    return 0;
+}
+
+static void finish_chunked_job(thread_pool_t *pool, thread_data_t *data, file_job_t *job) {
+    for (size_t i = 0; i < job->window; i++) {
+        if (job->slots[i].state == 1) {
+            free_compression_result(&job->slots[i].result);
+        }
+    }
+
+    int status = chunk_stream_writer_close(job->writer, !job->failed);
+    job->writer = NULL;
+    unmap_file(&job->mapping);
+    free(job->slots);
+    job->slots = NULL;
+
+    if (status == 0) {
+        data->files_ok++;
+        printf("Hilo %d: ✓ Completado '%s' (%zu chunks)\n",
+               data->thread_id, job->input_path, job->chunk_count);
+    } else {
+        data->files_failed++;
+        fprintf(stderr, "Hilo %d: ✗ Falló '%s'\n", data->thread_id, job->input_path);
+    }
+    job_done(pool);
+}
+
+/* Con el mutex del trabajo: ¿terminó todo lo reclamado y no queda nada más por hacer? */
+static int chunked_job_finished(file_job_t *job) {
+    if (job->finalized || job->queued || job->delivered != job->next_chunk) {
+        return 0;
+    }
+    if (!job->failed && job->next_write < job->chunk_count) {
+        return 0;
+    }
+    job->finalized = 1;
+    return 1;
+}
+
+/* Escribe en orden los chunks consecutivos ya comprimidos (con el mutex del trabajo) */
+static void flush_ready_chunks(file_job_t *job) {
+    while (!job->failed && job->next_write < job->chunk_count) {
+        chunk_slot_t *slot = &job->slots[job->next_write % job->window];
+        if (slot->state == 0) {
+            break;
+        }
+
+        size_t offset = job->next_write * job->chunk_size;
+        size_t size = job->mapping.size - offset < job->chunk_size ?
+                      job->mapping.size - offset : job->chunk_size;
+        if (chunk_stream_writer_append(job->writer, size,
+                                       slot->state == 1 ? &slot->result : NULL) != 0) {
+            job->failed = 1;
+        }
+        slot->state = 0;
+        job->next_write++;
+    }
+    pthread_cond_broadcast(&job->progress);
+}
+
+static void run_chunk_task(thread_pool_t *pool, thread_data_t *data, file_job_t *job) {
+    int hold;
+    do {
+        hold = 0;
+        pthread_mutex_lock(&job->mutex);
+        while (!job->failed && job->next_chunk < job->chunk_count &&
+               job->next_chunk - job->next_write >= job->window) {
+            pthread_cond_wait(&job->progress, &job->mutex);
+        }
+
+        if (job->failed || job->next_chunk >= job->chunk_count) {
+            job->queued = 0;
+            int finished = chunked_job_finished(job);
+            pthread_mutex_unlock(&job->mutex);
+            if (finished) {
+                finish_chunked_job(pool, data, job);
+            }
+            return;
+        }
+
+        size_t index = job->next_chunk++;
+        job->queued = job->next_chunk < job->chunk_count;
+        int requeue = job->queued;
+        pthread_mutex_unlock(&job->mutex);
+
+        /* El resto del archivo vuelve a la cola para que otro hilo libre lo robe;
+         * si la cola no puede crecer, este hilo sigue con él */
+        if (requeue && deque_push(pool, data->thread_id, job, 1) != 0) {
+            hold = 1;
+        }
+
+        size_t offset = index * job->chunk_size;
+        size_t size = job->mapping.size - offset < job->chunk_size ?
+                      job->mapping.size - offset : job->chunk_size;
+        compression_result_t result = {NULL, 0, 0};
+        int rc = compress_stream_chunk(data->config, job->mapping.data + offset, size, &result);
+        data->chunks_done++;
+
+        pthread_mutex_lock(&job->mutex);
+        job->delivered++;
+        if (rc < 0) {
+            job->failed = 1;
+        } else if (job->failed) {
+            free_compression_result(&result);
+        } else {
+            chunk_slot_t *slot = &job->slots[index % job->window];
+            slot->result = result;
+            slot->state = rc == 1 ? 2 : 1;
+        }
+        flush_ready_chunks(job);
+        int finished = chunked_job_finished(job);
+        pthread_mutex_unlock(&job->mutex);
+
+        if (finished) {
+            finish_chunked_job(pool, data, job);
+        }
+    } while (hold);
+}
+
+static void run_job(thread_pool_t *pool, thread_data_t *data, file_job_t *job) {
+    if (!job->started) {
+        job->started = 1;
+        if (!job->split || start_chunked_job(data->config, job, pool->num_threads) != 0) {
+            run_whole_job(pool, data, job);
+            return;
+        }
+        printf("Hilo %d: Procesando '%s' → '%s' en %zu chunks\n",
+               data->thread_id, job->input_path, job->output_path, job->chunk_count);
+        job->queued = 1;
+    }
+    run_chunk_task(pool, data, job);
+}
+
+static void *steal_worker(void *arg) {
+    thread_data_t *data = (thread_data_t *)arg;
+    thread_pool_t *pool = data->pool;
+
+    for (;;) {
+        file_job_t *job = next_task(pool, data);
+        if (job != NULL) {
+            double start = monotonic_seconds();
+            run_job(pool, data, job);
+            account_task_time(data, start);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->pending_tasks <= 0 && pool->jobs_remaining > 0) {
+            pthread_cond_wait(&pool->work_available, &pool->mutex);
+        }
+        int done = pool->jobs_remaining == 0;
+        pthread_mutex_unlock(&pool->mutex);
+        if (done) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/* Solo la compresión pura de archivos de más de un chunk se reparte por chunks */
+static int job_can_split(const program_config_t *config, off_t size, size_t chunk_size) {
+    return config->operations == OP_COMPRESS && !config->direct_io &&
+           size > (off_t)chunk_size;
+}
+
+static file_job_t *create_jobs(const program_config_t *config, const FileList *files,
+                               size_t *work_units) {
+    file_job_t *jobs = (file_job_t *)calloc(files->count, sizeof(file_job_t));
+    if (jobs == NULL) {
+        return NULL;
+    }
+
+    size_t chunk_size = stream_chunk_size();
+    *work_units = 0;
+    for (size_t i = 0; i < files->count; i++) {
+        file_job_t *job = &jobs[i];
+        job->input_path = files->paths[i];
+        job->output_path = generate_output_path(files->paths[i], config->output_path, config);
+        job->chunk_size = chunk_size;
+        pthread_mutex_init(&job->mutex, NULL);
+        pthread_cond_init(&job->progress, NULL);
+
+        job->size = files->sizes[i];
+        job->split = job_can_split(config, job->size, chunk_size);
+        *work_units += job->split ? ((size_t)job->size + chunk_size - 1) / chunk_size : 1;
+    }
+    return jobs;
+}
+
+static void free_jobs(file_job_t *jobs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(jobs[i].output_path);
+        pthread_mutex_destroy(&jobs[i].mutex);
+        pthread_cond_destroy(&jobs[i].progress);
+    }
+    free(jobs);
+}
+
+// Resultados agregados de un procesamiento de directorio
+typedef struct {
+    size_t success_count;
+    size_t error_count;
+    double busy_seconds;
+    double longest_task;
+} directory_totals_t;
+
+static void collect_totals(const thread_pool_t *pool, directory_totals_t *totals) {
+    for (int i = 0; i < pool->num_threads; i++) {
+        const thread_data_t *data = &pool->thread_data[i];
+        totals->success_count += data->files_ok;
+        totals->error_count += data->files_failed;
+        totals->busy_seconds += data->busy_seconds;
+        if (data->longest_task > totals->longest_task) {
+            totals->longest_task = data->longest_task;
+        }
+    }
+}
+
+/* Reparte los archivos (ya ordenados de mayor a menor) entre las colas de los hilos */
+static int run_work_stealing(const program_config_t *config, const FileList *files,
+                             directory_totals_t *totals) {
+    size_t work_units = 0;
+    file_job_t *jobs = create_jobs(config, files, &work_units);
+    if (jobs == NULL) {
+        fprintf(stderr, "Error: No se pudo preparar la lista de trabajos\n");
+        return -1;
+    }
+
+    /* Un archivo grande aporta una tarea por chunk: puede ocupar a todos los hilos */
+    thread_pool_t thread_pool;
+    int num_threads = resolve_thread_count(config, work_units);
+    if (init_thread_pool(&thread_pool, num_threads) != 0) {
+        fprintf(stderr, "Error: No se pudo inicializar el pool de hilos\n");
+        free_jobs(jobs, files->count);
+        return -1;
+    }
+    thread_pool.jobs_remaining = files->count;
+
+    for (size_t i = 0; i < files->count; i++) {
+        if (jobs[i].output_path == NULL) {
+            fprintf(stderr, "Error: No se pudo generar ruta de salida para '%s'\n", jobs[i].input_path);
+            thread_pool.thread_data[0].files_failed++;
+            thread_pool.jobs_remaining--;
+        } else if (deque_push(&thread_pool, (int)(i % (size_t)num_threads), &jobs[i], 0) != 0) {
+            fprintf(stderr, "Error: No se pudo encolar '%s'\n", jobs[i].input_path);
+            thread_pool.thread_data[0].files_failed++;
+            thread_pool.jobs_remaining--;
+        }
+    }
+
+    printf("Creando %d hilos trabajadores (robo de trabajo, %zu tareas)...\n", num_threads, work_units);
+
+    for (int i = 0; i < num_threads; i++) {
+        thread_data_t *data = &thread_pool.thread_data[i];
+        data->config = config;
+        data->thread_id = i;
+        data->pool = &thread_pool;
+
+        if (pthread_create(&thread_pool.threads[i], NULL, steal_worker, data) != 0) {
+            fprintf(stderr, "Error: No se pudo crear el hilo trabajador %d\n", i);
+            break;
+        }
+        thread_pool.active_threads++;
+    }
+
+    /* Sin ningún hilo disponible el trabajo se hace en el hilo principal; con
+     * algunos, los que faltan simplemente no roban: sus colas las vacían los demás */
+    if (thread_pool.active_threads == 0) {
+        steal_worker(&thread_pool.thread_data[0]);
+    }
+
+    printf("Esperando a que %d hilos terminen...\n", thread_pool.active_threads);
+
+    for (int i = 0; i < thread_pool.active_threads; i++) {
+        if (pthread_join(thread_pool.threads[i], NULL) != 0) {
+            fprintf(stderr, "Error: No se pudo unir hilo %d\n", i);
+            totals->error_count++;
+        }
+    }
+
+    size_t chunks = 0;
+    size_t stolen = 0;
+    collect_totals(&thread_pool, totals);
+    for (int i = 0; i < num_threads; i++) {
+        chunks += thread_pool.thread_data[i].chunks_done;
+        stolen += thread_pool.thread_data[i].tasks_stolen;
+    }
+    printf("Tareas de chunk: %zu, tareas robadas: %zu\n", chunks, stolen);
+
+    free_jobs(jobs, files->count);
+    free_thread_pool(&thread_pool);
+    return num_threads;
+}
+
+/* Pool con una cola compartida: cada hilo toma el siguiente archivo completo */
+static int run_shared_queue(const program_config_t *config, const FileList *files,
+                            void *(*worker)(void *), file_task_fn task, void *task_context,
+                            directory_totals_t *totals) {
+    thread_pool_t thread_pool;
+    int num_threads = resolve_thread_count(config, files->count);
+    if (init_thread_pool(&thread_pool, num_threads) != 0) {
+        fprintf(stderr, "Error: No se pudo inicializar el pool de hilos\n");
+        return -1;
+    }
+    thread_pool.queue = files;
+    thread_pool.task = task;
+    thread_pool.task_context = task_context;
+    
+    printf("Creando %d hilos trabajadores...\n", num_threads);
+    
+    for (int i = 0; i < num_threads; i++) {
+        thread_data_t *data = &thread_pool.thread_data[i];
+        data->config = config;
+        data->thread_id = i;
+        data->pool = &thread_pool;
+        
+        if (pthread_create(&thread_pool.threads[i], NULL, worker, data) != 0) {
+            fprintf(stderr, "Error: No se pudo crear el hilo trabajador %d\n", i);
+            break;
+        }
+        thread_pool.active_threads++;
+    }
+
+    // Sin ningún hilo disponible el trabajo se hace en el hilo principal
+    if (thread_pool.active_threads == 0) {
+        worker(&thread_pool.thread_data[0]);
+    }
+    
+    printf("Esperando a que %d hilos terminen...\n", thread_pool.active_threads);
+    
+    for (int i = 0; i < thread_pool.active_threads; i++) {
+        if (pthread_join(thread_pool.threads[i], NULL) != 0) {
+            fprintf(stderr, "Error: No se pudo unir hilo %d\n", i);
+            totals->error_count++;
+        }
+    }
+    collect_totals(&thread_pool, totals);
+    
+    free_thread_pool(&thread_pool);
+    return num_threads;
+}
+
+/* Ejecuta task sobre cada archivo de la lista con el pool; devuelve cuántos fallaron o -1 */
+int run_file_pool(const program_config_t *config, const FileList *files,
+                  file_task_fn task, void *task_context) {
+    directory_totals_t totals = {0, 0, 0.0, 0.0};
+    if (files->count == 0) {
+        return 0;
+    }
+    if (run_shared_queue(config, files, task_pool_worker, task, task_context, &totals) < 0) {
+        return -1;
+    }
+    return (int)totals.error_count;
+}
+
+/*
+ * Planificador en streaming (--scheduler stream). El hilo llamante recorre el
+ * árbol y entrega cada archivo a los trabajadores en cuanto lo encuentra, a
+ * través de una ventana circular acotada: si se llena, el recorrido espera.
+ * La compresión empieza con el primer archivo y solo hay en memoria las rutas
+ * de la ventana. El recorrido es el único que crea directorios de salida, así
+ * que no hace falta preparar el árbol de antemano.
+ */
+#define STREAM_WINDOW_PER_THREAD 64
+
+typedef struct {
+    const program_config_t *config;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    char **window;          // Rutas encontradas que ningún hilo ha tomado aún
+    size_t head;
+    size_t count;
+    size_t capacity;
+    int finished;           // El recorrido terminó: vaciada la ventana no llegará nada más
+    thread_data_t *inline_worker;   // Sin hilos, el propio recorrido procesa cada archivo
+    char last_parent[MAX_PATH_LENGTH];
+    size_t files_found;
+    size_t walk_errors;     // Archivos que no llegaron a encolarse
+    double start;
+    double first_file;      // Segundos hasta entregar el primer archivo
+} stream_walk_t;
+
+static void process_stream_file(thread_data_t *data, char *path) {
+    data->input_file = path;
+    data->output_file = generate_output_path(path, data->config->output_path, data->config);
+    if (data->output_file == NULL) {
+        fprintf(stderr, "Error: No se pudo generar ruta de salida para '%s'\n", path);
+        data->files_failed++;
+        return;
+    }
+
+    double start = monotonic_seconds();
+    process_single_file(data);
+    account_task_time(data, start);
+    if (data->success) {
+        data->files_ok++;
+    } else {
+        data->files_failed++;
+    }
+    free(data->output_file);
+    data->output_file = NULL;
+}
+
+static char *stream_pop(stream_walk_t *stream) {
+    pthread_mutex_lock(&stream->mutex);
+    while (stream->count == 0 && !stream->finished) {
+        pthread_cond_wait(&stream->not_empty, &stream->mutex);
+    }
+    char *path = NULL;
+    if (stream->count > 0) {
+        path = stream->window[stream->head];
+        stream->head = (stream->head + 1) % stream->capacity;
+        stream->count--;
+        pthread_cond_signal(&stream->not_full);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    return path;
+}
+
+static void *stream_worker(void *arg) {
+    thread_data_t *data = (thread_data_t *)arg;
+    stream_walk_t *stream = (stream_walk_t *)data->pool->task_context;
+
+    char *path;
+    while ((path = stream_pop(stream)) != NULL) {
+        process_stream_file(data, path);
+        free(path);
+    }
+    return NULL;
+}
+
+/* Crea el directorio de salida del archivo si es distinto del anterior (el recorrido va por directorios) */
+static int stream_prepare_parent(stream_walk_t *stream, const char *path) {
+    char *output = generate_output_path(path, stream->config->output_path, stream->config);
+    if (output == NULL) {
+        return -1;
+    }
+
+    int status = 0;
+    char *slash = strrchr(output, '/');
+    if (slash != NULL && slash != output) {
+        *slash = '\0';
+        if (strcmp(output, stream->last_parent) != 0) {
+            status = create_directory(output);
+            snprintf(stream->last_parent, sizeof(stream->last_parent), "%s", status == 0 ? output : "");
+        }
+    }
+    free(output);
+    return status;
+}
+
+static int stream_visit(void *context, const char *path, size_t path_length, off_t size) {
+    stream_walk_t *stream = (stream_walk_t *)context;
+    (void)size;
+
+    if (manifest_is_own_file(stream->config, path)) {
+        return 0;
+    }
+    stream->files_found++;
+    char *copy = (char *)malloc(path_length + 1);
+    if (copy == NULL || stream_prepare_parent(stream, path) != 0) {
+        fprintf(stderr, "Error: No se pudo preparar la salida de '%s'\n", path);
+        free(copy);
+        stream->walk_errors++;
+        return 0;
+    }
+    memcpy(copy, path, path_length + 1);
+    if (stream->files_found == 1) {
+        stream->first_file = monotonic_seconds() - stream->start;
+    }
+
+    if (stream->inline_worker != NULL) {
+        process_stream_file(stream->inline_worker, copy);
+        free(copy);
+        return 0;
+    }
+
+    pthread_mutex_lock(&stream->mutex);
+    while (stream->count == stream->capacity) {
+        pthread_cond_wait(&stream->not_full, &stream->mutex);
+    }
+    stream->window[(stream->head + stream->count) % stream->capacity] = copy;
+    stream->count++;
+    pthread_cond_signal(&stream->not_empty);
+    pthread_mutex_unlock(&stream->mutex);
+    return 0;
+}
+
+static int process_directory_streaming(const program_config_t *config) {
+    if (create_directory(config->output_path) != 0) {
+        fprintf(stderr, "Error: No se pudo crear directorio de salida '%s'\n", config->output_path);
+        return -1;
+    }
+
+    thread_pool_t thread_pool;
+    int num_threads = resolve_thread_count(config, (size_t)INT_MAX);
+    if (init_thread_pool(&thread_pool, num_threads) != 0) {
+        fprintf(stderr, "Error: No se pudo inicializar el pool de hilos\n");
+        return -1;
+    }
+
+    stream_walk_t stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.config = config;
+    stream.capacity = (size_t)num_threads * STREAM_WINDOW_PER_THREAD;
+    stream.window = (char **)malloc(stream.capacity * sizeof(char *));
+    if (stream.window == NULL) {
+        fprintf(stderr, "Error: No se pudo reservar la ventana de archivos\n");
+        free_thread_pool(&thread_pool);
+        return -1;
+    }
+    pthread_mutex_init(&stream.mutex, NULL);
+    pthread_cond_init(&stream.not_empty, NULL);
+    pthread_cond_init(&stream.not_full, NULL);
+    thread_pool.task_context = &stream;
+
+    printf("Creando %d hilos trabajadores (streaming, ventana de %zu archivos)...\n",
+           num_threads, stream.capacity);
+    for (int i = 0; i < num_threads; i++) {
+        thread_data_t *data = &thread_pool.thread_data[i];
+        data->config = config;
+        data->thread_id = i;
+        data->pool = &thread_pool;
+
+        if (pthread_create(&thread_pool.threads[i], NULL, stream_worker, data) != 0) {
+            fprintf(stderr, "Error: No se pudo crear el hilo trabajador %d\n", i);
+            break;
+        }
+        thread_pool.active_threads++;
+    }
+    // Sin ningún hilo disponible el recorrido procesa cada archivo al encontrarlo
+    if (thread_pool.active_threads == 0) {
+        stream.inline_worker = &thread_pool.thread_data[0];
+    }
+
+    stream.start = monotonic_seconds();
+    int walk_status = walk_directory_tree(config->input_path, stream_visit, &stream);
+
+    pthread_mutex_lock(&stream.mutex);
+    stream.finished = 1;
+    pthread_cond_broadcast(&stream.not_empty);
+    pthread_mutex_unlock(&stream.mutex);
+
+    directory_totals_t totals = {0, 0, 0.0, 0.0};
+    for (int i = 0; i < thread_pool.active_threads; i++) {
+        if (pthread_join(thread_pool.threads[i], NULL) != 0) {
+            fprintf(stderr, "Error: No se pudo unir hilo %d\n", i);
+            totals.error_count++;
+        }
+    }
+    double makespan = monotonic_seconds() - stream.start;
+    collect_totals(&thread_pool, &totals);
+    totals.error_count += stream.walk_errors;
+
+    pthread_cond_destroy(&stream.not_full);
+    pthread_cond_destroy(&stream.not_empty);
+    pthread_mutex_destroy(&stream.mutex);
+    free(stream.window);
+    free_thread_pool(&thread_pool);
+
+    if (walk_status != 0) {
+        fprintf(stderr, "Error: No se pudo recorrer el directorio '%s'\n", config->input_path);
+        return -1;
+    }
+    if (stream.files_found == 0) {
+        printf("No se encontraron archivos en el directorio '%s'\n", config->input_path);
+        return 0;
+    }
+
+    printf("\n=== Resumen de procesamiento concurrente ===\n");
+    printf("Archivos procesados exitosamente: %zu\n", totals.success_count);
+    printf("Archivos con errores: %zu\n", totals.error_count);
+    printf("Total: %zu (con %d hilos)\n", stream.files_found, num_threads);
+    printf("Primer archivo entregado a los %.3fs; makespan: %.3fs\n", stream.first_file, makespan);
+
+    int status = totals.error_count > 0 ? -1 : 0;
+    if (status == 0 && config->durability == DURABILITY_BATCH) {
+        sync_filesystem(config->output_path);
+    }
+    return status;
+}
+
 int process_directory_concurrent(const program_config_t *config) {
     printf("Modo concurrente: Procesando directorio '%s'\n", config->input_path);
+
+    if (config->scheduler == SCHEDULER_STREAMING) {
+        return process_directory_streaming(config);
+    }
     
     // Leer todos los archivos del directorio
     FileList file_list = {0};
-    read_directory_recursive(config->input_path, &file_list);
+    read_directory_parallel(config->input_path, &file_list, config->num_threads);
+    manifest_exclude(config, &file_list);
     
     if (file_list.count == 0) {
         printf("No se encontraron archivos en el directorio '%s'\n", config->input_path);
@@ -119,100 +1062,99 @@ int process_directory_concurrent(const program_config_t *config) {
     // Crear directorio de salida si no existe
     if (create_directory(config->output_path) != 0) {
         fprintf(stderr, "Error: No se pudo crear directorio de salida '%s'\n", config->output_path);
-        
-        // Liberar lista de archivos
-        for (size_t i = 0; i < file_list.count; i++) {
-            free(file_list.paths[i]);
-        }
-        free(file_list.paths);
-        return -1;
-    }
-    
-    // Inicializar pool de hilos
-    thread_pool_t thread_pool;
-    if (init_thread_pool(&thread_pool, file_list.count) != 0) {
-        fprintf(stderr, "Error: No se pudo inicializar el pool de hilos\n");
-        
-        for (size_t i = 0; i < file_list.count; i++) {
-            free(file_list.paths[i]);
-        }
-        free(file_list.paths);
+        free_file_list(&file_list);
         return -1;
     }
-    
-    // Crear hilos para cada archivo
-    int success_count = 0;
-    int error_count = 0;
-    
-    printf("Creando %ld hilos...\n", (long)file_list.count);
-    
-    for (size_t i = 0; i < file_list.count; i++) {
-        thread_data_t *data = &thread_pool.thread_data[i];
-        
-        // Configurar datos del hilo
-        data->config = config;  // Ahora es compatible con const
-        data->input_file = file_list.paths[i];
-        data->thread_id = (int)i;
-        data->success = 0;
-        
-        // Generar ruta de salida
-        data->output_file = generate_output_path(file_list.paths[i], config->output_path, config);
-        if (data->output_file == NULL) {
-            fprintf(stderr, "Error: No se pudo generar ruta de salida para '%s'\n", file_list.paths[i]);
-            error_count++;
-            continue;
+
+    /* --incremental: solo se procesan los archivos nuevos o modificados desde la última vez */
+    char manifest_path[MAX_PATH_LENGTH] = "";
+    manifest_t previous = {0};
+    manifest_t next = {0};
+    if (config->incremental) {
+        manifest_stats_t changes;
+        if (snprintf(manifest_path, sizeof(manifest_path), "%s/%s", config->output_path,
+                     MANIFEST_FILE_NAME) >= (int)sizeof(manifest_path) ||
+            manifest_load(manifest_path, &previous) != 0 ||
+            manifest_filter_files(config, &file_list, &previous, &next, &changes) != 0) {
+            fprintf(stderr, "Error: No se pudo leer el manifiesto '%s'\n", manifest_path);
+            manifest_free(&previous);
+            free_file_list(&file_list);
+            return -1;
         }
-        
-        // Crear hilo
-        if (pthread_create(&thread_pool.threads[i], NULL, process_single_file, data) != 0) {
-            fprintf(stderr, "Error: No se pudo crear hilo para '%s'\n", file_list.paths[i]);
-            free(data->output_file);
-            error_count++;
-            continue;
+        printf("Incremental: %zu sin cambios, %zu solo con metadatos distintos, %zu nuevos, "
+               "%zu modificados, %zu eliminados\n", changes.unchanged, changes.touched,
+               changes.added, changes.modified, changes.removed);
+        if (file_list.count == 0) {
+            int status = manifest_save(manifest_path, &next);
+            if (status == 0) {
+                manifest_remove_stale(config, &previous, &next);
+                printf("Nada que procesar: todas las salidas están al día\n");
+            }
+            manifest_free(&previous);
+            manifest_free(&next);
+            free_file_list(&file_list);
+            return status;
         }
-        
-        thread_pool.active_threads++;
     }
     
-    // Esperar a que todos los hilos terminen
-    printf("Esperando a que %d hilos terminen...\n", thread_pool.active_threads);
+    if (prepare_output_tree(config, &file_list) != 0) {
+        fprintf(stderr, "Error: No se pudo crear el árbol de salida en '%s'\n", config->output_path);
+        manifest_free(&previous);
+        manifest_free(&next);
+        free_file_list(&file_list);
+        return -1;
+    }
+
+    // Los archivos más grandes primero (LPT): ninguno grande queda para el final
+    sort_file_list_by_size(&file_list);
+
+    directory_totals_t totals = {0, 0, 0.0, 0.0};
+    double start = monotonic_seconds();
+    int num_threads;
+    if (config->scheduler == SCHEDULER_SHARED_QUEUE) {
+        num_threads = run_shared_queue(config, &file_list, pool_worker, NULL, NULL, &totals);
+    } else {
+        num_threads = run_work_stealing(config, &file_list, &totals);
+    }
+    double makespan = monotonic_seconds() - start;
     
-    for (size_t i = 0; i < file_list.count; i++) {
-        if (thread_pool.threads[i] != 0) { // Solo unir hilos que fueron creados
-            if (pthread_join(thread_pool.threads[i], NULL) != 0) {
-                fprintf(stderr, "Error: No se pudo unir hilo %ld\n", i);
-                error_count++;
-            } else {
-                if (thread_pool.thread_data[i].success) {
-                    success_count++;
-                } else {
-                    error_count++;
-                }
-            }
-            
-            // Liberar memoria de la ruta de salida
-            if (thread_pool.thread_data[i].output_file != NULL) {
-                free(thread_pool.thread_data[i].output_file);
-            }
-        }
+    size_t total = file_list.count;
+    free_file_list(&file_list);
+    if (num_threads < 0) {
+        manifest_free(&previous);
+        manifest_free(&next);
+        return -1;
     }
     
-    // Liberar recursos
-    for (size_t i = 0; i < file_list.count; i++) {
-        free(file_list.paths[i]);
+    /* Ideal: trabajo repartido a partes iguales, pero nunca menos que la tarea más larga */
+    double ideal = totals.busy_seconds / num_threads;
+    if (ideal < totals.longest_task) {
+        ideal = totals.longest_task;
     }
-    free(file_list.paths);
-    free_thread_pool(&thread_pool);
     
     // Mostrar resumen
     printf("\n=== Resumen de procesamiento concurrente ===\n");
-    printf("Archivos procesados exitosamente: %d\n", success_count);
-    printf("Archivos con errores: %d\n", error_count);
-    printf("Total: %ld\n", (long)file_list.count);
-    
-    if (error_count > 0) {
-        return -1;
+    printf("Archivos procesados exitosamente: %zu\n", totals.success_count);
+    printf("Archivos con errores: %zu\n", totals.error_count);
+    printf("Total: %zu (con %d hilos)\n", total, num_threads);
+    printf("Makespan: %.3fs, ideal: %.3fs", makespan, ideal);
+    if (ideal > 0.0) {
+        printf(" (%.1f%% sobre el ideal)", (makespan - ideal) * 100.0 / ideal);
     }
+    printf("\n");
     
-    return 0;
-}
\ No newline at end of file
+    /* Con errores se conserva el manifiesto anterior: lo fallido se reintenta la próxima vez */
+    int status = totals.error_count > 0 ? -1 : 0;
+    if (status == 0 && config->durability == DURABILITY_BATCH) {
+        sync_filesystem(config->output_path);
+    }
+    if (status == 0 && config->incremental) {
+        status = manifest_save(manifest_path, &next);
+        if (status == 0) {
+            manifest_remove_stale(config, &previous, &next);
+        }
+    }
+    manifest_free(&previous);
+    manifest_free(&next);
+    return status;
+}
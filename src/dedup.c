@@ -0,0 +1,414 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/dedup.h"
+
+#define DEDUP_BUFFER_SIZE (64 * 1024)
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static uint64_t rotl64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t read_le64(const unsigned char *src) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+static uint32_t read_le32(const unsigned char *src) {
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+static uint64_t xxh64_merge_round(uint64_t acc, uint64_t value) {
+    acc ^= xxh64_round(0, value);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+uint64_t dedup_hash64(const void *data, size_t size, uint64_t seed) {
+    const unsigned char *ptr = (const unsigned char *)data;
+    const unsigned char *end = ptr + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        const unsigned char *limit = end - 32;
+        do {
+            v1 = xxh64_round(v1, read_le64(ptr));
+            v2 = xxh64_round(v2, read_le64(ptr + 8));
+            v3 = xxh64_round(v3, read_le64(ptr + 16));
+            v4 = xxh64_round(v4, read_le64(ptr + 24));
+            ptr += 32;
+        } while (ptr <= limit);
+
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = xxh64_merge_round(hash, v1);
+        hash = xxh64_merge_round(hash, v2);
+        hash = xxh64_merge_round(hash, v3);
+        hash = xxh64_merge_round(hash, v4);
+    } else {
+        hash = seed + XXH_PRIME64_5;
+    }
+
+    hash += (uint64_t)size;
+    while (ptr + 8 <= end) {
+        hash ^= xxh64_round(0, read_le64(ptr));
+        hash = rotl64(hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        ptr += 8;
+    }
+    if (ptr + 4 <= end) {
+        hash ^= (uint64_t)read_le32(ptr) * XXH_PRIME64_1;
+        hash = rotl64(hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        ptr += 4;
+    }
+    while (ptr < end) {
+        hash ^= (*ptr) * XXH_PRIME64_5;
+        hash = rotl64(hash, 11) * XXH_PRIME64_1;
+        ptr++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static ssize_t read_full(int fd, unsigned char *buffer, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        ssize_t got = read(fd, buffer + total, size - total);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        total += (size_t)got;
+    }
+    return (ssize_t)total;
+}
+
+/* Cada bloque de 64 KiB se encadena con el hash del anterior como semilla */
+uint64_t dedup_hash_buffer(const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t hash = 0;
+    for (size_t offset = 0; offset < size; offset += DEDUP_BUFFER_SIZE) {
+        size_t length = size - offset < DEDUP_BUFFER_SIZE ? size - offset : DEDUP_BUFFER_SIZE;
+        hash = dedup_hash64(bytes + offset, length, hash);
+    }
+    return hash;
+}
+
+int dedup_hash_file(const char *path, uint64_t *hash_out) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+    unsigned char *buffer = (unsigned char *)malloc(DEDUP_BUFFER_SIZE);
+    if (!buffer) {
+        close(fd);
+        return -1;
+    }
+
+    uint64_t hash = 0;
+    int status = 0;
+    for (;;) {
+        ssize_t got = read_full(fd, buffer, DEDUP_BUFFER_SIZE);
+        if (got < 0) {
+            status = -1;
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        hash = dedup_hash64(buffer, (size_t)got, hash);
+    }
+
+    free(buffer);
+    close(fd);
+    *hash_out = hash;
+    return status;
+}
+
+int files_identical(const char *path_a, const char *path_b) {
+    int fd_a = open(path_a, O_RDONLY);
+    int fd_b = open(path_b, O_RDONLY);
+    unsigned char *buffer = (unsigned char *)malloc(2 * DEDUP_BUFFER_SIZE);
+    int identical = fd_a != -1 && fd_b != -1 && buffer != NULL;
+
+    while (identical) {
+        ssize_t got_a = read_full(fd_a, buffer, DEDUP_BUFFER_SIZE);
+        ssize_t got_b = read_full(fd_b, buffer + DEDUP_BUFFER_SIZE, DEDUP_BUFFER_SIZE);
+        if (got_a < 0 || got_a != got_b ||
+            memcmp(buffer, buffer + DEDUP_BUFFER_SIZE, (size_t)got_a) != 0) {
+            identical = 0;
+        } else if (got_a == 0) {
+            break;
+        }
+    }
+
+    free(buffer);
+    if (fd_a != -1) {
+        close(fd_a);
+    }
+    if (fd_b != -1) {
+        close(fd_b);
+    }
+    return identical;
+}
+
+typedef struct {
+    size_t index;
+    off_t size;
+    uint64_t hash;
+    int hashed;
+} dedup_candidate_t;
+
+static int compare_candidates(const void *a, const void *b) {
+    const dedup_candidate_t *left = (const dedup_candidate_t *)a;
+    const dedup_candidate_t *right = (const dedup_candidate_t *)b;
+    if (left->size != right->size) {
+        return left->size < right->size ? -1 : 1;
+    }
+    if (left->hashed != right->hashed) {
+        return left->hashed < right->hashed ? -1 : 1;
+    }
+    if (left->hash != right->hash) {
+        return left->hash < right->hash ? -1 : 1;
+    }
+    return left->index < right->index ? -1 : (left->index > right->index);
+}
+
+/*
+ * Solo se leen los archivos cuyo tamaño coincide con el de otro; dentro de
+ * cada grupo de igual tamaño y hash, el contenido se compara completo antes
+ * de convertir un archivo en referencia. La primera copia es siempre la de
+ * menor índice, de modo que las referencias apuntan hacia atrás en la lista.
+ */
+int dedup_plan_files(const FileList *files, dedup_plan_t *plan) {
+    memset(plan, 0, sizeof(*plan));
+    size_t count = files->count;
+    plan->original_of = (size_t *)malloc((count ? count : 1) * sizeof(size_t));
+    dedup_candidate_t *candidates = (dedup_candidate_t *)calloc(count ? count : 1, sizeof(*candidates));
+    if (!plan->original_of || !candidates) {
+        free(candidates);
+        dedup_plan_free(plan);
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        plan->original_of[i] = i;
+        candidates[i].index = i;
+        candidates[i].size = files->sizes[i];
+    }
+    qsort(candidates, count, sizeof(*candidates), compare_candidates);
+
+    // Los archivos vacíos no guardan datos: no hay nada que deduplicar
+    for (size_t start = 0; start < count;) {
+        size_t end = start + 1;
+        while (end < count && candidates[end].size == candidates[start].size) {
+            end++;
+        }
+        if (end - start > 1 && candidates[start].size > 0) {
+            for (size_t i = start; i < end; i++) {
+                candidates[i].hashed = dedup_hash_file(files->paths[candidates[i].index],
+                                                       &candidates[i].hash) == 0;
+            }
+        }
+        start = end;
+    }
+    qsort(candidates, count, sizeof(*candidates), compare_candidates);
+
+    for (size_t start = 0; start < count;) {
+        size_t end = start + 1;
+        while (end < count && candidates[end].size == candidates[start].size &&
+               candidates[end].hashed == candidates[start].hashed &&
+               candidates[end].hash == candidates[start].hash) {
+            end++;
+        }
+        for (size_t i = start + 1; candidates[start].hashed && i < end; i++) {
+            size_t index = candidates[i].index;
+            // Un hash repetido con otro contenido solo se compara con las primeras copias
+            for (size_t j = start; j < i; j++) {
+                size_t original = candidates[j].index;
+                if (plan->original_of[original] == original &&
+                    files_identical(files->paths[original], files->paths[index])) {
+                    plan->original_of[index] = original;
+                    plan->duplicates++;
+                    plan->saved_bytes += (uint64_t)candidates[i].size;
+                    break;
+                }
+            }
+        }
+        start = end;
+    }
+
+    free(candidates);
+    return 0;
+}
+
+void dedup_plan_free(dedup_plan_t *plan) {
+    free(plan->original_of);
+    plan->original_of = NULL;
+    plan->duplicates = 0;
+    plan->saved_bytes = 0;
+}
+
+void dedup_report(const dedup_plan_t *plan) {
+    if (plan->duplicates == 0) {
+        return;
+    }
+    printf("Deduplicación: %zu archivos idénticos guardados como referencia (%llu bytes evitados)\n",
+           plan->duplicates, (unsigned long long)plan->saved_bytes);
+}
+
+/*
+ * FastCDC: hash "gear" rodante (un desplazamiento y una suma por byte) con
+ * chunking normalizado. Antes del tamaño medio se exige una máscara con más
+ * bits (corte menos probable) y después una con menos, de modo que los
+ * tamaños se concentran alrededor de CDC_AVG_CHUNK. Máscaras del artículo
+ * original para 8 KiB.
+ */
+#define CDC_MASK_SMALL 0x0003590703530000ULL
+#define CDC_MASK_LARGE 0x0000d90003530000ULL
+
+static uint64_t cdc_gear[256];
+static pthread_once_t cdc_gear_once = PTHREAD_ONCE_INIT;
+
+/* Tabla fija (splitmix64): los cortes deben ser los mismos en cada ejecución */
+static void init_cdc_gear(void) {
+    uint64_t state = 0x6745534541434443ULL;
+    for (int i = 0; i < 256; i++) {
+        state += 0x9E3779B97F4A7C15ULL;
+        uint64_t value = state;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        cdc_gear[i] = value ^ (value >> 31);
+    }
+}
+
+size_t cdc_next_boundary(const unsigned char *data, size_t size) {
+    pthread_once(&cdc_gear_once, init_cdc_gear);
+    if (size <= CDC_MIN_CHUNK) {
+        return size;
+    }
+    if (size > CDC_MAX_CHUNK) {
+        size = CDC_MAX_CHUNK;
+    }
+    size_t normal = size < CDC_AVG_CHUNK ? size : CDC_AVG_CHUNK;
+
+    uint64_t hash = 0;
+    size_t i = CDC_MIN_CHUNK;
+    for (; i < normal; i++) {
+        hash = (hash << 1) + cdc_gear[data[i]];
+        if ((hash & CDC_MASK_SMALL) == 0) {
+            return i + 1;
+        }
+    }
+    for (; i < size; i++) {
+        hash = (hash << 1) + cdc_gear[data[i]];
+        if ((hash & CDC_MASK_LARGE) == 0) {
+            return i + 1;
+        }
+    }
+    return size;
+}
+
+int dedup_index_init(dedup_index_t *index, size_t expected) {
+    size_t capacity = 1024;
+    while (capacity < expected * 2) {
+        capacity <<= 1;
+    }
+    index->hashes = (uint64_t *)malloc(capacity * sizeof(uint64_t));
+    index->ids = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    if (!index->hashes || !index->ids) {
+        dedup_index_free(index);
+        return -1;
+    }
+    memset(index->ids, 0xFF, capacity * sizeof(uint32_t));
+    index->capacity = capacity;
+    index->used = 0;
+    return 0;
+}
+
+uint32_t dedup_index_find(const dedup_index_t *index, uint64_t hash, size_t *cursor) {
+    size_t mask = index->capacity - 1;
+    for (size_t probe = *cursor; probe < index->capacity; probe++) {
+        size_t slot = (size_t)(hash + probe) & mask;
+        if (index->ids[slot] == UINT32_MAX) {
+            break;
+        }
+        if (index->hashes[slot] == hash) {
+            *cursor = probe + 1;
+            return index->ids[slot];
+        }
+    }
+    *cursor = index->capacity;
+    return UINT32_MAX;
+}
+
+static int dedup_index_grow(dedup_index_t *index) {
+    dedup_index_t larger;
+    if (dedup_index_init(&larger, index->capacity) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < index->capacity; i++) {
+        if (index->ids[i] != UINT32_MAX) {
+            dedup_index_insert(&larger, index->hashes[i], index->ids[i]);
+        }
+    }
+    dedup_index_free(index);
+    *index = larger;
+    return 0;
+}
+
+int dedup_index_insert(dedup_index_t *index, uint64_t hash, uint32_t id) {
+    // Carga máxima del 50%: las búsquedas fallidas terminan pronto
+    if ((index->used + 1) * 2 > index->capacity && dedup_index_grow(index) != 0) {
+        return -1;
+    }
+    size_t mask = index->capacity - 1;
+    size_t slot = (size_t)hash & mask;
+    while (index->ids[slot] != UINT32_MAX) {
+        slot = (slot + 1) & mask;
+    }
+    index->hashes[slot] = hash;
+    index->ids[slot] = id;
+    index->used++;
+    return 0;
+}
+
+void dedup_index_free(dedup_index_t *index) {
+    free(index->hashes);
+    free(index->ids);
+    index->hashes = NULL;
+    index->ids = NULL;
+    index->capacity = 0;
+    index->used = 0;
+}
@@ -0,0 +1,454 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/delta.h"
+#include "../include/dedup.h"
+#include "../include/file_manager.h"
+#include "../include/operations.h"
+
+/*
+ * Formato del delta (antes de pasar por los codecs):
+ *
+ *   "GSDL" | u8 versión | 3 reservados | u64 tamaño_base | u64 hash_base
+ *          | u64 tamaño_destino | u64 hash_destino
+ *   operaciones: u8 tipo | COPY: u64 offset_base, u64 longitud
+ *                        | INSERT: u64 longitud, bytes
+ *   END (tipo 0)
+ *
+ * La base se indexa por bloques alineados; el destino se recorre con un hash
+ * rodante de la misma ventana, así que una coincidencia se encuentra en
+ * cualquier posición aunque se hayan insertado o borrado bytes antes. Cada
+ * coincidencia se verifica byte a byte y se extiende hacia ambos lados.
+ */
+#define DELTA_OP_END 0
+#define DELTA_OP_COPY 1
+#define DELTA_OP_INSERT 2
+#define DELTA_IO_BUFFER (1024 * 1024)
+#define DELTA_HASH_PRIME 0x100000001B3ULL
+#define DELTA_MAX_CANDIDATES 8      // Colisiones del hash que se comprueban por posición
+
+typedef struct {
+    FILE *file;
+    delta_stats_t *stats;
+    uint64_t copy_offset;       // COPY pendiente: las contiguas se funden en una
+    uint64_t copy_length;
+    int error;
+} delta_writer_t;
+
+static void store_u64_le(unsigned char *dst, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        dst[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint64_t load_u64_le(const unsigned char *src) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | src[i];
+    }
+    return value;
+}
+
+static void writer_put(delta_writer_t *writer, const void *data, size_t size) {
+    if (!writer->error && size > 0 && fwrite(data, 1, size, writer->file) != size) {
+        writer->error = 1;
+    }
+    writer->stats->delta_size += size;
+}
+
+static void writer_flush_copy(delta_writer_t *writer) {
+    if (writer->copy_length == 0) {
+        return;
+    }
+    unsigned char op[17];
+    op[0] = DELTA_OP_COPY;
+    store_u64_le(op + 1, writer->copy_offset);
+    store_u64_le(op + 9, writer->copy_length);
+    writer_put(writer, op, sizeof(op));
+    writer->stats->copy_ops++;
+    writer->copy_length = 0;
+}
+
+static void emit_copy(delta_writer_t *writer, uint64_t offset, uint64_t length) {
+    writer->stats->copied_bytes += length;
+    if (writer->copy_length > 0 && writer->copy_offset + writer->copy_length == offset) {
+        writer->copy_length += length;
+        return;
+    }
+    writer_flush_copy(writer);
+    writer->copy_offset = offset;
+    writer->copy_length = length;
+}
+
+static void emit_insert(delta_writer_t *writer, const unsigned char *data, uint64_t length) {
+    if (length == 0) {
+        return;
+    }
+    writer_flush_copy(writer);
+    unsigned char op[9];
+    op[0] = DELTA_OP_INSERT;
+    store_u64_le(op + 1, length);
+    writer_put(writer, op, sizeof(op));
+    writer_put(writer, data, (size_t)length);
+    writer->stats->insert_ops++;
+    writer->stats->inserted_bytes += length;
+}
+
+// Bloque del índice: el mínimo que mantiene la base por debajo de DELTA_MAX_INDEX_BLOCKS
+static size_t delta_block_size(size_t base_size) {
+    size_t block = DELTA_MIN_BLOCK;
+    while (base_size / block > DELTA_MAX_INDEX_BLOCKS) {
+        block *= 2;
+    }
+    return block;
+}
+
+static uint64_t window_hash(const unsigned char *data, size_t block) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < block; i++) {
+        hash = hash * DELTA_HASH_PRIME + data[i] + 1;
+    }
+    return hash;
+}
+
+// El hash rodante es polinómico: se mezcla antes de usarlo como clave del índice
+static uint64_t mix_hash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static int index_base(const file_mapping_t *base, size_t block, dedup_index_t *index) {
+    size_t blocks = base->size / block;
+    if (dedup_index_init(index, blocks) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < blocks; i++) {
+        uint64_t key = mix_hash(window_hash(base->data + i * block, block));
+        // Basta la primera aparición de cada contenido (bases con muchos bloques repetidos)
+        size_t cursor = 0;
+        if (dedup_index_find(index, key, &cursor) != UINT32_MAX) {
+            continue;
+        }
+        if (dedup_index_insert(index, key, (uint32_t)i) != 0) {
+            dedup_index_free(index);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void scan_target(const file_mapping_t *base, const file_mapping_t *target, size_t block,
+                        const dedup_index_t *index, delta_writer_t *writer) {
+    size_t pos = 0;
+    size_t pending = 0;     // Inicio de los bytes sin coincidencia aún no emitidos
+    uint64_t power = 1;
+    for (size_t i = 1; i < block; i++) {
+        power *= DELTA_HASH_PRIME;
+    }
+
+    uint64_t hash = target->size >= block ? window_hash(target->data, block) : 0;
+    while (base->size >= block && pos + block <= target->size) {
+        size_t cursor = 0;
+        uint64_t key = mix_hash(hash);
+        size_t match_offset = 0;
+        size_t match_length = 0;
+        for (int tries = 0; tries < DELTA_MAX_CANDIDATES; tries++) {
+            uint32_t id = dedup_index_find(index, key, &cursor);
+            if (id == UINT32_MAX) {
+                break;
+            }
+            size_t offset = (size_t)id * block;
+            if (memcmp(base->data + offset, target->data + pos, block) == 0) {
+                match_offset = offset;
+                match_length = block;
+                break;
+            }
+        }
+
+        if (match_length == 0) {
+            if (pos + block < target->size) {
+                hash = (hash - (uint64_t)(target->data[pos] + 1) * power) * DELTA_HASH_PRIME +
+                       target->data[pos + block] + 1;
+            }
+            pos++;
+            continue;
+        }
+
+        // Extender hacia atrás sobre lo pendiente y hacia delante hasta el primer byte distinto
+        size_t back = 0;
+        while (back < pos - pending && back < match_offset &&
+               base->data[match_offset - back - 1] == target->data[pos - back - 1]) {
+            back++;
+        }
+        while (pos + match_length < target->size && match_offset + match_length < base->size &&
+               base->data[match_offset + match_length] == target->data[pos + match_length]) {
+            match_length++;
+        }
+
+        emit_insert(writer, target->data + pending, pos - back - pending);
+        emit_copy(writer, match_offset - back, match_length + back);
+        pos += match_length;
+        pending = pos;
+        if (pos + block <= target->size) {
+            hash = window_hash(target->data + pos, block);
+        }
+    }
+    emit_insert(writer, target->data + pending, target->size - pending);
+    writer_flush_copy(writer);
+}
+
+int delta_encode(const char *base_path, const char *target_path, const char *delta_path,
+                 delta_stats_t *stats) {
+    file_mapping_t base;
+    file_mapping_t target;
+    memset(&base, 0, sizeof(base));
+    memset(&target, 0, sizeof(target));
+    memset(stats, 0, sizeof(*stats));
+
+    if (map_file_readonly(base_path, &base) != 0) {
+        fprintf(stderr, "Error: No se pudo leer la base del delta '%s'\n", base_path);
+        unmap_file(&base);
+        return -1;
+    }
+    if (map_file_readonly(target_path, &target) != 0) {
+        fprintf(stderr, "Error: No se pudo leer '%s'\n", target_path);
+        unmap_file(&base);
+        unmap_file(&target);
+        return -1;
+    }
+    // Se hashea lo ya mapeado: releer los archivos costaría otra pasada de E/S
+    uint64_t base_hash = dedup_hash_buffer(base.data, base.size);
+    uint64_t target_hash = dedup_hash_buffer(target.data, target.size);
+
+    size_t block = delta_block_size(base.size);
+    dedup_index_t index;
+    if (index_base(&base, block, &index) != 0) {
+        fprintf(stderr, "Error: Memoria insuficiente para indexar la base del delta\n");
+        unmap_file(&base);
+        unmap_file(&target);
+        return -1;
+    }
+
+    FILE *file = fopen(delta_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: No se pudo crear el delta '%s' - %s\n", delta_path, strerror(errno));
+        dedup_index_free(&index);
+        unmap_file(&base);
+        unmap_file(&target);
+        return -1;
+    }
+    setvbuf(file, NULL, _IOFBF, DELTA_IO_BUFFER);
+
+    delta_writer_t writer = {file, stats, 0, 0, 0};
+    unsigned char header[DELTA_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, DELTA_MAGIC, 4);
+    header[4] = DELTA_VERSION;
+    store_u64_le(header + 8, base.size);
+    store_u64_le(header + 16, base_hash);
+    store_u64_le(header + 24, target.size);
+    store_u64_le(header + 32, target_hash);
+    writer_put(&writer, header, sizeof(header));
+
+    scan_target(&base, &target, block, &index, &writer);
+    unsigned char end = DELTA_OP_END;
+    writer_put(&writer, &end, 1);
+
+    int status = writer.error ? -1 : 0;
+    if (fclose(file) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Error: No se pudo escribir el delta '%s'\n", delta_path);
+    }
+
+    dedup_index_free(&index);
+    unmap_file(&base);
+    unmap_file(&target);
+    return status;
+}
+
+static int read_exact(FILE *file, void *buffer, size_t size) {
+    return fread(buffer, 1, size, file) == size ? 0 : -1;
+}
+
+static int apply_ops(FILE *delta, int base_fd, uint64_t base_size, FILE *output, uint64_t *written) {
+    unsigned char *buffer = (unsigned char *)malloc(DELTA_IO_BUFFER);
+    if (!buffer) {
+        return -1;
+    }
+
+    int status = -1;
+    for (;;) {
+        unsigned char op[17];
+        if (read_exact(delta, op, 1) != 0) {
+            break;
+        }
+        if (op[0] == DELTA_OP_END) {
+            status = 0;
+            break;
+        }
+        if (op[0] == DELTA_OP_COPY) {
+            if (read_exact(delta, op + 1, 16) != 0) {
+                break;
+            }
+            uint64_t offset = load_u64_le(op + 1);
+            uint64_t length = load_u64_le(op + 9);
+            if (offset > base_size || length > base_size - offset) {
+                break;
+            }
+            while (length > 0) {
+                size_t piece = length < DELTA_IO_BUFFER ? (size_t)length : DELTA_IO_BUFFER;
+                if (pread(base_fd, buffer, piece, (off_t)offset) != (ssize_t)piece ||
+                    fwrite(buffer, 1, piece, output) != piece) {
+                    goto done;
+                }
+                offset += piece;
+                length -= piece;
+                *written += piece;
+            }
+        } else if (op[0] == DELTA_OP_INSERT) {
+            if (read_exact(delta, op + 1, 8) != 0) {
+                break;
+            }
+            uint64_t length = load_u64_le(op + 1);
+            while (length > 0) {
+                size_t piece = length < DELTA_IO_BUFFER ? (size_t)length : DELTA_IO_BUFFER;
+                if (read_exact(delta, buffer, piece) != 0 || fwrite(buffer, 1, piece, output) != piece) {
+                    goto done;
+                }
+                length -= piece;
+                *written += piece;
+            }
+        } else {
+            break;
+        }
+    }
+done:
+    free(buffer);
+    return status;
+}
+
+int delta_apply(const char *base_path, const char *delta_path, const char *output_path,
+                int sync_to_disk) {
+    FILE *delta = fopen(delta_path, "rb");
+    if (!delta) {
+        fprintf(stderr, "Error: No se pudo abrir el delta '%s'\n", delta_path);
+        return -1;
+    }
+    unsigned char header[DELTA_HEADER_SIZE];
+    if (read_exact(delta, header, sizeof(header)) != 0 || memcmp(header, DELTA_MAGIC, 4) != 0 ||
+        header[4] != DELTA_VERSION) {
+        fprintf(stderr, "Error: '%s' no contiene un delta GSEA válido\n", delta_path);
+        fclose(delta);
+        return -1;
+    }
+    uint64_t base_size = load_u64_le(header + 8);
+    uint64_t base_hash = load_u64_le(header + 16);
+    uint64_t target_size = load_u64_le(header + 24);
+    uint64_t target_hash = load_u64_le(header + 32);
+
+    // Aplicar el delta sobre otra base produciría basura sin ningún error visible
+    struct stat base_stat;
+    uint64_t actual_hash = 0;
+    int base_fd = open(base_path, O_RDONLY);
+    if (base_fd == -1 || fstat(base_fd, &base_stat) != 0 || (uint64_t)base_stat.st_size != base_size ||
+        dedup_hash_file(base_path, &actual_hash) != 0 || actual_hash != base_hash) {
+        fprintf(stderr, "Error: '%s' no es la base con la que se generó el delta\n", base_path);
+        if (base_fd != -1) {
+            close(base_fd);
+        }
+        fclose(delta);
+        return -1;
+    }
+
+    FILE *output = fopen(output_path, "wb");
+    if (!output) {
+        fprintf(stderr, "Error: No se pudo crear '%s' - %s\n", output_path, strerror(errno));
+        close(base_fd);
+        fclose(delta);
+        return -1;
+    }
+    setvbuf(delta, NULL, _IOFBF, DELTA_IO_BUFFER);
+    setvbuf(output, NULL, _IOFBF, DELTA_IO_BUFFER);
+
+    uint64_t written = 0;
+    int status = apply_ops(delta, base_fd, base_size, output, &written);
+    if (fflush(output) != 0 || (status == 0 && sync_to_disk && sync_file_descriptor(fileno(output), output_path) != 0)) {
+        status = -1;
+    }
+    if (fclose(output) != 0) {
+        status = -1;
+    }
+    close(base_fd);
+    fclose(delta);
+
+    uint64_t output_hash = 0;
+    if (status != 0 || written != target_size ||
+        dedup_hash_file(output_path, &output_hash) != 0 || output_hash != target_hash) {
+        fprintf(stderr, "Error: El delta '%s' está dañado o incompleto\n", delta_path);
+        unlink(output_path);
+        return -1;
+    }
+    return 0;
+}
+
+static int create_delta_temp(char *buffer, size_t length) {
+    snprintf(buffer, length, "/tmp/gsea-delta-%d-XXXXXX", getpid());
+    int fd = mkstemp(buffer);
+    if (fd == -1) {
+        fprintf(stderr, "Error: No se pudo crear el archivo temporal del delta\n");
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+int delta_compress_file(const program_config_t *config, const char *input_path, const char *output_path) {
+    char delta_path[64];
+    if (create_delta_temp(delta_path, sizeof(delta_path)) != 0) {
+        return -1;
+    }
+
+    delta_stats_t stats;
+    if (delta_encode(config->delta_base, input_path, delta_path, &stats) != 0) {
+        unlink(delta_path);
+        return -1;
+    }
+    printf("  Delta frente a '%s': %llu bytes copiados (%llu copias), %llu bytes nuevos → %llu bytes\n",
+           config->delta_base, (unsigned long long)stats.copied_bytes,
+           (unsigned long long)stats.copy_ops, (unsigned long long)stats.inserted_bytes,
+           (unsigned long long)stats.delta_size);
+
+    int result = execute_file_pipeline(config, delta_path, output_path);
+    unlink(delta_path);
+    return result;
+}
+
+int delta_reconstruct_file(const program_config_t *config, const char *input_path, const char *output_path) {
+    char delta_path[64];
+    if (create_delta_temp(delta_path, sizeof(delta_path)) != 0) {
+        return -1;
+    }
+
+    // El delta intermedio no necesita durabilidad: solo se sincroniza la salida final
+    program_config_t delta_config = *config;
+    delta_config.durability = DURABILITY_NONE;
+    if (execute_file_pipeline(&delta_config, input_path, delta_path) != 0) {
+        unlink(delta_path);
+        return -1;
+    }
+
+    int result = delta_apply(config->delta_base, delta_path, output_path,
+                             config->durability == DURABILITY_PER_FILE);
+    unlink(delta_path);
+    return result;
+}
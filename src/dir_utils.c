@@ -1,38 +1,504 @@
+#define _DEFAULT_SOURCE     // d_type y DT_* en struct dirent
 #include "../include/dir_utils.h"
 #include <stdio.h>    
 #include <stdlib.h>   
 #include <string.h>   
 #include <dirent.h>   
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h> 
 #include <errno.h>
+#include <pthread.h>
+
+#define FILE_LIST_INITIAL_CAPACITY 256
+#define FILE_LIST_BLOCK_SIZE (256 * 1024)
+#define PATH_BUFFER_INITIAL 4096
+
+/* Las rutas se copian en bloques grandes: un malloc por bloque, no por archivo */
+struct file_list_block {
+    struct file_list_block *next;
+    size_t used;
+    size_t capacity;
+    char data[];
+};
+
+// Ruta del directorio en curso; se extiende al bajar y se recorta al volver
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} path_buffer_t;
+
+static char *arena_store(FileList *list, const char *path, size_t length) {
+    struct file_list_block *block = list->arena;
+    if (!block || block->capacity - block->used < length + 1) {
+        size_t capacity = length + 1 > FILE_LIST_BLOCK_SIZE ? length + 1 : FILE_LIST_BLOCK_SIZE;
+        block = malloc(sizeof(*block) + capacity);
+        if (!block) {
+            return NULL;
+        }
+        block->next = list->arena;
+        block->used = 0;
+        block->capacity = capacity;
+        list->arena = block;
+    }
+
+    char *copy = block->data + block->used;
+    memcpy(copy, path, length);
+    copy[length] = '\0';
+    block->used += length + 1;
+    return copy;
+}
+
+int file_list_add(FileList *list, const char *path, size_t path_length, off_t size) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : FILE_LIST_INITIAL_CAPACITY;
+        char **paths = realloc(list->paths, sizeof(char*) * capacity);
+        if (!paths) {
+            return -1;
+        }
+        list->paths = paths;
+        off_t *sizes = realloc(list->sizes, sizeof(off_t) * capacity);
+        if (!sizes) {
+            return -1;
+        }
+        list->sizes = sizes;
+        list->capacity = capacity;
+    }
+
+    char *copy = arena_store(list, path, path_length);
+    if (!copy) {
+        return -1;
+    }
+    list->paths[list->count] = copy;
+    list->sizes[list->count] = size;
+    list->count++;
+    return 0;
+}
+
+static int path_append(path_buffer_t *path, const char *name, size_t name_length) {
+    size_t needed = path->length + 1 + name_length + 1;
+    if (needed > path->capacity) {
+        size_t capacity = path->capacity * 2 > needed ? path->capacity * 2 : needed;
+        char *data = realloc(path->data, capacity);
+        if (!data) {
+            return -1;
+        }
+        path->data = data;
+        path->capacity = capacity;
+    }
+    path->data[path->length] = '/';
+    memcpy(path->data + path->length + 1, name, name_length + 1);
+    path->length += 1 + name_length;
+    return 0;
+}
+
+static int is_dot_entry(const char *name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+/*
+ * Tipo de una entrada: DT_REG (con st relleno), DT_DIR u otro. El tipo sale
+ * de d_type, así que solo se pide fstatat para los archivos regulares (hace
+ * falta su tamaño), los enlaces (se siguen, como con stat) y los sistemas de
+ * archivos que no rellenan d_type.
+ */
+static unsigned char classify_entry(int dir_fd, const struct dirent *entry, struct stat *st) {
+    unsigned char type = entry->d_type;
+    if (type == DT_REG || type == DT_LNK || type == DT_UNKNOWN) {
+        if (fstatat(dir_fd, entry->d_name, st, 0) == -1) {
+            perror("Error: no se pudo obtener el estado del archivo");
+            return DT_UNKNOWN;
+        }
+        type = S_ISREG(st->st_mode) ? DT_REG : (S_ISDIR(st->st_mode) ? DT_DIR : DT_UNKNOWN);
+    }
+    return type;
+}
+
+/* Recorre el directorio abierto en dir_fd (se cierra al terminar); los hijos se abren con openat */
+static int walk_directory(int dir_fd, path_buffer_t *path, file_visit_fn visit, void *context) {
+    DIR *dir = fdopendir(dir_fd);
+    if (!dir) {
+        perror("Error: no se pudo abrir el directorio");
+        close(dir_fd);
+        return 0;
+    }
+
+    int status = 0;
+    struct dirent *entry;
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        if (is_dot_entry(entry->d_name)) {
+            continue;
+        }
+        struct stat st;
+        unsigned char type = classify_entry(dirfd(dir), entry, &st);
+        if (type != DT_REG && type != DT_DIR) {
+            continue;
+        }
+
+        size_t parent_length = path->length;
+        if (path_append(path, entry->d_name, strlen(entry->d_name)) != 0) {
+            status = -1;
+            break;
+        }
+        if (type == DT_REG) {
+            status = visit(context, path->data, path->length, st.st_size);
+        } else {
+            int child_fd = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (child_fd == -1) {
+                perror("Error: no se pudo abrir el directorio");
+            } else {
+                status = walk_directory(child_fd, path, visit, context);
+            }
+        }
+        path->length = parent_length;
+        path->data[parent_length] = '\0';
+    }
+    closedir(dir);
+    return status;
+}
+
+static int path_set(path_buffer_t *path, const char *value, size_t length) {
+    if (length + 1 > path->capacity) {
+        size_t capacity = length + 1 > PATH_BUFFER_INITIAL ? length + 1 : PATH_BUFFER_INITIAL;
+        char *data = realloc(path->data, capacity);
+        if (!data) {
+            return -1;
+        }
+        path->data = data;
+        path->capacity = capacity;
+    }
+    memcpy(path->data, value, length);
+    path->data[length] = '\0';
+    path->length = length;
+    return 0;
+}
+
+int walk_directory_tree(const char *base_path, file_visit_fn visit, void *context) {
+    int dir_fd = open(base_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
+        perror("Error: no se pudo abrir el directorio");
+        return -1;
+    }
+
+    path_buffer_t path = {NULL, 0, 0};
+    if (path_set(&path, base_path, strlen(base_path)) != 0) {
+        close(dir_fd);
+        fprintf(stderr, "Error: sin memoria para recorrer '%s'\n", base_path);
+        return -1;
+    }
+    int status = walk_directory(dir_fd, &path, visit, context);
+    free(path.data);
+    return status;
+}
+
+static int list_visit(void *context, const char *path, size_t path_length, off_t size) {
+    if (file_list_add((FileList *)context, path, path_length, size) != 0) {
+        fprintf(stderr, "Error: sin memoria para la lista de archivos\n");
+        return -1;
+    }
+    return 0;
+}
 
 void read_directory_recursive(const char *base_path, FileList *list) {
-    DIR *dir = opendir(base_path);
+    walk_directory_tree(base_path, list_visit, list);
+}
+
+/*
+ * Recorrido en paralelo: los subdirectorios descubiertos van a una pila
+ * compartida de la que leen todos los hilos. Cada hilo acumula sus archivos en
+ * su propia lista y al final se unen sin copiar rutas (se encadenan las
+ * arenas). Al terminar se ordena por ruta, así que el resultado no depende del
+ * reparto entre hilos.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    char **dirs;            // Rutas completas pendientes de leer
+    size_t count;
+    size_t capacity;
+    size_t active;          // Directorios que algún hilo está leyendo
+    int failed;
+} walk_queue_t;
+
+typedef struct {
+    walk_queue_t *queue;
+    FileList files;
+    path_buffer_t path;
+} walk_worker_t;
+
+static int queue_push_locked(walk_queue_t *queue, const char *path, size_t length) {
+    if (queue->count == queue->capacity) {
+        size_t capacity = queue->capacity ? queue->capacity * 2 : FILE_LIST_INITIAL_CAPACITY;
+        char **dirs = realloc(queue->dirs, sizeof(char*) * capacity);
+        if (!dirs) {
+            return -1;
+        }
+        queue->dirs = dirs;
+        queue->capacity = capacity;
+    }
+    char *copy = malloc(length + 1);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, path, length + 1);
+    queue->dirs[queue->count++] = copy;
+    return 0;
+}
+
+// Siguiente directorio a leer; NULL cuando no queda ninguno ni puede aparecer otro
+static char *queue_pop(walk_queue_t *queue) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0 && queue->active > 0 && !queue->failed) {
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    char *path = NULL;
+    if (queue->count > 0 && !queue->failed) {
+        path = queue->dirs[--queue->count];
+        queue->active++;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return path;
+}
+
+static void queue_finish(walk_queue_t *queue, int status) {
+    pthread_mutex_lock(&queue->mutex);
+    queue->active--;
+    if (status != 0) {
+        queue->failed = 1;
+    }
+    if (queue->failed || (queue->active == 0 && queue->count == 0)) {
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static int scan_directory(walk_worker_t *worker, const char *dir_path) {
+    int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = dir_fd == -1 ? NULL : fdopendir(dir_fd);
     if (!dir) {
         perror("Error: no se pudo abrir el directorio");
-        return;
+        if (dir_fd != -1) {
+            close(dir_fd);
+        }
+        return 0;
     }
+
+    path_buffer_t *path = &worker->path;
+    size_t dir_length = strlen(dir_path);
+    if (path_set(path, dir_path, dir_length) != 0) {
+        closedir(dir);
+        return -1;
+    }
+
+    int status = 0;
     struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        if (is_dot_entry(entry->d_name)) {
             continue;
         }
-        char path[1024];
-        snprintf(path, sizeof(path), "%s/%s", base_path, entry->d_name);
-        
         struct stat st;
-        if (stat(path, &st) == -1) {
-            perror("Error: no se pudo obtener el estado del archivo");
+        unsigned char type = classify_entry(dirfd(dir), entry, &st);
+        if (type != DT_REG && type != DT_DIR) {
             continue;
         }
 
-        if (S_ISREG(st.st_mode)) {
-            list->paths = realloc(list->paths, sizeof(char*) * (list->count + 1));
-            list->paths[list->count] = strdup(path);
-            list->count++;
-        } else if (S_ISDIR(st.st_mode)) {
-            read_directory_recursive(path, list);
+        if (path_append(path, entry->d_name, strlen(entry->d_name)) != 0) {
+            status = -1;
+            break;
         }
+        if (type == DT_REG) {
+            status = file_list_add(&worker->files, path->data, path->length, st.st_size);
+        } else {
+            pthread_mutex_lock(&worker->queue->mutex);
+            status = queue_push_locked(worker->queue, path->data, path->length);
+            pthread_cond_signal(&worker->queue->cond);
+            pthread_mutex_unlock(&worker->queue->mutex);
+        }
+        path->length = dir_length;
+        path->data[dir_length] = '\0';
     }
     closedir(dir);
-}        
+    return status;
+}
+
+static void *walk_worker(void *arg) {
+    walk_worker_t *worker = (walk_worker_t *)arg;
+    char *dir_path;
+    while ((dir_path = queue_pop(worker->queue)) != NULL) {
+        int status = scan_directory(worker, dir_path);
+        free(dir_path);
+        queue_finish(worker->queue, status);
+    }
+    return NULL;
+}
+
+// Mueve las entradas de src al final de dst; las rutas siguen en las arenas encadenadas
+static int file_list_take(FileList *dst, FileList *src) {
+    if (src->count == 0) {
+        free_file_list(src);
+        return 0;
+    }
+    if (dst->count + src->count > dst->capacity) {
+        size_t capacity = dst->count + src->count;
+        char **paths = realloc(dst->paths, sizeof(char*) * capacity);
+        if (!paths) {
+            return -1;
+        }
+        dst->paths = paths;
+        off_t *sizes = realloc(dst->sizes, sizeof(off_t) * capacity);
+        if (!sizes) {
+            return -1;
+        }
+        dst->sizes = sizes;
+        dst->capacity = capacity;
+    }
+    memcpy(dst->paths + dst->count, src->paths, sizeof(char*) * src->count);
+    memcpy(dst->sizes + dst->count, src->sizes, sizeof(off_t) * src->count);
+    dst->count += src->count;
+
+    struct file_list_block *tail = src->arena;
+    while (tail && tail->next) {
+        tail = tail->next;
+    }
+    if (tail) {
+        tail->next = dst->arena;
+        dst->arena = src->arena;
+    }
+    src->arena = NULL;
+    free_file_list(src);
+    return 0;
+}
+
+void read_directory_parallel(const char *base_path, FileList *list, int threads) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus < 1 ? 1 : (cpus > DIR_WALK_MAX_THREADS ? DIR_WALK_MAX_THREADS : (int)cpus);
+    }
+
+    int base_fd = open(base_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (base_fd == -1) {
+        perror("Error: no se pudo abrir el directorio");
+        return;
+    }
+    close(base_fd);
+
+    walk_queue_t queue;
+    memset(&queue, 0, sizeof(queue));
+    pthread_mutex_init(&queue.mutex, NULL);
+    pthread_cond_init(&queue.cond, NULL);
+    walk_worker_t *workers = calloc((size_t)threads, sizeof(walk_worker_t));
+    pthread_t *handles = calloc((size_t)threads, sizeof(pthread_t));
+    int failed = !workers || !handles || queue_push_locked(&queue, base_path, strlen(base_path)) != 0;
+
+    if (!failed) {
+        for (int i = 0; i < threads; i++) {
+            workers[i].queue = &queue;
+        }
+        // El hilo llamante también recorre: con un solo hilo no se crea ninguno
+        int started = 0;
+        for (int i = 1; i < threads; i++) {
+            if (pthread_create(&handles[i], NULL, walk_worker, &workers[i]) != 0) {
+                break;
+            }
+            started++;
+        }
+        walk_worker(&workers[0]);
+        for (int i = 1; i <= started; i++) {
+            pthread_join(handles[i], NULL);
+        }
+        failed = queue.failed;
+    }
+
+    for (int i = 0; workers && i < threads; i++) {
+        if (file_list_take(list, &workers[i].files) != 0) {
+            free_file_list(&workers[i].files);
+            failed = 1;
+        }
+        free(workers[i].path.data);
+    }
+    for (size_t i = 0; i < queue.count; i++) {
+        free(queue.dirs[i]);
+    }
+    free(queue.dirs);
+    free(workers);
+    free(handles);
+    pthread_cond_destroy(&queue.cond);
+    pthread_mutex_destroy(&queue.mutex);
+
+    if (failed) {
+        fprintf(stderr, "Error: sin memoria para recorrer '%s'\n", base_path);
+    }
+    sort_file_list_by_path(list);
+}
+
+typedef struct {
+    char *path;
+    off_t size;
+} file_entry_t;
+
+static int compare_entries_by_size(const void *a, const void *b) {
+    const file_entry_t *left = (const file_entry_t *)a;
+    const file_entry_t *right = (const file_entry_t *)b;
+    if (left->size != right->size) {
+        return left->size > right->size ? -1 : 1;
+    }
+    return strcmp(left->path, right->path);
+}
+
+static int compare_entries_by_path(const void *a, const void *b) {
+    return strcmp(((const file_entry_t *)a)->path, ((const file_entry_t *)b)->path);
+}
+
+static void sort_file_list(FileList *list, int (*compare)(const void *, const void *)) {
+    file_entry_t *entries = malloc(sizeof(file_entry_t) * list->count);
+    if (!entries) {
+        return;
+    }
+    for (size_t i = 0; i < list->count; ++i) {
+        entries[i].path = list->paths[i];
+        entries[i].size = list->sizes[i];
+    }
+    qsort(entries, list->count, sizeof(file_entry_t), compare);
+    for (size_t i = 0; i < list->count; ++i) {
+        list->paths[i] = entries[i].path;
+        list->sizes[i] = entries[i].size;
+    }
+    free(entries);
+}
+
+/* Ordena de mayor a menor tamaño (a igual tamaño, por ruta) */
+void sort_file_list_by_size(FileList *list) {
+    if (!list || list->count < 2 || !list->sizes) {
+        return;
+    }
+    sort_file_list(list, compare_entries_by_size);
+}
+
+/* Orden estable entre ejecuciones: el del recorrido paralelo depende del reparto */
+void sort_file_list_by_path(FileList *list) {
+    if (!list || list->count < 2 || !list->sizes) {
+        return;
+    }
+    sort_file_list(list, compare_entries_by_path);
+}
+
+void free_file_list(FileList *list) {
+    if (!list) {
+        return;
+    }
+
+    struct file_list_block *block = list->arena;
+    while (block) {
+        struct file_list_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(list->paths);
+    free(list->sizes);
+    list->paths = NULL;
+    list->sizes = NULL;
+    list->arena = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
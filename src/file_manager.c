@@ -1,13 +1,23 @@
+#define _GNU_SOURCE     // syncfs(), copy_file_range(), O_DIRECT, sync_file_range(), fallocate(), SEEK_DATA
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <dirent.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include "../include/file_manager.h"
 
+#if defined(__linux__) && defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define HAVE_COPY_FILE_RANGE 1
+#endif
+
 int read_file(const char* path, unsigned char** buffer, size_t* size) {
     if (path == NULL || buffer == NULL || size == NULL) {
         fprintf(stderr, "Error: Parámetros inválidos en read_file\n");
@@ -89,7 +99,81 @@ int read_file(const char* path, unsigned char** buffer, size_t* size) {
     return 0;
 }
 
+int map_file_readonly(const char* path, file_mapping_t* mapping) {
+    if (path == NULL || mapping == NULL) {
+        fprintf(stderr, "Error: Parámetros inválidos en map_file_readonly\n");
+        return -1;
+    }
+
+    mapping->data = NULL;
+    mapping->size = 0;
+    mapping->mapped = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error: No se pudo abrir archivo '%s' - %s\n",
+                path, strerror(errno));
+        return -1;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        fprintf(stderr, "Error: No se pudo obtener información de '%s' - %s\n",
+                path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (!S_ISREG(file_stat.st_mode)) {
+        fprintf(stderr, "Error: '%s' no es un archivo regular\n", path);
+        close(fd);
+        return -1;
+    }
+
+    // mmap no admite longitud cero: un archivo vacío es una vista vacía
+    if (file_stat.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    size_t size = (size_t)file_stat.st_size;
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // La proyección se mantiene tras cerrar el descriptor
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+
+    // Lectura secuencial con prefetch agresivo del kernel
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+    posix_madvise(data, size, POSIX_MADV_WILLNEED);
+
+    mapping->data = (unsigned char*)data;
+    mapping->size = size;
+    mapping->mapped = 1;
+    return 0;
+}
+
+void unmap_file(file_mapping_t* mapping) {
+    if (mapping == NULL) {
+        return;
+    }
+
+    if (mapping->mapped) {
+        munmap(mapping->data, mapping->size);
+    } else {
+        free(mapping->data);
+    }
+
+    mapping->data = NULL;
+    mapping->size = 0;
+    mapping->mapped = 0;
+}
+
 int write_file(const char* path, const unsigned char* data, size_t size) {
+    return write_file_synced(path, data, size, 1);
+}
+
+int write_file_synced(const char* path, const unsigned char* data, size_t size, int sync_to_disk) {
     if (path == NULL || data == NULL) {
         fprintf(stderr, "Error: Parámetros inválidos en write_file\n");
         return -1;
@@ -119,34 +203,181 @@ int write_file(const char* path, const unsigned char* data, size_t size) {
     }
 
     // Escribir datos
-    ssize_t total_written = 0;
-    ssize_t bytes_written;
-    
-    while (total_written < (ssize_t)size) {
-        bytes_written = write(fd, data + total_written, size - total_written);
-        
-        if (bytes_written == -1) {
+    if (write_full(fd, data, size) != 0) {
+        fprintf(stderr, "Error: Fallo al escribir archivo '%s' - %s\n", 
+                path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    // Sincronizar datos con disco
+    if (sync_to_disk) {
+        sync_file_descriptor(fd, path); // No consideramos esto un error fatal
+    }
+
+    close(fd);
+    return 0;
+}
+
+/* Escribe size bytes completos reintentando escrituras parciales e interrupciones */
+int write_full(int fd, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t total_written = 0;
+    while (total_written < size) {
+        ssize_t written = write(fd, bytes + total_written, size - total_written);
+        if (written == -1) {
             if (errno == EINTR) {
-                continue; // Interrupción de sistema, reintentar
+                continue;
             }
-            fprintf(stderr, "Error: Fallo al escribir archivo '%s' - %s\n", 
-                    path, strerror(errno));
-            close(fd);
             return -1;
         }
-        
-        total_written += bytes_written;
+        if (written == 0) {
+            errno = EIO;
+            return -1;
+        }
+        total_written += (size_t)written;
     }
+    return 0;
+}
 
-    // Sincronizar datos con disco
+int sync_file_descriptor(int fd, const char* path) {
     if (fsync(fd) == -1) {
-        fprintf(stderr, "Warning: No se pudo sincronizar '%s' - %s\n", 
+        fprintf(stderr, "Warning: No se pudo sincronizar '%s' - %s\n",
+                path ? path : "(fd)", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int sync_filesystem(const char* path) {
+    if (path == NULL) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Warning: No se pudo abrir '%s' para sincronizar - %s\n",
                 path, strerror(errno));
-        // No consideramos esto un error fatal
+        sync();
+        return -1;
     }
 
+    int status = 0;
+#ifdef __linux__
+    // Una sola llamada vacía todas las escrituras pendientes del sistema de archivos
+    if (syncfs(fd) == -1) {
+        fprintf(stderr, "Warning: syncfs falló en '%s' - %s\n", path, strerror(errno));
+        sync();
+        status = -1;
+    }
+#else
+    sync();
+    if (fsync(fd) == -1) {
+        status = -1;
+    }
+#endif
+
     close(fd);
+    return status;
+}
+
+/*
+ * Abre un archivo para lectura sin pasar por el page cache (O_DIRECT). Si el
+ * sistema de archivos lo rechaza se abre normalmente y *direct queda en 0; el
+ * llamador debe entonces descartar el cache con drop_file_cache().
+ */
+int open_uncached_readonly(const char* path, int* direct) {
+    *direct = 0;
+#ifdef O_DIRECT
+    int fd = open(path, O_RDONLY | O_DIRECT);
+    if (fd != -1) {
+        *direct = 1;
+        return fd;
+    }
+    if (errno != EINVAL && errno != EOPNOTSUPP) {
+        return -1;
+    }
+#endif
+    return open(path, O_RDONLY);
+}
+
+// Algunos sistemas aceptan O_DIRECT en open() pero fallan en la primera lectura
+int disable_direct_io(int fd) {
+#ifdef O_DIRECT
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+#else
+    (void)fd;
     return 0;
+#endif
+}
+
+void* alloc_aligned_buffer(size_t size) {
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, FILE_DIRECT_IO_ALIGNMENT, size > 0 ? size : 1) != 0) {
+        return NULL;
+    }
+    return buffer;
+}
+
+/*
+ * Saca del page cache un rango ya procesado. Con write_back se fuerza antes la
+ * escritura del rango (sync_file_range) para que las páginas estén limpias y
+ * el kernel pueda descartarlas de inmediato.
+ */
+int drop_file_cache(int fd, off_t offset, off_t length, int write_back) {
+    if (length <= 0) {
+        return 0;
+    }
+
+    if (write_back) {
+#ifdef __linux__
+        if (sync_file_range(fd, offset, length,
+                            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                            SYNC_FILE_RANGE_WAIT_AFTER) == -1) {
+            return -1;
+        }
+#else
+        if (fdatasync(fd) == -1) {
+            return -1;
+        }
+#endif
+    }
+
+    return posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED) == 0 ? 0 : -1;
+}
+
+/*
+ * Reserva de una vez los bloques de una salida de tamaño conocido (menos
+ * fragmentación y menos actualizaciones de metadatos que crecer por append).
+ * Solo usa fallocate() nativo: posix_fallocate() de glibc emula la reserva
+ * escribiendo ceros bloque a bloque cuando el sistema de archivos no la
+ * soporta, lo que duplicaría la E/S. Con FALLOC_FL_KEEP_SIZE st_size no
+ * cambia: una salida a medias nunca aparenta estar completa. Un fallo no es
+ * fatal para el llamador.
+ */
+int preallocate_file(int fd, off_t size) {
+    if (size <= 0) {
+        return 0;
+    }
+#ifdef __linux__
+    return fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) == 0 ? 0 : -1;
+#else
+    (void)fd;
+    return -1;
+#endif
+}
+
+/* Libera los bloques reservados más allá de lo escrito (salidas abandonadas) */
+int release_preallocation(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return -1;
+    }
+    return ftruncate(fd, st.st_size);
 }
 
 int get_file_info(const char* path, struct stat* stat_buf) {
@@ -259,4 +490,216 @@ int copy_file_permissions(const char* src_path, const char* dest_path) {
     }
     
     return 0;
-}
\ No newline at end of file
+}
+
+/* Errores que indican que el mecanismo no aplica a este par de descriptores */
+static int copy_method_unsupported(int error) {
+    return error == ENOSYS || error == EXDEV || error == EINVAL ||
+           error == EOPNOTSUPP || error == EBADF || error == ETXTBSY;
+}
+
+static int copy_region_buffered(int in_fd, off_t* in_offset, int out_fd, size_t* remaining) {
+    unsigned char* buffer = (unsigned char*)malloc(FILE_COPY_BUFFER_SIZE);
+    if (buffer == NULL) {
+        fprintf(stderr, "Error: No se pudo asignar buffer de copia\n");
+        return -1;
+    }
+
+    while (*remaining > 0) {
+        size_t request = *remaining < FILE_COPY_BUFFER_SIZE ? *remaining : FILE_COPY_BUFFER_SIZE;
+        ssize_t bytes_read = in_offset != NULL
+                                 ? pread(in_fd, buffer, request, *in_offset)
+                                 : read(in_fd, buffer, request);
+        if (bytes_read == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            free(buffer);
+            return -1;
+        }
+        if (bytes_read == 0) {
+            free(buffer);
+            return -2;
+        }
+
+        if (write_full(out_fd, buffer, (size_t)bytes_read) != 0) {
+            free(buffer);
+            return -1;
+        }
+
+        if (in_offset != NULL) {
+            *in_offset += bytes_read;
+        }
+        *remaining -= (size_t)bytes_read;
+    }
+
+    free(buffer);
+    return 0;
+}
+
+/*
+ * Copia exactamente 'length' bytes de in_fd a la posición actual de out_fd.
+ * Si in_offset no es NULL se lee desde esa posición (y se avanza) sin mover
+ * el offset de in_fd. Intenta primero copy_file_range (copia en el kernel,
+ * con reflink en sistemas de archivos que lo soportan), luego sendfile y por
+ * último una copia con buffer. Devuelve 0, -1 en error o -2 si la entrada
+ * termina antes de tiempo.
+ */
+int copy_file_region(int in_fd, off_t* in_offset, int out_fd, size_t length) {
+    size_t remaining = length;
+
+#ifdef HAVE_COPY_FILE_RANGE
+    while (remaining > 0) {
+        ssize_t copied = copy_file_range(in_fd, in_offset, out_fd, NULL, remaining, 0);
+        if (copied == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (copy_method_unsupported(errno)) {
+                break;
+            }
+            fprintf(stderr, "Error: copy_file_range falló - %s\n", strerror(errno));
+            return -1;
+        }
+        if (copied == 0) {
+            return -2;
+        }
+        remaining -= (size_t)copied;
+    }
+#endif
+
+#ifdef __linux__
+    while (remaining > 0) {
+        ssize_t copied = sendfile(out_fd, in_fd, in_offset, remaining);
+        if (copied == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (copy_method_unsupported(errno)) {
+                break;
+            }
+            fprintf(stderr, "Error: sendfile falló - %s\n", strerror(errno));
+            return -1;
+        }
+        if (copied == 0) {
+            return -2;
+        }
+        remaining -= (size_t)copied;
+    }
+#endif
+
+    if (remaining == 0) {
+        return 0;
+    }
+
+    int status = copy_region_buffered(in_fd, in_offset, out_fd, &remaining);
+    if (status == -1) {
+        fprintf(stderr, "Error: Fallo en la copia de datos - %s\n", strerror(errno));
+    }
+    return status;
+}
+
+/*
+ * Huecos (archivos dispersos). SEEK_DATA/SEEK_HOLE permiten saltar rangos
+ * sin bloques asignados sin leerlos. Donde no están soportados todo el
+ * archivo cuenta como datos y se sigue el camino denso habitual.
+ */
+int file_is_sparse(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+    return (off_t)st.st_blocks * 512 < st.st_size;
+}
+
+// Primer offset con datos a partir de 'offset'; el tamaño del archivo si solo quedan huecos
+off_t next_data_offset(int fd, off_t offset) {
+#ifdef SEEK_DATA
+    off_t data = lseek(fd, offset, SEEK_DATA);
+    if (data != -1) {
+        return data;
+    }
+    if (errno == ENXIO) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > offset) {
+            return st.st_size;
+        }
+    }
+#else
+    (void)fd;
+#endif
+    return offset;
+}
+
+int region_has_holes(int fd, off_t offset, size_t length) {
+#ifdef SEEK_HOLE
+    off_t saved = lseek(fd, 0, SEEK_CUR);
+    off_t hole = lseek(fd, offset, SEEK_HOLE);
+    if (saved != -1) {
+        lseek(fd, saved, SEEK_SET);
+    }
+    return hole != -1 && hole < offset + (off_t)length;
+#else
+    (void)fd;
+    (void)offset;
+    (void)length;
+    return 0;
+#endif
+}
+
+/*
+ * Igual que copy_file_region() pero conservando los huecos del origen: los
+ * rangos con datos se copian en el kernel y los huecos se saltan con lseek en
+ * el destino. Si la región termina en hueco, el destino se extiende con
+ * ftruncate para que su tamaño sea el correcto.
+ */
+int copy_file_region_sparse(int in_fd, off_t* in_offset, int out_fd, size_t length) {
+    struct stat st;
+    off_t end = *in_offset + (off_t)length;
+    if (length == 0 || fstat(in_fd, &st) != 0 || end > st.st_size || !file_is_sparse(in_fd)) {
+        return copy_file_region(in_fd, in_offset, out_fd, length);
+    }
+
+    off_t saved = lseek(in_fd, 0, SEEK_CUR);
+    int skipped = 0;
+    int status = 0;
+    while (status == 0 && *in_offset < end) {
+        off_t data = next_data_offset(in_fd, *in_offset);
+        if (data > end) {
+            data = end;
+        }
+
+        if (data > *in_offset) {
+            if (lseek(out_fd, data - *in_offset, SEEK_CUR) == -1) {
+                status = -1;
+                break;
+            }
+            *in_offset = data;
+            skipped = 1;
+            continue;
+        }
+
+        off_t hole = end;
+#ifdef SEEK_HOLE
+        hole = lseek(in_fd, *in_offset, SEEK_HOLE);
+        if (hole == -1 || hole > end) {
+            hole = end;
+        }
+#endif
+        status = copy_file_region(in_fd, in_offset, out_fd, (size_t)(hole - *in_offset));
+    }
+
+    if (status == 0 && skipped) {
+        off_t position = lseek(out_fd, 0, SEEK_CUR);
+        struct stat out_st;
+        if (position == -1 || fstat(out_fd, &out_st) != 0 ||
+            (out_st.st_size < position && ftruncate(out_fd, position) != 0)) {
+            status = -1;
+        }
+    }
+
+    if (saved != -1) {
+        lseek(in_fd, saved, SEEK_SET);
+    }
+    return status;
+}
@@ -8,6 +8,8 @@
 #include "../include/concurrency.h"
 #include "../include/archive.h"
 #include "../include/operations.h"
+#include "../include/chunk_cache.h"
+#include "../include/delta.h"
 
 typedef enum {
     MODE_SINGLE_FILE,
@@ -32,6 +34,11 @@ operation_mode_t detect_operation_mode(const program_config_t *config) {
     if (S_ISREG(path_stat.st_mode)) {
         // Para operaciones de DESCOMPRESIÓN/DESENCRIPTACIÓN, verificar si es archive
         if ((config->operations & OP_DECOMPRESS) || (config->operations & OP_DECRYPT)) {
+            // El magic del archive v2 no depende de la extensión
+            if (is_archive_v2_file(config->input_path)) {
+                return MODE_ARCHIVE_EXTRACT;
+            }
+
             // Verificar extensiones comunes de archives
             const char *ext = strrchr(config->input_path, '.');
             if (ext != NULL) {
@@ -50,6 +57,18 @@ operation_mode_t detect_operation_mode(const program_config_t *config) {
     return MODE_SINGLE_FILE;
 }
 
+/* Política batch: una única sincronización del sistema de archivos de salida */
+static void apply_batch_durability(const program_config_t *config, const char *output_path) {
+    if (config->durability != DURABILITY_BATCH) {
+        return;
+    }
+
+    printf("Sincronizando salidas (modo batch)...\n");
+    if (sync_filesystem(output_path) == 0) {
+        printf("  ✓ Salidas sincronizadas con disco\n");
+    }
+}
+
 int execute_single_file_operations(const program_config_t *config) {
     char *output_path = process_output_path(config);
     if (output_path == NULL) {
@@ -65,16 +84,79 @@ int execute_single_file_operations(const program_config_t *config) {
         return -1;
     }
     printf("  ✓ Archivo procesado correctamente → %s\n", output_path);
+    apply_batch_durability(config, output_path);
 
     free(output_path);
     printf("Procesamiento completado exitosamente\n");
     return 0;
 }
 
+/* --delta-base: el archivo viaja como diferencias frente a una versión anterior */
+static int execute_delta_operations(const program_config_t *config) {
+    struct stat input_stat;
+    if (stat(config->input_path, &input_stat) != 0 || !S_ISREG(input_stat.st_mode)) {
+        fprintf(stderr, "Error: --delta-base requiere un archivo regular como entrada\n");
+        return -1;
+    }
+    char *output_path = process_output_path(config);
+    if (output_path == NULL) {
+        fprintf(stderr, "Error: No se pudo determinar la ruta de salida\n");
+        return -1;
+    }
+
+    int result;
+    if (config->operations & (OP_COMPRESS | OP_ENCRYPT)) {
+        printf("Paso 1: Codificando delta y ejecutando pipeline\n");
+        result = delta_compress_file(config, config->input_path, output_path);
+    } else {
+        printf("Paso 1: Deshaciendo pipeline y aplicando delta\n");
+        result = delta_reconstruct_file(config, config->input_path, output_path);
+    }
+    if (result != 0) {
+        fprintf(stderr, "Error: Falló el procesamiento de '%s'\n", config->input_path);
+        free(output_path);
+        return -1;
+    }
+    printf("  ✓ Archivo procesado correctamente → %s\n", output_path);
+    apply_batch_durability(config, output_path);
+
+    free(output_path);
+    printf("Procesamiento completado exitosamente\n");
+    return 0;
+}
+
+/* --per-file: cada archivo del directorio se procesa en paralelo hacia un árbol espejo */
+static int execute_per_file_operations(const program_config_t *config, const char *output_path) {
+    if (output_path == NULL) {
+        fprintf(stderr, "Error: No se pudo determinar la ruta de salida\n");
+        return -1;
+    }
+    if (strcmp(output_path, config->input_path) == 0) {
+        fprintf(stderr, "Error: El directorio de salida debe ser distinto del de entrada\n");
+        return -1;
+    }
+    if (((config->operations & OP_ENCRYPT) || (config->operations & OP_DECRYPT)) &&
+        strlen(config->key) == 0) {
+        fprintf(stderr, "Error: Se requiere clave (-k) para encriptación/desencriptación\n");
+        return -1;
+    }
+
+    program_config_t per_file_config = *config;
+    snprintf(per_file_config.output_path, sizeof(per_file_config.output_path), "%s", output_path);
+    return process_directory_concurrent(&per_file_config);
+}
+
 int execute_directory_operations(const program_config_t *config) {
     // Procesar path de salida automáticamente
     char *output_path = process_output_path(config);
     int result = 0;
+
+    if (config->per_file) {
+        // La política batch la aplica el propio procesamiento concurrente
+        result = execute_per_file_operations(config, output_path);
+        free(output_path);
+        return result;
+    }
     
     // Comprobar todas las combinaciones posibles para directorios
     if ((config->operations & OP_COMPRESS) && (config->operations & OP_ENCRYPT)) {
@@ -121,6 +203,10 @@ int execute_directory_operations(const program_config_t *config) {
         free(output_path);
         return -1;
     }
+
+    if (result == 0) {
+        apply_batch_durability(config, output_path);
+    }
     
     free(output_path);
     return result;
@@ -134,9 +220,43 @@ int execute_operations(const program_config_t *config) {
         return -1;
     }
     
+    // Listado y extracción selectiva: solo se lee el directorio central del archive v2
+    if (config->list_archive || config->extract_pattern[0] != '\0') {
+        if (!is_archive_v2_file(config->input_path)) {
+            fprintf(stderr, "Error: '%s' no es un archive v2 (--archive-format v2)\n", config->input_path);
+            return -1;
+        }
+        if (config->list_archive) {
+            return list_archive_v2(config->input_path);
+        }
+
+        char *output_path = process_output_path(config);
+        if (output_path == NULL) {
+            fprintf(stderr, "Error: No se pudo determinar la ruta de salida\n");
+            return -1;
+        }
+        int result = extract_archive_v2(config, config->input_path, output_path);
+        if (result == 0) {
+            apply_batch_durability(config, output_path);
+        }
+        free(output_path);
+        return result;
+    }
+
+    // El rango se toma de un único stream: un directorio o un archive no tienen uno
+    if (config->range_enabled && detect_operation_mode(config) != MODE_SINGLE_FILE) {
+        fprintf(stderr, "Error: --range requiere un único archivo comprimido, no un directorio ni un archive\n");
+        return -1;
+    }
+
+    // Delta frente a una versión anterior: siempre un único archivo
+    if (config->delta_base[0] != '\0') {
+        return execute_delta_operations(config);
+    }
+
     // Para archivos con extensión .huff, forzar modo archivo único
     const char *ext = strrchr(config->input_path, '.');
-    if (ext != NULL && strcmp(ext, ".huff") == 0) {
+    if (ext != NULL && strcmp(ext, ".huff") == 0 && !is_archive_v2_file(config->input_path)) {
         printf("Archivo Huffman detectado - Modo archivo único\n");
         return execute_single_file_operations(config);
     }
@@ -145,7 +265,11 @@ int execute_operations(const program_config_t *config) {
     
     switch (mode) {
         case MODE_DIRECTORY:
-            printf("Entrada detectada como directorio - Modo archive\n");
+            if (config->per_file) {
+                printf("Entrada detectada como directorio - Modo por archivo\n");
+            } else {
+                printf("Entrada detectada como directorio - Modo archive\n");
+            }
             return execute_directory_operations(config);
             
         case MODE_ARCHIVE_EXTRACT:
@@ -215,6 +339,9 @@ int main(int argc, char *argv[]) {
     
     // Ejecutar operaciones
     int operation_result = execute_operations(&config);
+    if (config.cache_dir[0] != '\0') {
+        chunk_cache_report(&config);
+    }
     
     if (operation_result != 0) {
         fprintf(stderr, "\nX Procesamiento falló con errores\n");
@@ -0,0 +1,354 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/concurrency.h"
+#include "../include/dedup.h"
+#include "../include/manifest.h"
+#include "../include/operations.h"
+
+/*
+ * Manifiesto de --per-file --incremental, en texto para poder inspeccionarlo:
+ *
+ *   GSEAMANIFEST 2 <operaciones> <alg_compresión> <alg_encriptación>
+ *                  <tamaño_chunk> <huella de la clave en hex>
+ *   <tamaño> <mtime_s> <mtime_ns> <inodo> <xxh64 en hex> <ruta relativa>
+ *   ...
+ *
+ * La ruta ocupa el resto de la línea; los archivos con saltos de línea en el
+ * nombre no se registran y se reprocesan en cada ejecución. La huella es
+ * XXH64 de la clave con una semilla fija: basta para notar un cambio de -k
+ * sin guardar la clave junto a las salidas.
+ */
+#define MANIFEST_MAGIC "GSEAMANIFEST"
+#define MANIFEST_VERSION 2
+#define MANIFEST_KEY_SEED 0x6773656165796b31ULL
+#define MANIFEST_LINE_SIZE (MAX_PATH_LENGTH + 128)
+
+static int compare_entries_by_path(const void *a, const void *b) {
+    const manifest_entry_t *left = (const manifest_entry_t *)a;
+    const manifest_entry_t *right = (const manifest_entry_t *)b;
+    return strcmp(left->path, right->path);
+}
+
+static int append_entry(manifest_t *manifest, const manifest_entry_t *entry) {
+    if (manifest->count == manifest->capacity) {
+        size_t capacity = manifest->capacity ? manifest->capacity * 2 : 64;
+        manifest_entry_t *entries = (manifest_entry_t *)realloc(manifest->entries, capacity * sizeof(*entries));
+        if (!entries) {
+            return -1;
+        }
+        manifest->entries = entries;
+        manifest->capacity = capacity;
+    }
+    manifest_entry_t *slot = &manifest->entries[manifest->count];
+    *slot = *entry;
+    slot->path = strdup(entry->path);
+    if (!slot->path) {
+        return -1;
+    }
+    manifest->count++;
+    return 0;
+}
+
+int manifest_load(const char *path, manifest_t *manifest) {
+    memset(manifest, 0, sizeof(*manifest));
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    char *line = (char *)malloc(MANIFEST_LINE_SIZE);
+    if (!line) {
+        fclose(file);
+        return -1;
+    }
+
+    int status = 0;
+    unsigned int version = 0, operations = 0, comp_alg = 0, enc_alg = 0;
+    uint64_t chunk_size = 0, key_hash = 0;
+    if (!fgets(line, MANIFEST_LINE_SIZE, file) ||
+        sscanf(line, MANIFEST_MAGIC " %u %u %u %u %" SCNu64 " %" SCNx64, &version, &operations, &comp_alg,
+               &enc_alg, &chunk_size, &key_hash) != 6 ||
+        version != MANIFEST_VERSION) {
+        fprintf(stderr, "Advertencia: manifiesto '%s' no reconocido; se reprocesa todo\n", path);
+        free(line);
+        fclose(file);
+        return 0;
+    }
+    manifest->operations = (unsigned char)operations;
+    manifest->comp_alg = (unsigned char)comp_alg;
+    manifest->enc_alg = (unsigned char)enc_alg;
+    manifest->chunk_size = chunk_size;
+    manifest->key_hash = key_hash;
+
+    while (status == 0 && fgets(line, MANIFEST_LINE_SIZE, file)) {
+        size_t len = strlen(line);
+        if (len == 0 || line[len - 1] != '\n') {
+            continue;       // Línea truncada: la entrada se trata como nueva
+        }
+        line[len - 1] = '\0';
+
+        manifest_entry_t entry;
+        int64_t mtime_sec;
+        long mtime_nsec;
+        int consumed = 0;
+        if (sscanf(line, "%" SCNu64 " %" SCNd64 " %ld %" SCNu64 " %" SCNx64 " %n", &entry.size, &mtime_sec,
+                   &mtime_nsec, &entry.inode, &entry.hash, &consumed) != 5 || line[consumed] == '\0') {
+            continue;
+        }
+        entry.mtime_sec = mtime_sec;
+        entry.mtime_nsec = mtime_nsec;
+        entry.path = line + consumed;
+        status = append_entry(manifest, &entry);
+    }
+    free(line);
+    fclose(file);
+
+    if (status != 0) {
+        manifest_free(manifest);
+        return -1;
+    }
+    qsort(manifest->entries, manifest->count, sizeof(*manifest->entries), compare_entries_by_path);
+    return 0;
+}
+
+int manifest_save(const char *path, const manifest_t *manifest) {
+    char temp_path[MAX_PATH_LENGTH];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        return -1;
+    }
+    FILE *file = fopen(temp_path, "w");
+    if (!file) {
+        fprintf(stderr, "Error: no se pudo escribir el manifiesto '%s' - %s\n", temp_path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(file, "%s %d %u %u %u %" PRIu64 " %016" PRIx64 "\n", MANIFEST_MAGIC, MANIFEST_VERSION,
+            manifest->operations, manifest->comp_alg, manifest->enc_alg, manifest->chunk_size,
+            manifest->key_hash);
+    for (size_t i = 0; i < manifest->count; i++) {
+        const manifest_entry_t *entry = &manifest->entries[i];
+        if (strchr(entry->path, '\n') != NULL) {
+            continue;
+        }
+        fprintf(file, "%" PRIu64 " %" PRId64 " %ld %" PRIu64 " %016" PRIx64 " %s\n", entry->size,
+                entry->mtime_sec, entry->mtime_nsec, entry->inode, entry->hash, entry->path);
+    }
+
+    int status = (fflush(file) == 0 && fsync(fileno(file)) == 0) ? 0 : -1;
+    if (fclose(file) != 0) {
+        status = -1;
+    }
+    if (status == 0 && rename(temp_path, path) != 0) {
+        status = -1;
+    }
+    if (status != 0) {
+        fprintf(stderr, "Error: no se pudo guardar el manifiesto '%s' - %s\n", path, strerror(errno));
+        unlink(temp_path);
+    }
+    return status;
+}
+
+const manifest_entry_t *manifest_find(const manifest_t *manifest, const char *path) {
+    if (manifest->count == 0) {
+        return NULL;
+    }
+    manifest_entry_t key;
+    memset(&key, 0, sizeof(key));
+    key.path = (char *)path;
+    return (const manifest_entry_t *)bsearch(&key, manifest->entries, manifest->count,
+                                             sizeof(*manifest->entries), compare_entries_by_path);
+}
+
+int manifest_add(manifest_t *manifest, const char *path, const struct stat *st, uint64_t hash) {
+    manifest_entry_t entry;
+    entry.path = (char *)path;
+    entry.size = (uint64_t)st->st_size;
+    entry.mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    entry.mtime_nsec = st->st_mtim.tv_nsec;
+    entry.inode = (uint64_t)st->st_ino;
+    entry.hash = hash;
+    return append_entry(manifest, &entry);
+}
+
+void manifest_free(manifest_t *manifest) {
+    for (size_t i = 0; i < manifest->count; i++) {
+        free(manifest->entries[i].path);
+    }
+    free(manifest->entries);
+    memset(manifest, 0, sizeof(*manifest));
+}
+
+/* Ruta relativa al directorio de entrada, la clave del manifiesto */
+static const char *relative_to_input(const char *base, const char *path) {
+    size_t base_len = strlen(base);
+    while (base_len > 1 && base[base_len - 1] == '/') {
+        base_len--;
+    }
+    if (strncmp(path, base, base_len) == 0 && path[base_len] == '/') {
+        path += base_len;
+        while (*path == '/') {
+            path++;
+        }
+    }
+    return path;
+}
+
+static int same_metadata(const manifest_entry_t *entry, const struct stat *st) {
+    return entry->size == (uint64_t)st->st_size &&
+           entry->mtime_sec == (int64_t)st->st_mtim.tv_sec &&
+           entry->mtime_nsec == st->st_mtim.tv_nsec &&
+           entry->inode == (uint64_t)st->st_ino;
+}
+
+/* Las salidas solo sirven si se generaron con el mismo codec, chunk y clave */
+static int same_codec(const manifest_t *previous, const manifest_t *next) {
+    return previous->operations == next->operations && previous->comp_alg == next->comp_alg &&
+           previous->enc_alg == next->enc_alg && previous->chunk_size == next->chunk_size &&
+           previous->key_hash == next->key_hash;
+}
+
+static int output_exists(const program_config_t *config, const char *input_path) {
+    char *output = generate_output_path(input_path, config->output_path, config);
+    struct stat st;
+    int exists = output != NULL && stat(output, &st) == 0 && S_ISREG(st.st_mode);
+    free(output);
+    return exists;
+}
+
+/*
+ * Un archivo conserva su salida si existe y el manifiesto lo describe igual:
+ * mismos tamaño, mtime e inodo, o, si solo cambiaron los metadatos (touch,
+ * copia), el mismo hash de contenido. El hash solo se calcula en ese caso y
+ * para los archivos que sí se van a procesar.
+ */
+int manifest_filter_files(const program_config_t *config, FileList *files, const manifest_t *previous,
+                          manifest_t *next, manifest_stats_t *stats) {
+    memset(next, 0, sizeof(*next));
+    memset(stats, 0, sizeof(*stats));
+    next->operations = (unsigned char)(config->operations & (OP_COMPRESS | OP_ENCRYPT));
+    next->comp_alg = (unsigned char)config->comp_alg;
+    next->enc_alg = (unsigned char)config->enc_alg;
+    next->chunk_size = (uint64_t)stream_chunk_size();
+    if (config->operations & OP_ENCRYPT) {
+        next->key_hash = dedup_hash64(config->key, strlen(config->key), MANIFEST_KEY_SEED);
+    }
+
+    /* Con otro codec, chunk o clave las salidas anteriores no sirven: todo cuenta como nuevo */
+    int reusable = same_codec(previous, next);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < files->count; i++) {
+        char *path = files->paths[i];
+        const char *relative = relative_to_input(config->input_path, path);
+        const manifest_entry_t *entry = reusable ? manifest_find(previous, relative) : NULL;
+        struct stat st;
+        int skip = 0;
+        int status = 0;
+
+        if (stat(path, &st) != 0) {
+            // El pipeline informará del error al procesarlo
+        } else if (entry != NULL && same_metadata(entry, &st) && output_exists(config, path)) {
+            stats->unchanged++;
+            skip = 1;
+            status = manifest_add(next, relative, &st, entry->hash);
+        } else {
+            uint64_t hash;
+            if (dedup_hash_file(path, &hash) != 0) {
+                fprintf(stderr, "Advertencia: no se pudo leer '%s'; se procesará sin registrar\n", path);
+            } else {
+                if (entry == NULL) {
+                    stats->added++;
+                } else if (entry->size == (uint64_t)st.st_size && entry->hash == hash &&
+                           output_exists(config, path)) {
+                    stats->touched++;
+                    skip = 1;
+                } else {
+                    stats->modified++;
+                }
+                status = manifest_add(next, relative, &st, hash);
+            }
+        }
+        if (status != 0) {
+            fprintf(stderr, "Error: sin memoria para el manifiesto.\n");
+            manifest_free(next);
+            return -1;
+        }
+
+        // Las rutas viven en la arena de la lista: descartar una es no copiarla
+        if (!skip) {
+            files->paths[kept] = path;
+            files->sizes[kept] = files->sizes[i];
+            kept++;
+        }
+    }
+    files->count = kept;
+
+    qsort(next->entries, next->count, sizeof(*next->entries), compare_entries_by_path);
+    for (size_t i = 0; reusable && i < previous->count; i++) {
+        if (manifest_find(next, previous->entries[i].path) == NULL) {
+            stats->removed++;
+        }
+    }
+    return 0;
+}
+
+static int is_manifest_file(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+    char magic[sizeof(MANIFEST_MAGIC)];
+    int matches = fread(magic, 1, sizeof(magic) - 1, file) == sizeof(magic) - 1 &&
+                  memcmp(magic, MANIFEST_MAGIC, sizeof(magic) - 1) == 0;
+    fclose(file);
+    return matches;
+}
+
+int manifest_is_own_file(const program_config_t *config, const char *path) {
+    return strcmp(relative_to_input(config->input_path, path), MANIFEST_FILE_NAME) == 0 &&
+           is_manifest_file(path);
+}
+
+void manifest_exclude(const program_config_t *config, FileList *files) {
+    size_t kept = 0;
+    for (size_t i = 0; i < files->count; i++) {
+        char *path = files->paths[i];
+        if (manifest_is_own_file(config, path)) {
+            continue;
+        }
+        files->paths[kept] = path;
+        files->sizes[kept] = files->sizes[i];
+        kept++;
+    }
+    files->count = kept;
+}
+
+void manifest_remove_stale(const program_config_t *config, const manifest_t *previous,
+                           const manifest_t *next) {
+    if (!same_codec(previous, next)) {
+        return;
+    }
+
+    for (size_t i = 0; i < previous->count; i++) {
+        const char *relative = previous->entries[i].path;
+        if (manifest_find(next, relative) != NULL) {
+            continue;
+        }
+        char input_path[MAX_PATH_LENGTH];
+        if (snprintf(input_path, sizeof(input_path), "%s/%s", config->input_path, relative) >=
+            (int)sizeof(input_path)) {
+            continue;
+        }
+        char *output = generate_output_path(input_path, config->output_path, config);
+        if (output != NULL && unlink(output) == 0) {
+            printf("  - Eliminado '%s' (ya no existe en la entrada)\n", output);
+        }
+        free(output);
+    }
+}
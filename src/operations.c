@@ -4,9 +4,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "../include/operations.h"
+#include "../include/async_io.h"
+#include "../include/chunk_cache.h"
 #include "../include/compression.h"
 #include "../include/compression_huffman.h"
 #include "../include/compression_lzw.h"
@@ -19,6 +22,30 @@
 #define CHUNK_HEADER_SIZE 8
 #define DEFAULT_STREAM_CHUNK_SIZE (1024 * 1024)
 
+/*
+ * Índice opcional al final del stream (flag STREAM_FLAG_INDEXED en el byte 5
+ * del header). Tras el último chunk se escribe un header de chunk 0/0 como
+ * terminador, luego el bloque de índice y finalmente un trailer de tamaño fijo:
+ *
+ *   "GSCI" | u32 count | count × (u64 offset_comprimido, u64 offset_original)
+ *   u64 offset_indice | u64 tamaño_original_total | u32 count | "GSCT"
+ */
+#define STREAM_FLAG_INDEXED 0x01
+#define STREAM_INDEX_MAGIC "GSCI"
+#define STREAM_TRAILER_MAGIC "GSCT"
+#define STREAM_INDEX_HEADER_SIZE 8
+#define STREAM_INDEX_ENTRY_SIZE 16
+#define STREAM_TRAILER_SIZE 24
+
+/*
+ * Chunks de ceros (flag STREAM_FLAG_SPARSE): un header con compressed_size
+ * igual a CHUNK_ZERO_MARKER y sin payload representa original_size bytes a
+ * cero. Al descomprimir se convierten en huecos del archivo de salida.
+ */
+#define STREAM_FLAG_SPARSE 0x02
+#define STREAM_FLAGS_OFFSET 5
+#define CHUNK_ZERO_MARKER 0xFFFFFFFFu
+
 typedef enum {
     STAGE_COMPRESS,
     STAGE_DECOMPRESS,
@@ -27,6 +54,19 @@ typedef enum {
     STAGE_COPY
 } stage_type_t;
 
+typedef struct {
+    uint64_t compressed_offset;
+    uint64_t original_offset;
+} chunk_index_entry_t;
+
+typedef struct {
+    chunk_index_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    uint64_t original_total;
+    uint64_t chunks_end;        // Fin del último chunk (no se serializa)
+} chunk_index_t;
+
 static size_t get_chunk_size(void) {
     return DEFAULT_STREAM_CHUNK_SIZE;
 }
@@ -43,6 +83,11 @@ static void store_u32_le(unsigned char *dst, uint32_t value) {
     dst[3] = (unsigned char)((value >> 24) & 0xFFu);
 }
 
+static void store_u64_le(unsigned char *dst, uint64_t value) {
+    store_u32_le(dst, (uint32_t)(value & 0xFFFFFFFFu));
+    store_u32_le(dst + 4, (uint32_t)(value >> 32));
+}
+
 static uint16_t load_u16_le(const unsigned char *src) {
     return (uint16_t)src[0] | ((uint16_t)src[1] << 8);
 }
@@ -54,6 +99,10 @@ static uint32_t load_u32_le(const unsigned char *src) {
            ((uint32_t)src[3] << 24);
 }
 
+static uint64_t load_u64_le(const unsigned char *src) {
+    return (uint64_t)load_u32_le(src) | ((uint64_t)load_u32_le(src + 4) << 32);
+}
+
 static int write_all(int fd, const unsigned char *data, size_t size) {
     size_t total_written = 0;
     while (total_written < size) {
@@ -69,6 +118,25 @@ static int write_all(int fd, const unsigned char *data, size_t size) {
     return 0;
 }
 
+static int read_exact_at(int fd, unsigned char *buffer, size_t size, off_t offset) {
+    size_t total_read = 0;
+    while (total_read < size) {
+        ssize_t read_bytes = pread(fd, buffer + total_read, size - total_read,
+                                   offset + (off_t)total_read);
+        if (read_bytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (read_bytes == 0) {
+            return -2;
+        }
+        total_read += (size_t)read_bytes;
+    }
+    return 0;
+}
+
 static int ensure_parent_directory(const char *path) {
     char parent[MAX_PATH_LENGTH];
     strncpy(parent, path, MAX_PATH_LENGTH - 1);
@@ -86,6 +154,22 @@ static int ensure_parent_directory(const char *path) {
     return 0;
 }
 
+/* Fija el tamaño definitivo de una salida preasignada con preallocate_file(). */
+static int set_output_size(int fd, uint64_t size, const char *path) {
+    if (ftruncate(fd, (off_t)size) != 0) {
+        fprintf(stderr, "Error: No se pudo ajustar el tamaño de '%s' - %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* Aplica la política de durabilidad a una salida completada. */
+static void finish_output(int fd, const program_config_t *config, const char *path) {
+    if (config->durability == DURABILITY_PER_FILE) {
+        sync_file_descriptor(fd, path);
+    }
+}
+
 static int create_temp_path(char *buffer, size_t length) {
     if (length < 1) {
         return -1;
@@ -100,17 +184,16 @@ static int create_temp_path(char *buffer, size_t length) {
     return 0;
 }
 
-static int write_stream_header(int fd, compression_alg_t alg, uint32_t chunk_size) {
-    unsigned char header[12];
+static void fill_stream_header(unsigned char *header, compression_alg_t alg, uint32_t chunk_size,
+                               unsigned char flags) {
     memcpy(header, STREAM_MAGIC, 4);
     header[4] = (unsigned char)alg;
-    header[5] = 0;
+    header[5] = flags;
     store_u16_le(header + 6, STREAM_VERSION);
     store_u32_le(header + 8, chunk_size);
-    return write_all(fd, header, sizeof(header));
 }
 
-static int read_stream_header(int fd, compression_alg_t *alg, uint32_t *chunk_size) {
+static int read_stream_header(int fd, compression_alg_t *alg, uint32_t *chunk_size, unsigned char *flags) {
     unsigned char header[12];
     ssize_t read_bytes = read(fd, header, sizeof(header));
     if (read_bytes == -1) {
@@ -137,6 +220,7 @@ static int read_stream_header(int fd, compression_alg_t *alg, uint32_t *chunk_si
     }
 
     *alg = (compression_alg_t)header[4];
+    *flags = header[5];
     *chunk_size = load_u32_le(header + 8);
     if (*chunk_size == 0) {
         *chunk_size = DEFAULT_STREAM_CHUNK_SIZE;
@@ -144,13 +228,6 @@ static int read_stream_header(int fd, compression_alg_t *alg, uint32_t *chunk_si
     return 1;
 }
 
-static int write_chunk_header(int fd, uint32_t original_size, uint32_t compressed_size) {
-    unsigned char buffer[8];
-    store_u32_le(buffer, original_size);
-    store_u32_le(buffer + 4, compressed_size);
-    return write_all(fd, buffer, sizeof(buffer));
-}
-
 static int read_chunk_header(int fd, uint32_t *original_size, uint32_t *compressed_size, int *eof) {
     unsigned char buffer[8];
     ssize_t read_bytes = read(fd, buffer, sizeof(buffer));
@@ -171,6 +248,165 @@ static int read_chunk_header(int fd, uint32_t *original_size, uint32_t *compress
     return 0;
 }
 
+static int is_zero_chunk(unsigned char flags, uint32_t compressed_size) {
+    return (flags & STREAM_FLAG_SPARSE) && compressed_size == CHUNK_ZERO_MARKER;
+}
+
+/* Bytes de payload que siguen al header del chunk */
+static uint32_t chunk_payload_size(unsigned char flags, uint32_t compressed_size) {
+    return is_zero_chunk(flags, compressed_size) ? 0 : compressed_size;
+}
+
+static int buffer_is_zero(const unsigned char *data, size_t size) {
+    return size > 0 && data[0] == 0 && memcmp(data, data + 1, size - 1) == 0;
+}
+
+static void free_chunk_index(chunk_index_t *index) {
+    free(index->entries);
+    index->entries = NULL;
+    index->count = 0;
+    index->capacity = 0;
+    index->original_total = 0;
+    index->chunks_end = 0;
+}
+
+static int append_chunk_index(chunk_index_t *index, uint64_t compressed_offset, uint64_t original_size) {
+    if (index->count == index->capacity) {
+        size_t new_capacity = index->capacity == 0 ? 64 : index->capacity * 2;
+        chunk_index_entry_t *bigger = (chunk_index_entry_t *)realloc(index->entries,
+                                                                     new_capacity * sizeof(*bigger));
+        if (!bigger) {
+            return -1;
+        }
+        index->entries = bigger;
+        index->capacity = new_capacity;
+    }
+
+    index->entries[index->count].compressed_offset = compressed_offset;
+    index->entries[index->count].original_offset = index->original_total;
+    index->count++;
+    index->original_total += original_size;
+    return 0;
+}
+
+/* Terminador 0/0, bloque de índice y trailer en un buffer (malloc) listo para el sink */
+static unsigned char *build_chunk_index(const chunk_index_t *index, uint64_t index_offset, size_t *size) {
+    *size = CHUNK_HEADER_SIZE + STREAM_INDEX_HEADER_SIZE +
+            index->count * STREAM_INDEX_ENTRY_SIZE + STREAM_TRAILER_SIZE;
+    unsigned char *buffer = (unsigned char *)malloc(*size);
+    if (!buffer) {
+        return NULL;
+    }
+
+    unsigned char *ptr = buffer;
+    memset(ptr, 0, CHUNK_HEADER_SIZE);
+    ptr += CHUNK_HEADER_SIZE;
+
+    memcpy(ptr, STREAM_INDEX_MAGIC, 4);
+    store_u32_le(ptr + 4, (uint32_t)index->count);
+    ptr += STREAM_INDEX_HEADER_SIZE;
+
+    for (size_t i = 0; i < index->count; ++i) {
+        store_u64_le(ptr, index->entries[i].compressed_offset);
+        store_u64_le(ptr + 8, index->entries[i].original_offset);
+        ptr += STREAM_INDEX_ENTRY_SIZE;
+    }
+
+    store_u64_le(ptr, index_offset);
+    store_u64_le(ptr + 8, index->original_total);
+    store_u32_le(ptr + 16, (uint32_t)index->count);
+    memcpy(ptr + 20, STREAM_TRAILER_MAGIC, 4);
+    return buffer;
+}
+
+/* Carga el índice a partir del trailer. Devuelve 0 si es válido, -1 si no. */
+static int load_chunk_index(int fd, chunk_index_t *index) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        st.st_size < (off_t)(STREAM_HEADER_SIZE + STREAM_INDEX_HEADER_SIZE + STREAM_TRAILER_SIZE)) {
+        return -1;
+    }
+
+    unsigned char trailer[STREAM_TRAILER_SIZE];
+    if (read_exact_at(fd, trailer, sizeof(trailer), st.st_size - STREAM_TRAILER_SIZE) != 0) {
+        return -1;
+    }
+    if (memcmp(trailer + 20, STREAM_TRAILER_MAGIC, 4) != 0) {
+        return -1;
+    }
+
+    uint64_t index_offset = load_u64_le(trailer);
+    uint64_t original_total = load_u64_le(trailer + 8);
+    uint32_t count = load_u32_le(trailer + 16);
+    uint64_t expected_end = index_offset + STREAM_INDEX_HEADER_SIZE +
+                            (uint64_t)count * STREAM_INDEX_ENTRY_SIZE + STREAM_TRAILER_SIZE;
+    if (expected_end != (uint64_t)st.st_size) {
+        return -1;
+    }
+
+    unsigned char header[STREAM_INDEX_HEADER_SIZE];
+    if (read_exact_at(fd, header, sizeof(header), (off_t)index_offset) != 0 ||
+        memcmp(header, STREAM_INDEX_MAGIC, 4) != 0 ||
+        load_u32_le(header + 4) != count) {
+        return -1;
+    }
+
+    size_t table_size = (size_t)count * STREAM_INDEX_ENTRY_SIZE;
+    unsigned char *table = (unsigned char *)malloc(table_size > 0 ? table_size : 1);
+    index->entries = (chunk_index_entry_t *)malloc((count > 0 ? count : 1) * sizeof(chunk_index_entry_t));
+    if (!table || !index->entries) {
+        free(table);
+        free_chunk_index(index);
+        return -1;
+    }
+
+    if (read_exact_at(fd, table, table_size, (off_t)(index_offset + STREAM_INDEX_HEADER_SIZE)) != 0) {
+        free(table);
+        free_chunk_index(index);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        index->entries[i].compressed_offset = load_u64_le(table + (size_t)i * STREAM_INDEX_ENTRY_SIZE);
+        index->entries[i].original_offset = load_u64_le(table + (size_t)i * STREAM_INDEX_ENTRY_SIZE + 8);
+    }
+    free(table);
+
+    index->count = count;
+    index->capacity = count;
+    index->original_total = original_total;
+    index->chunks_end = index_offset - CHUNK_HEADER_SIZE;
+    return 0;
+}
+
+/* Reconstruye el índice recorriendo solo los headers de chunk (sin descomprimir). */
+static int scan_chunk_index(int fd, unsigned char flags, chunk_index_t *index) {
+    uint64_t offset = STREAM_HEADER_SIZE;
+    while (1) {
+        unsigned char buffer[CHUNK_HEADER_SIZE];
+        int rc = read_exact_at(fd, buffer, sizeof(buffer), (off_t)offset);
+        if (rc == -2) {
+            break;
+        }
+        if (rc != 0) {
+            return -1;
+        }
+
+        uint32_t raw_size = load_u32_le(buffer);
+        uint32_t compressed_size = load_u32_le(buffer + 4);
+        if ((flags & STREAM_FLAG_INDEXED) && raw_size == 0 && compressed_size == 0) {
+            break;
+        }
+
+        if (append_chunk_index(index, offset, raw_size) != 0) {
+            return -1;
+        }
+        offset += CHUNK_HEADER_SIZE + (uint64_t)chunk_payload_size(flags, compressed_size);
+    }
+    index->chunks_end = offset;
+    return 0;
+}
+
 static compression_result_t run_compress_chunk(compression_alg_t alg,
                                                const unsigned char *data,
                                                size_t size) {
@@ -205,135 +441,587 @@ static compression_result_t run_decompress_chunk(compression_alg_t alg,
     }
 }
 
-static int compress_file_chunked(const program_config_t *config,
-                                 const char *input_path,
-                                 const char *output_path,
-                                 size_t chunk_size) {
-    if (ensure_parent_directory(output_path) != 0) {
-        fprintf(stderr, "Error: No se pudo preparar el directorio de salida '%s'\n", output_path);
+/*
+ * Fuente de chunks de entrada: recorre una proyección mmap del archivo cuando
+ * es posible (sin copia al espacio de usuario), mantiene varias lecturas en
+ * vuelo con io_uring si se pidió --io-uring, o lee con read() a un buffer.
+ * Con --direct-io lee con O_DIRECT a un buffer alineado o, si el sistema de
+ * archivos no lo admite, descarta del page cache lo ya leído. En archivos
+ * dispersos los chunks que caen por completo en un hueco no se leen: se
+ * devuelven con 'hole' activo y sin datos.
+ */
+typedef struct {
+    int fd;
+    file_mapping_t mapping;
+    int use_mapping;
+    async_reader_t *async;
+    int direct;
+    int drop_cache;
+    off_t dropped;
+    int sparse;
+    int hole;
+    off_t size;
+    size_t position;
+    unsigned char *buffer;
+    size_t chunk_size;
+} chunk_source_t;
+
+/* Encola todos los chunks del archivo en un lector io_uring. -1 si no se puede. */
+static int chunk_source_open_async(chunk_source_t *source) {
+    struct stat st;
+    if (fstat(source->fd, &st) != 0) {
         return -1;
     }
 
-    int in_fd = open(input_path, O_RDONLY);
-    if (in_fd == -1) {
+    source->async = async_reader_open(source->fd, source->chunk_size, ASYNC_IO_QUEUE_DEPTH);
+    if (!source->async) {
+        return -1;
+    }
+
+    for (off_t offset = 0; offset < st.st_size; offset += (off_t)source->chunk_size) {
+        size_t remaining = (size_t)(st.st_size - offset);
+        size_t length = remaining < source->chunk_size ? remaining : source->chunk_size;
+        if (async_reader_enqueue(source->async, offset, length) != 0) {
+            async_reader_close(source->async);
+            source->async = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Abre la entrada sin cache: O_DIRECT si el tamaño de chunk está alineado. */
+static int chunk_source_open_uncached(chunk_source_t *source, const char *input_path) {
+    source->fd = open_uncached_readonly(input_path, &source->direct);
+    if (source->fd == -1) {
+        return -1;
+    }
+
+    if (source->direct && source->chunk_size % FILE_DIRECT_IO_ALIGNMENT != 0) {
+        disable_direct_io(source->fd);
+        source->direct = 0;
+    }
+    source->drop_cache = 1;
+    return 0;
+}
+
+static int chunk_source_open(chunk_source_t *source, const char *input_path,
+                             size_t chunk_size, int use_async, int uncached) {
+    memset(source, 0, sizeof(*source));
+    source->fd = -1;
+    source->chunk_size = chunk_size;
+
+    /* Entrada dispersa: se recorre con read() para poder saltar los huecos */
+    struct stat st;
+    if (stat(input_path, &st) == 0 && S_ISREG(st.st_mode) &&
+        (off_t)st.st_blocks * 512 < st.st_size) {
+        source->sparse = 1;
+        source->size = st.st_size;
+        use_async = 0;
+    }
+
+    off_t input_size = get_file_size(input_path);
+    if (!use_async && !uncached && !source->sparse && input_size >= (off_t)FILE_MAP_MIN_SIZE &&
+        map_file_readonly(input_path, &source->mapping) == 0) {
+        source->use_mapping = 1;
+        return 0;
+    }
+
+    if (uncached) {
+        chunk_source_open_uncached(source, input_path);
+    } else {
+        source->fd = open(input_path, O_RDONLY);
+    }
+    if (source->fd == -1) {
         fprintf(stderr, "Error: No se pudo abrir '%s' para lectura - %s\n",
                 input_path, strerror(errno));
         return -1;
     }
 
-    int out_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    if (out_fd == -1) {
-        fprintf(stderr, "Error: No se pudo abrir '%s' para escritura - %s\n",
-                output_path, strerror(errno));
-        close(in_fd);
-        return -1;
+    if (use_async && chunk_source_open_async(source) == 0) {
+        return 0;
     }
 
-    unsigned char *buffer = (unsigned char *)malloc(chunk_size);
-    if (!buffer) {
+    /* O_DIRECT exige buffer alineado; posix_memalign sirve también para free() */
+    source->buffer = (unsigned char *)alloc_aligned_buffer(chunk_size);
+    if (!source->buffer) {
         fprintf(stderr, "Error: No se pudo asignar buffer de %zu bytes\n", chunk_size);
-        close(in_fd);
-        close(out_fd);
+        close(source->fd);
+        source->fd = -1;
         return -1;
     }
+    return 0;
+}
 
-    if (write_stream_header(out_fd, config->comp_alg, (uint32_t)chunk_size) != 0) {
-        fprintf(stderr, "Error: No se pudo escribir header de stream en '%s'\n", output_path);
-        free(buffer);
-        close(in_fd);
-        close(out_fd);
-        return -1;
+/* Devuelve el tamaño del siguiente chunk, 0 en EOF o -1 en error. */
+static ssize_t chunk_source_next(chunk_source_t *source, const unsigned char **data) {
+    if (source->use_mapping) {
+        size_t remaining = source->mapping.size - source->position;
+        size_t size = remaining < source->chunk_size ? remaining : source->chunk_size;
+        *data = source->mapping.data + source->position;
+        source->position += size;
+        return (ssize_t)size;
     }
 
-    size_t total_input_bytes = 0;
-    size_t total_output_bytes = STREAM_HEADER_SIZE;
-    size_t total_payload_bytes = 0;
+    if (source->async) {
+        return async_reader_next(source->async, data);
+    }
 
-    ssize_t bytes_read;
-    while ((bytes_read = read(in_fd, buffer, chunk_size)) > 0) {
-        total_input_bytes += (size_t)bytes_read;
-        compression_result_t compressed = run_compress_chunk(config->comp_alg, buffer, (size_t)bytes_read);
-        if (compressed.error != 0) {
-            fprintf(stderr, "Error: Falló la compresión del chunk (código %d)\n", compressed.error);
-            free(buffer);
-            close(in_fd);
-            close(out_fd);
+    source->hole = 0;
+    if (source->sparse && (off_t)source->position < source->size) {
+        off_t position = (off_t)source->position;
+        off_t remaining = source->size - position;
+        size_t size = remaining < (off_t)source->chunk_size ? (size_t)remaining : source->chunk_size;
+        off_t data_offset = next_data_offset(source->fd, position);
+        if (data_offset >= position + (off_t)size) {
+            source->hole = 1;
+            source->position += size;
+        }
+        /* SEEK_DATA mueve el cursor: dejarlo al inicio del chunk que toca leer */
+        if (lseek(source->fd, (off_t)source->position, SEEK_SET) == -1) {
             return -1;
         }
+        if (source->hole) {
+            *data = NULL;
+            return (ssize_t)size;
+        }
+    }
 
-        if (write_chunk_header(out_fd, (uint32_t)bytes_read, (uint32_t)compressed.size) != 0) {
-            fprintf(stderr, "Error: No se pudo escribir header de chunk en '%s'\n", output_path);
-            free(buffer);
-            free_compression_result(&compressed);
-            close(in_fd);
-            close(out_fd);
+    ssize_t bytes_read;
+    while (1) {
+        bytes_read = read(source->fd, source->buffer, source->chunk_size);
+        if (bytes_read == -1 && errno == EINTR) {
+            continue;
+        }
+        /* El sistema de archivos aceptó O_DIRECT en open() pero no lo soporta */
+        if (bytes_read == -1 && errno == EINVAL && source->direct &&
+            disable_direct_io(source->fd) == 0) {
+            source->direct = 0;
+            continue;
+        }
+        break;
+    }
+
+    if (bytes_read > 0) {
+        source->position += (size_t)bytes_read;
+        if (source->drop_cache && !source->direct &&
+            (off_t)source->position - source->dropped >= FILE_CACHE_DROP_WINDOW) {
+            drop_file_cache(source->fd, source->dropped, (off_t)source->position - source->dropped, 0);
+            source->dropped = (off_t)source->position;
+        }
+    }
+
+    *data = source->buffer;
+    return bytes_read;
+}
+
+static void chunk_source_close(chunk_source_t *source) {
+    if (source->use_mapping) {
+        unmap_file(&source->mapping);
+    }
+    async_reader_close(source->async);
+    if (source->drop_cache && !source->direct && source->fd != -1) {
+        drop_file_cache(source->fd, source->dropped, (off_t)source->position - source->dropped, 0);
+    }
+    if (source->fd != -1) {
+        close(source->fd);
+    }
+    free(source->buffer);
+    source->async = NULL;
+    source->fd = -1;
+    source->buffer = NULL;
+}
+
+/*
+ * Destino de salida: escribe secuencialmente con write() o, con --io-uring,
+ * encola escrituras posicionales que se completan en segundo plano. En ambos
+ * casos el sink toma posesión de los buffers (malloc) que recibe. Con
+ * drop_cache la salida se vuelca y se descarta del page cache por ventanas.
+ * Con clave, cada byte se encripta según su posición en el archivo (el mismo
+ * resultado que la etapa de encriptación sobre el archivo completo).
+ */
+typedef struct {
+    int fd;
+    async_writer_t *async;
+    off_t offset;
+    int drop_cache;
+    off_t dropped;
+    const char *key;            // NULL: sin encriptación al escribir
+    size_t key_len;
+} chunk_sink_t;
+
+/* Vigenère XOR posicional: el byte en 'position' usa key[position % key_len] */
+static void apply_keystream(const char *key, size_t key_len, unsigned char *data, size_t size,
+                            uint64_t position) {
+    size_t key_index = (size_t)(position % key_len);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] ^= (unsigned char)key[key_index];
+        if (++key_index == key_len) {
+            key_index = 0;
+        }
+    }
+}
+
+static void chunk_sink_open(chunk_sink_t *sink, int fd, int use_async, int drop_cache) {
+    sink->fd = fd;
+    sink->async = use_async ? async_writer_open(fd, ASYNC_IO_QUEUE_DEPTH) : NULL;
+    sink->offset = lseek(fd, 0, SEEK_CUR);
+    sink->drop_cache = drop_cache;
+    sink->dropped = 0;
+    sink->key = NULL;
+    sink->key_len = 0;
+}
+
+static int chunk_sink_write(chunk_sink_t *sink, unsigned char *data, size_t size) {
+    off_t offset = sink->offset;
+    sink->offset += (off_t)size;
+    if (sink->key) {
+        apply_keystream(sink->key, sink->key_len, data, size, (uint64_t)offset);
+    }
+    if (sink->async) {
+        return async_writer_write(sink->async, data, size, offset);
+    }
+
+    int rc = write_all(sink->fd, data, size);
+    free(data);
+
+    if (rc == 0 && sink->drop_cache && sink->offset - sink->dropped >= FILE_CACHE_DROP_WINDOW) {
+        drop_file_cache(sink->fd, sink->dropped, sink->offset - sink->dropped, 1);
+        sink->dropped = sink->offset;
+    }
+    return rc;
+}
+
+static int chunk_sink_write_chunk_header(chunk_sink_t *sink, uint32_t original_size,
+                                         uint32_t compressed_size) {
+    unsigned char *header = (unsigned char *)malloc(CHUNK_HEADER_SIZE);
+    if (!header) {
+        return -1;
+    }
+    store_u32_le(header, original_size);
+    store_u32_le(header + 4, compressed_size);
+    return chunk_sink_write(sink, header, CHUNK_HEADER_SIZE);
+}
+
+/* Deja un hueco de 'size' bytes; el tamaño final lo fija set_output_size(). */
+static int chunk_sink_skip(chunk_sink_t *sink, size_t size) {
+    sink->offset += (off_t)size;
+    if (sink->async) {
+        return 0;
+    }
+    return lseek(sink->fd, sink->offset, SEEK_SET) == (off_t)-1 ? -1 : 0;
+}
+
+/* Espera las escrituras pendientes y deja el cursor del fd tras lo escrito. */
+static int chunk_sink_finish(chunk_sink_t *sink) {
+    if (sink->async) {
+        int rc = async_writer_finish(sink->async);
+        sink->async = NULL;
+        if (rc != 0 || lseek(sink->fd, sink->offset, SEEK_SET) == (off_t)-1) {
             return -1;
         }
+    }
 
-        total_output_bytes += CHUNK_HEADER_SIZE;
+    if (sink->drop_cache) {
+        drop_file_cache(sink->fd, sink->dropped, sink->offset - sink->dropped, 1);
+        sink->dropped = sink->offset;
+    }
+    return 0;
+}
 
-        total_payload_bytes += compressed.size;
-        total_output_bytes += compressed.size;
+/* --io-uring es opcional: sin soporte del kernel se avisa una vez y se sigue en modo bloqueante */
+static int use_async_io(const program_config_t *config) {
+    static int warned = 0;
+    if (!config->async_io || config->direct_io) {
+        return 0;
+    }
+    if (async_io_available()) {
+        return 1;
+    }
+    if (!warned) {
+        fprintf(stderr, "Advertencia: io_uring no disponible, se usará E/S bloqueante\n");
+        warned = 1;
+    }
+    return 0;
+}
 
-        if (compressed.size > 0) {
-            if (write_all(out_fd, compressed.data, compressed.size) != 0) {
-                fprintf(stderr, "Error: No se pudo escribir datos de chunk en '%s'\n", output_path);
-                free(buffer);
-                free_compression_result(&compressed);
-                close(in_fd);
-                close(out_fd);
-                return -1;
-            }
+/*
+ * Escritor de streams GSC1: recibe los chunks ya comprimidos en orden y se
+ * encarga de los headers, el índice opcional, el flag de chunks de ceros y el
+ * tamaño final. Lo usan la compresión secuencial y el planificador por chunks.
+ */
+struct chunk_stream_writer {
+    const program_config_t *config;
+    char path[MAX_PATH_LENGTH];
+    int fd;
+    chunk_sink_t sink;
+    chunk_index_t index;
+    unsigned char flags;
+    int encrypted;              // Stream encriptado al escribirse (pipeline de directorios)
+    size_t total_input_bytes;
+    size_t total_output_bytes;
+    size_t total_payload_bytes;
+    size_t zero_chunks;
+};
+
+size_t stream_chunk_size(void) {
+    return get_chunk_size();
+}
+
+static chunk_stream_writer_t *open_stream_writer(const program_config_t *config,
+                                                 const char *output_path,
+                                                 size_t chunk_size,
+                                                 int encrypt) {
+    if (ensure_parent_directory(output_path) != 0) {
+        fprintf(stderr, "Error: No se pudo preparar el directorio de salida '%s'\n", output_path);
+        return NULL;
+    }
+
+    chunk_stream_writer_t *writer = (chunk_stream_writer_t *)calloc(1, sizeof(*writer));
+    unsigned char *header = (unsigned char *)malloc(STREAM_HEADER_SIZE);
+    if (!writer || !header) {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el stream de salida\n");
+        free(writer);
+        free(header);
+        return NULL;
+    }
+    writer->config = config;
+    strncpy(writer->path, output_path, sizeof(writer->path) - 1);
+    writer->flags = config->stream_index ? STREAM_FLAG_INDEXED : 0;
+    writer->encrypted = encrypt;
+    writer->total_output_bytes = STREAM_HEADER_SIZE;
+
+    writer->fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd == -1) {
+        fprintf(stderr, "Error: No se pudo abrir '%s' para escritura - %s\n",
+                output_path, strerror(errno));
+        free(writer);
+        free(header);
+        return NULL;
+    }
+
+    chunk_sink_open(&writer->sink, writer->fd, use_async_io(config), config->direct_io);
+    if (encrypt) {
+        writer->sink.key = config->key;
+        writer->sink.key_len = strlen(config->key);
+    }
+
+    fill_stream_header(header, config->comp_alg, (uint32_t)chunk_size, writer->flags);
+    if (chunk_sink_write(&writer->sink, header, STREAM_HEADER_SIZE) != 0) {
+        fprintf(stderr, "Error: No se pudo escribir header de stream en '%s'\n", output_path);
+        chunk_sink_finish(&writer->sink);
+        close(writer->fd);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+chunk_stream_writer_t *chunk_stream_writer_open(const program_config_t *config,
+                                                const char *output_path,
+                                                size_t chunk_size) {
+    return open_stream_writer(config, output_path, chunk_size, 0);
+}
+
+/*
+ * Comprime un chunk; devuelve 1 (sin resultado) si el chunk es todo ceros.
+ * Con --cache-dir, un chunk ya comprimido antes con el mismo codec se toma de
+ * la caché en lugar de recomprimirlo.
+ */
+int compress_stream_chunk(const program_config_t *config, const unsigned char *data,
+                          size_t size, compression_result_t *result) {
+    if (buffer_is_zero(data, size)) {
+        return 1;
+    }
+
+    chunk_cache_key_t key;
+    int cached = config->cache_dir[0] != '\0' && size >= CHUNK_CACHE_MIN_CHUNK;
+    if (cached && chunk_cache_lookup(config, data, size, &key, result) == 1) {
+        return 0;
+    }
+
+    *result = run_compress_chunk(config->comp_alg, data, size);
+    if (result->error != 0) {
+        fprintf(stderr, "Error: Falló la compresión del chunk (código %d)\n", result->error);
+        return -1;
+    }
+    if (cached) {
+        chunk_cache_store(config, &key, result);
+    }
+    return 0;
+}
+
+/* Añade el siguiente chunk; compressed NULL es un chunk de ceros. Toma posesión de los datos. */
+int chunk_stream_writer_append(chunk_stream_writer_t *writer, size_t original_size,
+                               compression_result_t *compressed) {
+    writer->total_input_bytes += original_size;
+
+    if (writer->config->stream_index &&
+        append_chunk_index(&writer->index, writer->total_output_bytes, (uint64_t)original_size) != 0) {
+        fprintf(stderr, "Error: No se pudo ampliar el índice de chunks\n");
+        if (compressed) {
+            free_compression_result(compressed);
         }
+        return -1;
+    }
 
-        free_compression_result(&compressed);
+    /* Hueco de la entrada o chunk todo a cero: solo el header, sin payload */
+    uint32_t compressed_size = compressed ? (uint32_t)compressed->size : CHUNK_ZERO_MARKER;
+    if (chunk_sink_write_chunk_header(&writer->sink, (uint32_t)original_size, compressed_size) != 0) {
+        fprintf(stderr, "Error: No se pudo escribir header de chunk en '%s'\n", writer->path);
+        if (compressed) {
+            free_compression_result(compressed);
+        }
+        return -1;
     }
+    writer->total_output_bytes += CHUNK_HEADER_SIZE;
 
-    if (bytes_read == -1) {
-        fprintf(stderr, "Error: Falló la lectura de '%s' - %s\n", input_path, strerror(errno));
-        free(buffer);
-        close(in_fd);
-        close(out_fd);
+    if (!compressed) {
+        writer->zero_chunks++;
+        return 0;
+    }
+
+    writer->total_payload_bytes += compressed->size;
+    writer->total_output_bytes += compressed->size;
+
+    /* El sink se queda con el buffer comprimido */
+    unsigned char *data = compressed->data;
+    compressed->data = NULL;
+    if (chunk_sink_write(&writer->sink, data, compressed->size) != 0) {
+        fprintf(stderr, "Error: No se pudo escribir datos de chunk en '%s'\n", writer->path);
+        return -1;
+    }
+    return 0;
+}
+
+static int chunk_stream_writer_complete(chunk_stream_writer_t *writer) {
+    if (writer->config->stream_index) {
+        size_t index_size = 0;
+        uint64_t index_offset = writer->total_output_bytes + CHUNK_HEADER_SIZE;
+        unsigned char *index_data = build_chunk_index(&writer->index, index_offset, &index_size);
+        if (!index_data || chunk_sink_write(&writer->sink, index_data, index_size) != 0) {
+            fprintf(stderr, "Error: No se pudo escribir el índice de chunks en '%s'\n", writer->path);
+            return -1;
+        }
+        writer->total_output_bytes += index_size;
+        printf("      Índice de %zu chunks añadido\n", writer->index.count);
+    }
+
+    if (chunk_sink_finish(&writer->sink) != 0) {
+        fprintf(stderr, "Error: No se pudo completar la escritura de '%s' - %s\n",
+                writer->path, strerror(errno));
         return -1;
     }
 
+    /* El flag de chunks de ceros solo se marca si hizo falta, para que los
+     * streams sin ellos sigan siendo legibles por versiones anteriores */
+    if (writer->zero_chunks > 0) {
+        writer->flags |= STREAM_FLAG_SPARSE;
+        unsigned char flags = writer->flags;
+        if (writer->encrypted) {
+            apply_keystream(writer->sink.key, writer->sink.key_len, &flags, 1, STREAM_FLAGS_OFFSET);
+        }
+        if (pwrite(writer->fd, &flags, 1, STREAM_FLAGS_OFFSET) != 1) {
+            fprintf(stderr, "Error: No se pudo actualizar el header de '%s'\n", writer->path);
+            return -1;
+        }
+        printf("      %zu chunks de ceros almacenados sin payload\n", writer->zero_chunks);
+    }
+
     double ratio = 0.0;
-    if (total_input_bytes > 0) {
-        ratio = (double)total_output_bytes / (double)total_input_bytes;
+    if (writer->total_input_bytes > 0) {
+        ratio = (double)writer->total_output_bytes / (double)writer->total_input_bytes;
     }
 
     printf("    ✓ Compresión completada: %zu → %zu bytes (ratio: %.2f)\n",
-           total_input_bytes, total_output_bytes, ratio);
-    if (total_payload_bytes != total_output_bytes) {
+           writer->total_input_bytes, writer->total_output_bytes, ratio);
+    if (writer->total_payload_bytes != writer->total_output_bytes) {
         printf("      Detalle: datos comprimidos = %zu bytes, overhead = %zu bytes\n",
-               total_payload_bytes, total_output_bytes - total_payload_bytes);
+               writer->total_payload_bytes,
+               writer->total_output_bytes - writer->total_payload_bytes);
     }
-
-    free(buffer);
-    close(in_fd);
-    close(out_fd);
+    finish_output(writer->fd, writer->config, writer->path);
     return 0;
 }
 
+/* Con commit cierra el stream (flags, índice, tamaño); sin él solo libera recursos. */
+int chunk_stream_writer_close(chunk_stream_writer_t *writer, int commit) {
+    if (!writer) {
+        return -1;
+    }
+
+    int status = commit ? chunk_stream_writer_complete(writer) : -1;
+
+    chunk_sink_finish(&writer->sink);
+    free_chunk_index(&writer->index);
+    close(writer->fd);
+    free(writer);
+    return status;
+}
+
+static int compress_file_chunked(const program_config_t *config,
+                                 const char *input_path,
+                                 const char *output_path,
+                                 size_t chunk_size) {
+    int async = use_async_io(config);
+    chunk_source_t source;
+    if (chunk_source_open(&source, input_path, chunk_size, async, config->direct_io) != 0) {
+        return -1;
+    }
+
+    chunk_stream_writer_t *writer = chunk_stream_writer_open(config, output_path, chunk_size);
+    if (!writer) {
+        chunk_source_close(&source);
+        return -1;
+    }
+
+    int ok = 1;
+    const unsigned char *chunk = NULL;
+    ssize_t bytes_read = 0;
+    while (ok && (bytes_read = chunk_source_next(&source, &chunk)) > 0) {
+        compression_result_t compressed = {NULL, 0, 0};
+        int rc = source.hole ? 1 : compress_stream_chunk(config, chunk, (size_t)bytes_read, &compressed);
+        if (rc < 0 ||
+            chunk_stream_writer_append(writer, (size_t)bytes_read, rc == 1 ? NULL : &compressed) != 0) {
+            ok = 0;
+        }
+    }
+
+    if (ok && bytes_read == -1) {
+        fprintf(stderr, "Error: Falló la lectura de '%s' - %s\n", input_path, strerror(errno));
+        ok = 0;
+    }
+
+    int status = chunk_stream_writer_close(writer, ok);
+    chunk_source_close(&source);
+    return status;
+}
+
 static int decompress_legacy_file(const program_config_t *config,
                                   const char *input_path,
                                   const char *output_path) {
-    unsigned char *input_data = NULL;
-    size_t input_size = 0;
-    if (read_file(input_path, &input_data, &input_size) != 0) {
-        fprintf(stderr, "Error: No se pudo leer '%s' para descompresión legacy\n", input_path);
-        return -1;
+    /* Proyección de solo lectura: evita duplicar la entrada en memoria */
+    file_mapping_t mapping;
+    if (map_file_readonly(input_path, &mapping) != 0) {
+        if (read_file(input_path, &mapping.data, &mapping.size) != 0) {
+            fprintf(stderr, "Error: No se pudo leer '%s' para descompresión legacy\n", input_path);
+            return -1;
+        }
+        mapping.mapped = 0;
     }
 
-    compression_result_t result = run_decompress_chunk(config->comp_alg, input_data, input_size);
-    free(input_data);
+    size_t input_size = mapping.size;
+    compression_result_t result = run_decompress_chunk(config->comp_alg, mapping.data, input_size);
+    unmap_file(&mapping);
 
     if (result.error != 0) {
         fprintf(stderr, "Error: Descompresión legacy falló (código %d)\n", result.error);
         return -1;
     }
 
-    if (write_file(output_path, result.data, result.size) != 0) {
+    if (write_file_synced(output_path, result.data, result.size,
+                          config->durability == DURABILITY_PER_FILE ||
+                          config->durability == DURABILITY_DEFAULT) != 0) {
         fprintf(stderr, "Error: No se pudo escribir salida legacy '%s'\n", output_path);
         free_compression_result(&result);
         return -1;
@@ -345,6 +1033,95 @@ static int decompress_legacy_file(const program_config_t *config,
     return 0;
 }
 
+/*
+ * Descompresión con io_uring: los offsets de cada registro (header + payload)
+ * salen del índice o de un recorrido de headers, de modo que las lecturas se
+ * pueden encolar por delante del descompresor.
+ */
+static int decompress_chunks_async(const program_config_t *config, int in_fd, int out_fd,
+                                   unsigned char header_flags,
+                                   const chunk_index_t *index, size_t chunk_size,
+                                   size_t *total_compressed_bytes,
+                                   size_t *total_decompressed_bytes) {
+    async_reader_t *reader = async_reader_open(in_fd, chunk_size + CHUNK_HEADER_SIZE,
+                                               ASYNC_IO_QUEUE_DEPTH);
+    if (!reader) {
+        return 1;
+    }
+
+    int status = -1;
+    chunk_sink_t sink;
+    chunk_sink_open(&sink, out_fd, 1, 0);
+
+    for (size_t i = 0; i < index->count; ++i) {
+        uint64_t start = index->entries[i].compressed_offset;
+        uint64_t end = i + 1 < index->count ? index->entries[i + 1].compressed_offset : index->chunks_end;
+        if (async_reader_enqueue(reader, (off_t)start, (size_t)(end - start)) != 0) {
+            fprintf(stderr, "Error: No se pudo encolar la lectura de chunks\n");
+            goto cleanup;
+        }
+    }
+
+    for (size_t i = 0; i < index->count; ++i) {
+        const unsigned char *record = NULL;
+        ssize_t record_size = async_reader_next(reader, &record);
+        if (record_size == -1) {
+            fprintf(stderr, "Error: Lectura fallida de chunk - %s\n", strerror(errno));
+            goto cleanup;
+        }
+        if (record_size < CHUNK_HEADER_SIZE) {
+            fprintf(stderr, "Error: Archivo comprimido truncado\n");
+            goto cleanup;
+        }
+
+        uint32_t raw_size = load_u32_le(record);
+        uint32_t compressed_size = load_u32_le(record + 4);
+        if (is_zero_chunk(header_flags, compressed_size)) {
+            *total_compressed_bytes += CHUNK_HEADER_SIZE;
+            *total_decompressed_bytes += raw_size;
+            chunk_sink_skip(&sink, raw_size);
+            continue;
+        }
+        if ((size_t)record_size - CHUNK_HEADER_SIZE < compressed_size) {
+            fprintf(stderr, "Error: Archivo comprimido incompleto\n");
+            goto cleanup;
+        }
+
+        *total_compressed_bytes += CHUNK_HEADER_SIZE + compressed_size;
+
+        compression_result_t decompressed = run_decompress_chunk(config->comp_alg,
+                                                                  record + CHUNK_HEADER_SIZE,
+                                                                  compressed_size);
+        if (decompressed.error != 0) {
+            fprintf(stderr, "Error: Descompresión de chunk falló (código %d)\n", decompressed.error);
+            goto cleanup;
+        }
+
+        if (raw_size != 0 && decompressed.size != raw_size) {
+            fprintf(stderr, "Advertencia: Tamaño chunk esperado %u, obtenido %zu\n",
+                    raw_size, decompressed.size);
+        }
+
+        *total_decompressed_bytes += decompressed.size;
+        if (chunk_sink_write(&sink, decompressed.data, decompressed.size) != 0) {
+            fprintf(stderr, "Error: No se pudo escribir salida descomprimida - %s\n",
+                    strerror(errno));
+            goto cleanup;
+        }
+    }
+
+    if (chunk_sink_finish(&sink) != 0) {
+        fprintf(stderr, "Error: No se pudo escribir salida descomprimida - %s\n", strerror(errno));
+        goto cleanup;
+    }
+    status = 0;
+
+cleanup:
+    chunk_sink_finish(&sink);
+    async_reader_close(reader);
+    return status;
+}
+
 static int decompress_file_chunked(const program_config_t *config,
                                    const char *input_path,
                                    const char *output_path,
@@ -362,7 +1139,8 @@ static int decompress_file_chunked(const program_config_t *config,
 
     compression_alg_t header_alg = COMP_ALG_NONE;
     uint32_t header_chunk_size = 0;
-    int header_status = read_stream_header(in_fd, &header_alg, &header_chunk_size);
+    unsigned char header_flags = 0;
+    int header_status = read_stream_header(in_fd, &header_alg, &header_chunk_size, &header_flags);
     if (header_status == -1) {
         close(in_fd);
         return -1;
@@ -392,6 +1170,48 @@ static int decompress_file_chunked(const program_config_t *config,
         return -1;
     }
 
+    /* El tamaño final se conoce por el índice o por los headers: se reserva de una vez */
+    chunk_index_t index = {0};
+    if (!(header_flags & STREAM_FLAG_INDEXED) || load_chunk_index(in_fd, &index) != 0) {
+        free_chunk_index(&index);
+        if (scan_chunk_index(in_fd, header_flags, &index) != 0) {
+            fprintf(stderr, "Error: No se pudo recorrer los chunks - %s\n", strerror(errno));
+            free_chunk_index(&index);
+            close(in_fd);
+            close(out_fd);
+            return -1;
+        }
+    }
+    /* Con chunks de ceros la salida debe quedar dispersa: no se reserva */
+    if (!(header_flags & STREAM_FLAG_SPARSE)) {
+        preallocate_file(out_fd, (off_t)index.original_total);
+    }
+
+    size_t total_compressed_bytes = STREAM_HEADER_SIZE;
+    size_t total_decompressed_bytes = 0;
+
+    if (use_async_io(config)) {
+        int rc = decompress_chunks_async(config, in_fd, out_fd, header_flags, &index, chunk_size,
+                                         &total_compressed_bytes, &total_decompressed_bytes);
+        if (rc != 1) {
+            free_chunk_index(&index);
+            close(in_fd);
+            if (rc == 0) {
+                rc = set_output_size(out_fd, total_decompressed_bytes, output_path);
+            }
+            if (rc == 0) {
+                printf("    ✓ Descompresión completada: %zu → %zu bytes\n",
+                       total_compressed_bytes, total_decompressed_bytes);
+                finish_output(out_fd, config, output_path);
+            } else {
+                release_preallocation(out_fd);
+            }
+            close(out_fd);
+            return rc;
+        }
+    }
+    free_chunk_index(&index);
+
     unsigned char *compressed_buffer = NULL;
     size_t compressed_capacity = chunk_size * 2;
     if (compressed_capacity < chunk_size + 256) {
@@ -402,12 +1222,14 @@ static int decompress_file_chunked(const program_config_t *config,
     if (!compressed_buffer) {
         fprintf(stderr, "Error: No se pudo asignar buffer de descompresión\n");
         close(in_fd);
+        release_preallocation(out_fd);
         close(out_fd);
         return -1;
     }
 
-    size_t total_compressed_bytes = STREAM_HEADER_SIZE;
-    size_t total_decompressed_bytes = 0;
+    chunk_sink_t sink;
+    chunk_sink_open(&sink, out_fd, 0, config->direct_io);
+    off_t input_dropped = 0;
 
     while (1) {
         uint32_t raw_size = 0;
@@ -418,6 +1240,7 @@ static int decompress_file_chunked(const program_config_t *config,
             fprintf(stderr, "Error: No se pudo leer header de chunk - %s\n", strerror(errno));
             free(compressed_buffer);
             close(in_fd);
+            release_preallocation(out_fd);
             close(out_fd);
             return -1;
         }
@@ -425,6 +1248,7 @@ static int decompress_file_chunked(const program_config_t *config,
             fprintf(stderr, "Error: Archivo comprimido truncado\n");
             free(compressed_buffer);
             close(in_fd);
+            release_preallocation(out_fd);
             close(out_fd);
             return -1;
         }
@@ -432,12 +1256,33 @@ static int decompress_file_chunked(const program_config_t *config,
             break;
         }
 
+        /* Terminador antes del índice: el resto del archivo no son chunks */
+        if ((header_flags & STREAM_FLAG_INDEXED) && raw_size == 0 && compressed_size == 0) {
+            break;
+        }
+
+        /* Chunk de ceros: se salta en la salida y queda como hueco */
+        if (is_zero_chunk(header_flags, compressed_size)) {
+            total_compressed_bytes += CHUNK_HEADER_SIZE;
+            total_decompressed_bytes += raw_size;
+            if (chunk_sink_skip(&sink, raw_size) != 0) {
+                fprintf(stderr, "Error: No se pudo avanzar en la salida - %s\n", strerror(errno));
+                free(compressed_buffer);
+                close(in_fd);
+                release_preallocation(out_fd);
+                close(out_fd);
+                return -1;
+            }
+            continue;
+        }
+
         if (compressed_size > compressed_capacity) {
             unsigned char *bigger = (unsigned char *)realloc(compressed_buffer, compressed_size);
             if (!bigger) {
                 fprintf(stderr, "Error: No se pudo ampliar buffer de compresión\n");
                 free(compressed_buffer);
                 close(in_fd);
+                release_preallocation(out_fd);
                 close(out_fd);
                 return -1;
             }
@@ -455,6 +1300,7 @@ static int decompress_file_chunked(const program_config_t *config,
                 fprintf(stderr, "Error: Lectura fallida de chunk - %s\n", strerror(errno));
                 free(compressed_buffer);
                 close(in_fd);
+                release_preallocation(out_fd);
                 close(out_fd);
                 return -1;
             }
@@ -462,6 +1308,7 @@ static int decompress_file_chunked(const program_config_t *config,
                 fprintf(stderr, "Error: Archivo comprimido incompleto\n");
                 free(compressed_buffer);
                 close(in_fd);
+                release_preallocation(out_fd);
                 close(out_fd);
                 return -1;
             }
@@ -469,6 +1316,11 @@ static int decompress_file_chunked(const program_config_t *config,
         }
 
         total_compressed_bytes += CHUNK_HEADER_SIZE + compressed_size;
+        if (config->direct_io &&
+            (off_t)total_compressed_bytes - input_dropped >= FILE_CACHE_DROP_WINDOW) {
+            drop_file_cache(in_fd, input_dropped, (off_t)total_compressed_bytes - input_dropped, 0);
+            input_dropped = (off_t)total_compressed_bytes;
+        }
 
         compression_result_t decompressed = run_decompress_chunk(config->comp_alg,
                                                                   compressed_buffer,
@@ -477,6 +1329,7 @@ static int decompress_file_chunked(const program_config_t *config,
             fprintf(stderr, "Error: Descompresión de chunk falló (código %d)\n", decompressed.error);
             free(compressed_buffer);
             close(in_fd);
+            release_preallocation(out_fd);
             close(out_fd);
             return -1;
         }
@@ -491,19 +1344,29 @@ static int decompress_file_chunked(const program_config_t *config,
 
         total_decompressed_bytes += decompressed.size;
 
-        if (decompressed.size > 0) {
-            if (write_all(out_fd, decompressed.data, decompressed.size) != 0) {
-                fprintf(stderr, "Error: No se pudo escribir salida descomprimida - %s\n",
-                        strerror(errno));
-                free(compressed_buffer);
-                free_compression_result(&decompressed);
-                close(in_fd);
-                close(out_fd);
-                return -1;
-            }
+        /* El sink se queda con el buffer descomprimido */
+        if (chunk_sink_write(&sink, decompressed.data, decompressed.size) != 0) {
+            fprintf(stderr, "Error: No se pudo escribir salida descomprimida - %s\n",
+                    strerror(errno));
+            free(compressed_buffer);
+            close(in_fd);
+            release_preallocation(out_fd);
+            close(out_fd);
+            return -1;
         }
+    }
 
-        free_compression_result(&decompressed);
+    chunk_sink_finish(&sink);
+    if (config->direct_io) {
+        drop_file_cache(in_fd, input_dropped, (off_t)total_compressed_bytes - input_dropped, 0);
+    }
+
+    if (set_output_size(out_fd, total_decompressed_bytes, output_path) != 0) {
+        free(compressed_buffer);
+        close(in_fd);
+        release_preallocation(out_fd);
+        close(out_fd);
+        return -1;
     }
 
     printf("    ✓ Descompresión completada: %zu → %zu bytes\n",
@@ -511,10 +1374,182 @@ static int decompress_file_chunked(const program_config_t *config,
 
     free(compressed_buffer);
     close(in_fd);
+    finish_output(out_fd, config, output_path);
     close(out_fd);
     return 0;
 }
 
+static int decompress_file_range(const program_config_t *config,
+                                 const char *input_path,
+                                 const char *output_path) {
+    if (ensure_parent_directory(output_path) != 0) {
+        fprintf(stderr, "Error: No se pudo preparar directorio para '%s'\n", output_path);
+        return -1;
+    }
+
+    int in_fd = open(input_path, O_RDONLY);
+    if (in_fd == -1) {
+        fprintf(stderr, "Error: No se pudo abrir '%s' - %s\n", input_path, strerror(errno));
+        return -1;
+    }
+
+    compression_alg_t header_alg = COMP_ALG_NONE;
+    uint32_t header_chunk_size = 0;
+    unsigned char header_flags = 0;
+    int header_status = read_stream_header(in_fd, &header_alg, &header_chunk_size, &header_flags);
+    if (header_status != 1) {
+        if (header_status == 0) {
+            fprintf(stderr, "Error: '%s' no es un stream por chunks; --range no es aplicable\n", input_path);
+        }
+        close(in_fd);
+        return -1;
+    }
+
+    if (header_alg != config->comp_alg) {
+        fprintf(stderr, "Error: Algoritmo del archivo (%d) no coincide con configuración (%d)\n",
+                header_alg, config->comp_alg);
+        close(in_fd);
+        return -1;
+    }
+
+    chunk_index_t index = {0};
+    int have_index = 0;
+    if (header_flags & STREAM_FLAG_INDEXED) {
+        have_index = (load_chunk_index(in_fd, &index) == 0);
+        if (!have_index) {
+            fprintf(stderr, "Advertencia: Índice de chunks inválido, recorriendo headers\n");
+        }
+    }
+    if (!have_index && scan_chunk_index(in_fd, header_flags, &index) != 0) {
+        fprintf(stderr, "Error: No se pudo recorrer los chunks de '%s'\n", input_path);
+        free_chunk_index(&index);
+        close(in_fd);
+        return -1;
+    }
+
+    uint64_t range_start = (uint64_t)config->range_offset;
+    if (range_start >= index.original_total) {
+        fprintf(stderr, "Error: El offset %zu está fuera del contenido (%llu bytes)\n",
+                config->range_offset, (unsigned long long)index.original_total);
+        free_chunk_index(&index);
+        close(in_fd);
+        return -1;
+    }
+
+    uint64_t range_end = range_start + (uint64_t)config->range_length;
+    if (range_end > index.original_total || range_end < range_start) {
+        range_end = index.original_total;
+    }
+
+    /* Búsqueda binaria del último chunk cuyo offset original es <= range_start */
+    size_t low = 0;
+    size_t high = index.count;
+    while (high - low > 1) {
+        size_t mid = low + (high - low) / 2;
+        if (index.entries[mid].original_offset <= range_start) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    size_t first_chunk = low;
+
+    int out_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd == -1) {
+        fprintf(stderr, "Error: No se pudo abrir '%s' para escritura - %s\n",
+                output_path, strerror(errno));
+        free_chunk_index(&index);
+        close(in_fd);
+        return -1;
+    }
+
+    unsigned char *compressed_buffer = NULL;
+    size_t compressed_capacity = 0;
+    size_t chunks_used = 0;
+    size_t total_written = 0;
+    int status = 0;
+
+    for (size_t i = first_chunk;
+         status == 0 && i < index.count && index.entries[i].original_offset < range_end;
+         ++i) {
+        unsigned char chunk_header[CHUNK_HEADER_SIZE];
+        off_t chunk_offset = (off_t)index.entries[i].compressed_offset;
+        if (read_exact_at(in_fd, chunk_header, sizeof(chunk_header), chunk_offset) != 0) {
+            fprintf(stderr, "Error: No se pudo leer header del chunk %zu\n", i);
+            status = -1;
+            break;
+        }
+
+        uint32_t raw_size = load_u32_le(chunk_header);
+        uint32_t compressed_size = load_u32_le(chunk_header + 4);
+        if (is_zero_chunk(header_flags, compressed_size)) {
+            compressed_size = 0;
+        }
+        if (compressed_size > compressed_capacity) {
+            unsigned char *bigger = (unsigned char *)realloc(compressed_buffer, compressed_size);
+            if (!bigger) {
+                fprintf(stderr, "Error: No se pudo ampliar buffer de compresión\n");
+                status = -1;
+                break;
+            }
+            compressed_buffer = bigger;
+            compressed_capacity = compressed_size;
+        }
+
+        if (read_exact_at(in_fd, compressed_buffer, compressed_size,
+                          chunk_offset + CHUNK_HEADER_SIZE) != 0) {
+            fprintf(stderr, "Error: Archivo comprimido incompleto en el chunk %zu\n", i);
+            status = -1;
+            break;
+        }
+
+        compression_result_t decompressed;
+        if (is_zero_chunk(header_flags, load_u32_le(chunk_header + 4))) {
+            decompressed.data = (unsigned char *)calloc(raw_size > 0 ? raw_size : 1, 1);
+            decompressed.size = raw_size;
+            decompressed.error = decompressed.data ? 0 : -1;
+        } else {
+            decompressed = run_decompress_chunk(config->comp_alg, compressed_buffer, compressed_size);
+        }
+        if (decompressed.error != 0) {
+            fprintf(stderr, "Error: Descompresión de chunk falló (código %d)\n", decompressed.error);
+            status = -1;
+            break;
+        }
+
+        uint64_t chunk_start = index.entries[i].original_offset;
+        uint64_t chunk_end = chunk_start + decompressed.size;
+        uint64_t slice_start = range_start > chunk_start ? range_start : chunk_start;
+        uint64_t slice_end = range_end < chunk_end ? range_end : chunk_end;
+
+        if (slice_end > slice_start) {
+            size_t slice_size = (size_t)(slice_end - slice_start);
+            if (write_all(out_fd, decompressed.data + (slice_start - chunk_start), slice_size) != 0) {
+                fprintf(stderr, "Error: No se pudo escribir salida del rango - %s\n", strerror(errno));
+                status = -1;
+            } else {
+                total_written += slice_size;
+            }
+        }
+
+        chunks_used++;
+        free_compression_result(&decompressed);
+    }
+
+    if (status == 0) {
+        finish_output(out_fd, config, output_path);
+        printf("    ✓ Rango extraído: %zu bytes desde offset %zu (%zu de %zu chunks%s)\n",
+               total_written, config->range_offset, chunks_used, index.count,
+               have_index ? ", vía índice" : "");
+    }
+
+    free(compressed_buffer);
+    free_chunk_index(&index);
+    close(in_fd);
+    close(out_fd);
+    return status;
+}
+
 static int encrypt_file_stream(const program_config_t *config,
                                const char *input_path,
                                const char *output_path,
@@ -587,11 +1622,14 @@ static int encrypt_file_stream(const program_config_t *config,
     free(buffer);
     free(output);
     close(in_fd);
+    finish_output(out_fd, config, output_path);
     close(out_fd);
     return 0;
 }
 
-static int copy_file_stream(const char *input_path, const char *output_path) {
+static int copy_file_stream(const program_config_t *config,
+                            const char *input_path,
+                            const char *output_path) {
     if (ensure_parent_directory(output_path) != 0) {
         fprintf(stderr, "Error: No se pudo preparar directorio para '%s'\n", output_path);
         return -1;
@@ -610,6 +1648,18 @@ static int copy_file_stream(const char *input_path, const char *output_path) {
         return -1;
     }
 
+    /* Copia dentro del kernel del tamaño conocido; el bucle con buffer solo
+       procesa lo que quede (entradas no regulares o que crecieron). */
+    struct stat in_stat;
+    if (fstat(in_fd, &in_stat) == 0 && S_ISREG(in_stat.st_mode) && in_stat.st_size > 0) {
+        if (copy_file_region(in_fd, NULL, out_fd, (size_t)in_stat.st_size) != 0) {
+            fprintf(stderr, "Error: No se pudo copiar '%s' en '%s'\n", input_path, output_path);
+            close(in_fd);
+            close(out_fd);
+            return -1;
+        }
+    }
+
     size_t chunk_size = get_chunk_size();
     unsigned char *buffer = (unsigned char *)malloc(chunk_size);
     if (!buffer) {
@@ -640,6 +1690,7 @@ static int copy_file_stream(const char *input_path, const char *output_path) {
 
     free(buffer);
     close(in_fd);
+    finish_output(out_fd, config, output_path);
     close(out_fd);
     return 0;
 }
@@ -653,6 +1704,11 @@ static int run_stage(stage_type_t stage,
             printf("  → Comprimiendo '%s' → '%s'\n", input_path, output_path);
             return compress_file_chunked(config, input_path, output_path, get_chunk_size());
         case STAGE_DECOMPRESS:
+            if (config->range_enabled) {
+                printf("  → Extrayendo rango %zu:%zu de '%s' → '%s'\n",
+                       config->range_offset, config->range_length, input_path, output_path);
+                return decompress_file_range(config, input_path, output_path);
+            }
             printf("  → Descomprimiendo '%s' → '%s'\n", input_path, output_path);
             return decompress_file_chunked(config, input_path, output_path, get_chunk_size());
         case STAGE_ENCRYPT:
@@ -663,7 +1719,7 @@ static int run_stage(stage_type_t stage,
             return encrypt_file_stream(config, input_path, output_path, 0);
         case STAGE_COPY:
             printf("  → Copiando '%s' → '%s'\n", input_path, output_path);
-            return copy_file_stream(input_path, output_path);
+            return copy_file_stream(config, input_path, output_path);
     }
     return -1;
 }
@@ -703,6 +1759,10 @@ int execute_file_pipeline(const program_config_t *config,
     char temp_path[MAX_PATH_LENGTH];
     int temp_active = 0;
 
+    /* Los temporales intermedios se borran al terminar: nunca se sincronizan */
+    program_config_t intermediate_config = *config;
+    intermediate_config.durability = DURABILITY_NONE;
+
     for (size_t i = 0; i < stage_count; ++i) {
         int is_last = (i == stage_count - 1);
         char next_temp[MAX_PATH_LENGTH];
@@ -721,7 +1781,8 @@ int execute_file_pipeline(const program_config_t *config,
             target_path = next_temp;
         }
 
-        if (run_stage(stages[i], config, current_input, target_path) != 0) {
+        const program_config_t *stage_config = is_last ? config : &intermediate_config;
+        if (run_stage(stages[i], stage_config, current_input, target_path) != 0) {
             if (!is_last) {
                 unlink(target_path);
             }
@@ -751,4 +1812,392 @@ int execute_file_pipeline(const program_config_t *config,
     }
 
     return 0;
-}
\ No newline at end of file
+}
+/*
+ * Pipeline en streaming para datos que no existen como archivo (el archive de
+ * un directorio). El escritor recibe los bytes en claro, los agrupa en chunks,
+ * los comprime y los encripta al escribirlos; el lector hace lo inverso sobre
+ * la marcha. El resultado es idéntico al de execute_file_pipeline() sobre el
+ * mismo contenido, sin archivos intermedios.
+ */
+struct pipeline_writer {
+    const program_config_t *config;
+    char path[MAX_PATH_LENGTH];
+    chunk_stream_writer_t *stream;  // Con compresión
+    int fd;                         // Sin compresión: salida directa
+    unsigned char *buffer;
+    size_t capacity;
+    size_t used;
+    uint64_t position;              // Bytes escritos en la salida directa
+};
+
+static int pipeline_writer_flush(pipeline_writer_t *writer) {
+    if (writer->used == 0) {
+        return 0;
+    }
+
+    size_t size = writer->used;
+    writer->used = 0;
+    if (writer->stream) {
+        compression_result_t compressed = {NULL, 0, 0};
+        int rc = compress_stream_chunk(writer->config, writer->buffer, size, &compressed);
+        if (rc < 0) {
+            return -1;
+        }
+        return chunk_stream_writer_append(writer->stream, size, rc == 1 ? NULL : &compressed);
+    }
+
+    if (writer->config->operations & OP_ENCRYPT) {
+        apply_keystream(writer->config->key, strlen(writer->config->key), writer->buffer, size,
+                        writer->position);
+    }
+    writer->position += size;
+    if (write_all(writer->fd, writer->buffer, size) != 0) {
+        fprintf(stderr, "Error: No se pudo escribir en '%s' - %s\n", writer->path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+pipeline_writer_t *pipeline_writer_open(const program_config_t *config, const char *output_path) {
+    if ((config->operations & (OP_DECOMPRESS | OP_DECRYPT)) != 0) {
+        fprintf(stderr, "Error: El pipeline de escritura solo admite compresión y encriptación\n");
+        return NULL;
+    }
+
+    pipeline_writer_t *writer = (pipeline_writer_t *)calloc(1, sizeof(*writer));
+    if (!writer) {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el pipeline de escritura\n");
+        return NULL;
+    }
+    writer->config = config;
+    writer->fd = -1;
+    writer->capacity = get_chunk_size();
+    strncpy(writer->path, output_path, sizeof(writer->path) - 1);
+    writer->buffer = (unsigned char *)malloc(writer->capacity);
+    if (!writer->buffer) {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el pipeline de escritura\n");
+        free(writer);
+        return NULL;
+    }
+
+    if (config->operations & OP_COMPRESS) {
+        writer->stream = open_stream_writer(config, output_path, writer->capacity,
+                                            (config->operations & OP_ENCRYPT) != 0);
+        if (!writer->stream) {
+            free(writer->buffer);
+            free(writer);
+            return NULL;
+        }
+        return writer;
+    }
+
+    if (ensure_parent_directory(output_path) != 0) {
+        fprintf(stderr, "Error: No se pudo preparar directorio para '%s'\n", output_path);
+        free(writer->buffer);
+        free(writer);
+        return NULL;
+    }
+    writer->fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd == -1) {
+        fprintf(stderr, "Error: No se pudo abrir '%s' - %s\n", output_path, strerror(errno));
+        free(writer->buffer);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int pipeline_writer_write(pipeline_writer_t *writer, const unsigned char *data, size_t size) {
+    while (size > 0) {
+        size_t room = writer->capacity - writer->used;
+        size_t take = size < room ? size : room;
+        memcpy(writer->buffer + writer->used, data, take);
+        writer->used += take;
+        data += take;
+        size -= take;
+
+        if (writer->used == writer->capacity && pipeline_writer_flush(writer) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Con commit vacía el último chunk y cierra la salida; sin él solo libera recursos. */
+int pipeline_writer_close(pipeline_writer_t *writer, int commit) {
+    if (!writer) {
+        return -1;
+    }
+
+    int ok = commit && pipeline_writer_flush(writer) == 0;
+    int status = 0;
+    if (writer->stream) {
+        status = chunk_stream_writer_close(writer->stream, ok);
+    } else {
+        status = ok ? 0 : -1;
+        if (ok) {
+            printf("    ✓ Encriptación completada: %llu bytes\n", (unsigned long long)writer->position);
+            finish_output(writer->fd, writer->config, writer->path);
+        }
+        close(writer->fd);
+    }
+
+    free(writer->buffer);
+    free(writer);
+    return status;
+}
+
+struct pipeline_reader {
+    const program_config_t *config;
+    int fd;
+    int owns_fd;                    // Abierto por pipeline_reader_open(); se cierra al terminar
+    off_t base_offset;              // Con un rango: inicio en fd, leído con pread()
+    uint64_t limit;                 // Con un rango: bytes del stream
+    const char *key;                // Con desencriptación
+    size_t key_len;
+    uint64_t position;              // Bytes leídos de la entrada
+    int decompress;
+    unsigned char flags;
+    unsigned char *compressed;
+    size_t compressed_capacity;
+    compression_result_t chunk;     // Chunk descomprimido en curso
+    size_t chunk_offset;
+    size_t zero_remaining;          // Bytes pendientes de un chunk de ceros
+    int finished;
+    size_t total_input_bytes;
+    size_t total_output_bytes;
+};
+
+/* Lee 'size' bytes desencriptados; *got < size solo al llegar al final */
+static int pipeline_reader_raw(pipeline_reader_t *reader, unsigned char *buffer, size_t size, size_t *got) {
+    *got = 0;
+    if (reader->limit != UINT64_MAX && size > reader->limit - reader->position) {
+        size = (size_t)(reader->limit - reader->position);
+    }
+    while (*got < size) {
+        ssize_t n = reader->owns_fd ?
+                    read(reader->fd, buffer + *got, size - *got) :
+                    pread(reader->fd, buffer + *got, size - *got,
+                          reader->base_offset + (off_t)(reader->position + *got));
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error: Falló la lectura del stream - %s\n", strerror(errno));
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        *got += (size_t)n;
+    }
+
+    if (reader->key) {
+        apply_keystream(reader->key, reader->key_len, buffer, *got, reader->position);
+    }
+    reader->position += *got;
+    return 0;
+}
+
+static int pipeline_reader_next_chunk(pipeline_reader_t *reader) {
+    unsigned char header[CHUNK_HEADER_SIZE];
+    size_t got = 0;
+    if (pipeline_reader_raw(reader, header, sizeof(header), &got) != 0) {
+        return -1;
+    }
+    if (got == 0) {
+        reader->finished = 1;
+        return 0;
+    }
+    if (got != sizeof(header)) {
+        fprintf(stderr, "Error: Archivo comprimido truncado\n");
+        return -1;
+    }
+
+    uint32_t raw_size = load_u32_le(header);
+    uint32_t compressed_size = load_u32_le(header + 4);
+    reader->total_input_bytes += CHUNK_HEADER_SIZE;
+
+    /* Terminador antes del índice: el resto del archivo no son chunks */
+    if ((reader->flags & STREAM_FLAG_INDEXED) && raw_size == 0 && compressed_size == 0) {
+        reader->finished = 1;
+        return 0;
+    }
+
+    if (is_zero_chunk(reader->flags, compressed_size)) {
+        reader->zero_remaining = raw_size;
+        reader->total_output_bytes += raw_size;
+        return 0;
+    }
+
+    if (compressed_size > reader->compressed_capacity) {
+        unsigned char *bigger = (unsigned char *)realloc(reader->compressed, compressed_size);
+        if (!bigger) {
+            fprintf(stderr, "Error: No se pudo ampliar buffer de compresión\n");
+            return -1;
+        }
+        reader->compressed = bigger;
+        reader->compressed_capacity = compressed_size;
+    }
+    if (pipeline_reader_raw(reader, reader->compressed, compressed_size, &got) != 0) {
+        return -1;
+    }
+    if (got != compressed_size) {
+        fprintf(stderr, "Error: Archivo comprimido incompleto\n");
+        return -1;
+    }
+    reader->total_input_bytes += compressed_size;
+
+    free_compression_result(&reader->chunk);
+    reader->chunk = run_decompress_chunk(reader->config->comp_alg, reader->compressed, compressed_size);
+    reader->chunk_offset = 0;
+    if (reader->chunk.error != 0) {
+        fprintf(stderr, "Error: Descompresión de chunk falló (código %d)\n", reader->chunk.error);
+        return -1;
+    }
+    if (raw_size != 0 && reader->chunk.size != raw_size) {
+        fprintf(stderr, "Advertencia: Tamaño chunk esperado %u, obtenido %zu\n",
+                raw_size, reader->chunk.size);
+    }
+    reader->total_output_bytes += reader->chunk.size;
+    return 0;
+}
+
+/* Lee el header del stream y deja el lector listo; cierra el lector si falla */
+static int pipeline_reader_start(const program_config_t *config, int fd, int owns_fd, off_t base_offset,
+                                 uint64_t limit, pipeline_reader_t **out) {
+    *out = NULL;
+    if ((config->operations & (OP_COMPRESS | OP_ENCRYPT)) != 0) {
+        fprintf(stderr, "Error: El pipeline de lectura solo admite descompresión y desencriptación\n");
+        if (owns_fd) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    pipeline_reader_t *reader = (pipeline_reader_t *)calloc(1, sizeof(*reader));
+    if (!reader) {
+        fprintf(stderr, "Error: No se pudo asignar memoria para el pipeline de lectura\n");
+        if (owns_fd) {
+            close(fd);
+        }
+        return -1;
+    }
+    reader->config = config;
+    reader->fd = fd;
+    reader->owns_fd = owns_fd;
+    reader->base_offset = base_offset;
+    reader->limit = limit;
+    reader->decompress = (config->operations & OP_DECOMPRESS) != 0;
+    if (config->operations & OP_DECRYPT) {
+        reader->key = config->key;
+        reader->key_len = strlen(config->key);
+    }
+
+    if (reader->decompress) {
+        unsigned char header[STREAM_HEADER_SIZE];
+        size_t got = 0;
+        if (pipeline_reader_raw(reader, header, sizeof(header), &got) != 0) {
+            pipeline_reader_close(reader);
+            return -1;
+        }
+        if (got != sizeof(header) || memcmp(header, STREAM_MAGIC, 4) != 0) {
+            pipeline_reader_close(reader);
+            return 1;
+        }
+        if (load_u16_le(header + 6) != STREAM_VERSION) {
+            fprintf(stderr, "Error: versión de stream incompatible (%u)\n", load_u16_le(header + 6));
+            pipeline_reader_close(reader);
+            return -1;
+        }
+        if ((compression_alg_t)header[4] != config->comp_alg) {
+            fprintf(stderr, "Error: Algoritmo del archivo (%d) no coincide con configuración (%d)\n",
+                    header[4], config->comp_alg);
+            pipeline_reader_close(reader);
+            return -1;
+        }
+        reader->flags = header[5];
+        reader->total_input_bytes = STREAM_HEADER_SIZE;
+    }
+
+    *out = reader;
+    return 0;
+}
+
+/* 0 listo, 1 si la entrada no es un stream GSC1 (formato anterior), -1 error */
+int pipeline_reader_open(const program_config_t *config, const char *input_path,
+                         pipeline_reader_t **out) {
+    *out = NULL;
+    int fd = open(input_path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Error: No se pudo abrir '%s' - %s\n", input_path, strerror(errno));
+        return -1;
+    }
+    return pipeline_reader_start(config, fd, 1, 0, UINT64_MAX, out);
+}
+
+/*
+ * Igual que pipeline_reader_open(), pero sobre los 'length' bytes que empiezan
+ * en 'offset' de un descriptor ya abierto (una entrada dentro de un archive).
+ * Solo hace lecturas posicionales, así que varios lectores pueden compartir el
+ * descriptor; no se cierra al terminar.
+ */
+int pipeline_reader_open_range(const program_config_t *config, int fd, uint64_t offset, uint64_t length,
+                               pipeline_reader_t **out) {
+    return pipeline_reader_start(config, fd, 0, (off_t)offset, length, out);
+}
+
+/* Hasta 'size' bytes en claro; 0 al final del stream, -1 si hay error */
+ssize_t pipeline_reader_read(pipeline_reader_t *reader, unsigned char *buffer, size_t size) {
+    if (!reader->decompress) {
+        size_t got = 0;
+        if (pipeline_reader_raw(reader, buffer, size, &got) != 0) {
+            return -1;
+        }
+        reader->total_output_bytes += got;
+        return (ssize_t)got;
+    }
+
+    size_t copied = 0;
+    while (copied < size) {
+        if (reader->zero_remaining > 0) {
+            size_t take = size - copied < reader->zero_remaining ? size - copied : reader->zero_remaining;
+            memset(buffer + copied, 0, take);
+            reader->zero_remaining -= take;
+            copied += take;
+            continue;
+        }
+        if (reader->chunk.data && reader->chunk_offset < reader->chunk.size) {
+            size_t available = reader->chunk.size - reader->chunk_offset;
+            size_t take = size - copied < available ? size - copied : available;
+            memcpy(buffer + copied, reader->chunk.data + reader->chunk_offset, take);
+            reader->chunk_offset += take;
+            copied += take;
+            continue;
+        }
+        if (reader->finished) {
+            break;
+        }
+        if (pipeline_reader_next_chunk(reader) != 0) {
+            return -1;
+        }
+    }
+    return (ssize_t)copied;
+}
+
+void pipeline_reader_close(pipeline_reader_t *reader) {
+    if (!reader) {
+        return;
+    }
+    if (reader->decompress && reader->finished) {
+        printf("    ✓ Descompresión completada: %zu → %zu bytes\n",
+               reader->total_input_bytes, reader->total_output_bytes);
+    }
+    free_compression_result(&reader->chunk);
+    free(reader->compressed);
+    if (reader->owns_fd) {
+        close(reader->fd);
+    }
+    free(reader);
+}
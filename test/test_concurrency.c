@@ -6,6 +6,30 @@
 #include <time.h>
 #include "../include/file_manager.h"
 #include "../include/dir_utils.h"
+#include "../include/args_parser.h"
+#include "../include/concurrency.h"
+#include "../include/archive.h"
+#include "../include/dedup.h"
+#include "../include/manifest.h"
+
+/**
+ * @brief Configuración de compresión RLE de un directorio con N hilos
+ */
+static void make_directory_config(program_config_t *config, const char *input_dir,
+                                  const char *output_dir, int threads) {
+    memset(config, 0, sizeof(*config));
+    config->operations = OP_COMPRESS;
+    config->comp_alg = COMP_ALG_RLE;
+    config->durability = DURABILITY_NONE;
+    config->num_threads = threads;
+    snprintf(config->input_path, sizeof(config->input_path), "%s", input_dir);
+    snprintf(config->output_path, sizeof(config->output_path), "%s", output_dir);
+    config->valid = 1;
+}
+
+static double elapsed_seconds(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
 
 /**
  * @brief Crea archivos de prueba para testing de concurrencia
@@ -43,13 +67,10 @@ void test_directory_reading() {
     read_directory_recursive(test_dir, &file_list);
     
     assert(file_list.count == 5);
-    printf("   ✓ Correctamente leídos %d archivos\n", file_list.count);
+    printf("   ✓ Correctamente leídos %zu archivos\n", file_list.count);
     
     // Liberar memoria
-    for (int i = 0; i < file_list.count; i++) {
-        free(file_list.paths[i]);
-    }
-    free(file_list.paths);
+    free_file_list(&file_list);
     
     printf("\n");
 }
@@ -70,10 +91,31 @@ void test_performance_comparison() {
     
     printf("   Procesando %d archivos...\n", num_files);
     
-    // TODO: Aquí iría la comparación real de tiempo
-    // Por ahora solo mostramos la estructura
-    printf("   ✓ Estructura de prueba preparada\n");
-    printf("   Nota: La comparación de rendimiento requiere implementación completa\n");
+    program_config_t config;
+    struct timespec start, end;
+
+    make_directory_config(&config, input_dir, output_dir_seq, 1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(process_directory_concurrent(&config) == 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double sequential = elapsed_seconds(&start, &end);
+
+    make_directory_config(&config, input_dir, output_dir_conc, 0);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(process_directory_concurrent(&config) == 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double concurrent = elapsed_seconds(&start, &end);
+
+    FileList seq_list = {0};
+    FileList conc_list = {0};
+    read_directory_recursive(output_dir_seq, &seq_list);
+    read_directory_recursive(output_dir_conc, &conc_list);
+    assert(seq_list.count == (size_t)num_files);
+    assert(conc_list.count == (size_t)num_files);
+    free_file_list(&seq_list);
+    free_file_list(&conc_list);
+
+    printf("   ✓ 1 hilo: %.3fs, %d hilos: %.3fs\n", sequential, default_thread_count(), concurrent);
     
     printf("\n");
 }
@@ -130,19 +172,611 @@ void test_different_file_counts() {
         FileList file_list = {0};
         read_directory_recursive(dir_path, &file_list);
         
-        assert(file_list.count == test_counts[i]);
+        assert(file_list.count == (size_t)test_counts[i]);
         printf("   ✓ Correcto con %d archivos\n", test_counts[i]);
         
         // Liberar memoria
-        for (int j = 0; j < file_list.count; j++) {
-            free(file_list.paths[j]);
-        }
-        free(file_list.paths);
+        free_file_list(&file_list);
     }
     
     printf("\n");
 }
 
+/**
+ * @brief El pool tiene tamaño fijo aunque haya muchos más archivos que hilos
+ */
+void test_bounded_pool() {
+    printf("5. Prueba pool de hilos acotado:\n");
+
+    const char *input_dir = "test/output/pool_input";
+    const char *output_dir = "test/output/pool_output";
+    int num_files = 200;
+    create_test_files(input_dir, num_files);
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, output_dir, 3);
+    assert(resolve_thread_count(&config, (size_t)num_files) == 3);
+    assert(resolve_thread_count(&config, 2) == 2);
+    printf("   ✓ Hilos limitados por --threads y por el número de archivos\n");
+
+    assert(process_directory_concurrent(&config) == 0);
+
+    FileList outputs = {0};
+    read_directory_recursive(output_dir, &outputs);
+    assert(outputs.count == (size_t)num_files);
+    free_file_list(&outputs);
+    printf("   ✓ %d archivos procesados con 3 hilos\n", num_files);
+
+    make_directory_config(&config, input_dir, output_dir, 0);
+    assert(resolve_thread_count(&config, (size_t)num_files) == default_thread_count());
+    printf("   ✓ Por defecto se usan las CPUs en línea (%d)\n", default_thread_count());
+
+    printf("\n");
+}
+
+static int files_equal(const char *a, const char *b) {
+    unsigned char *data_a = NULL;
+    unsigned char *data_b = NULL;
+    size_t size_a = 0;
+    size_t size_b = 0;
+    int equal = read_file(a, &data_a, &size_a) == 0 && read_file(b, &data_b, &size_b) == 0 &&
+                size_a == size_b && memcmp(data_a, data_b, size_a) == 0;
+    free(data_a);
+    free(data_b);
+    return equal;
+}
+
+/**
+ * @brief Robo de trabajo: un archivo grande se reparte por chunks entre hilos
+ */
+void test_work_stealing_mixed() {
+    printf("6. Prueba robo de trabajo con archivos grandes y pequeños:\n");
+
+    const char *input_dir = "test/output/steal_input";
+    const char *steal_dir = "test/output/steal_output";
+    const char *queue_dir = "test/output/steal_output_queue";
+    create_test_files(input_dir, 8);
+
+    // 5 MB con datos repetitivos, un tramo de ceros y cola parcial
+    size_t big_size = 5 * 1024 * 1024 + 4321;
+    unsigned char *big = (unsigned char *)malloc(big_size);
+    assert(big != NULL);
+    for (size_t i = 0; i < big_size; i++) {
+        big[i] = (unsigned char)((i / 37) % 11 + 'a');
+    }
+    memset(big + 2 * 1024 * 1024, 0, 1024 * 1024);
+    assert(write_file("test/output/steal_input/big.bin", big, big_size) == 0);
+    free(big);
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, steal_dir, 4);
+    config.stream_index = 1;
+    assert(config.scheduler == SCHEDULER_WORK_STEALING);
+    assert(process_directory_concurrent(&config) == 0);
+    printf("   ✓ Directorio mixto procesado con 4 hilos\n");
+
+    make_directory_config(&config, input_dir, queue_dir, 1);
+    config.stream_index = 1;
+    config.scheduler = SCHEDULER_SHARED_QUEUE;
+    assert(process_directory_concurrent(&config) == 0);
+
+    FileList outputs = {0};
+    read_directory_recursive(steal_dir, &outputs);
+    assert(outputs.count == 9);
+    for (size_t i = 0; i < outputs.count; i++) {
+        const char *name = strrchr(outputs.paths[i], '/') + 1;
+        char other[512];
+        snprintf(other, sizeof(other), "%s/%s", queue_dir, name);
+        assert(files_equal(outputs.paths[i], other));
+    }
+    free_file_list(&outputs);
+    printf("   ✓ Salidas idénticas a las del procesamiento por archivos completos\n");
+
+    printf("\n");
+}
+
+/**
+ * @brief Modo por archivo: árbol espejo con la extensión del algoritmo
+ */
+void test_mirrored_output_tree() {
+    printf("7. Prueba árbol de salida espejo:\n");
+
+    const char *input_dir = "test/output/mirror_input";
+    const char *compressed_dir = "test/output/mirror_compressed";
+    const char *restored_dir = "test/output/mirror_restored";
+    create_directory("test/output/mirror_input/docs/2024");
+    const char *content = "AAAAAAAAAABBBBBBBBBBCCCCCCCCCC";
+    assert(write_file("test/output/mirror_input/docs/2024/report.txt",
+                      (const unsigned char *)content, strlen(content)) == 0);
+    assert(write_file("test/output/mirror_input/notes.txt",
+                      (const unsigned char *)content, strlen(content)) == 0);
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, compressed_dir, 2);
+    config.comp_alg = COMP_ALG_LZW;
+    char *path = generate_output_path("test/output/mirror_input/docs/2024/report.txt",
+                                      compressed_dir, &config);
+    assert(strcmp(path, "test/output/mirror_compressed/docs/2024/report.txt.lzw") == 0);
+    free(path);
+    assert(process_directory_concurrent(&config) == 0);
+    assert(file_exists("test/output/mirror_compressed/docs/2024/report.txt.lzw"));
+    assert(file_exists("test/output/mirror_compressed/notes.txt.lzw"));
+    printf("   ✓ Rutas relativas conservadas con extensión .lzw\n");
+
+    make_directory_config(&config, compressed_dir, restored_dir, 2);
+    config.operations = OP_DECOMPRESS;
+    config.comp_alg = COMP_ALG_LZW;
+    assert(process_directory_concurrent(&config) == 0);
+    assert(files_equal("test/output/mirror_input/docs/2024/report.txt",
+                       "test/output/mirror_restored/docs/2024/report.txt"));
+    assert(files_equal("test/output/mirror_input/notes.txt",
+                       "test/output/mirror_restored/notes.txt"));
+    printf("   ✓ Descompresión por archivo restaura los nombres originales\n");
+
+    printf("\n");
+}
+
+/**
+ * @brief Archive v2: entradas comprimidas y encriptadas en paralelo
+ */
+void test_parallel_archive_v2() {
+    printf("8. Prueba archive v2 construido en paralelo:\n");
+
+    const char *input_dir = "test/output/archive_v2_input";
+    const char *archive_path = "test/output/archive_v2.gsea";
+    const char *restored_dir = "test/output/archive_v2_restored";
+    create_directory("test/output/archive_v2_input/sub");
+    create_test_files(input_dir, 6);
+    const char *content = "Entrada anidada del archive v2 - Entrada anidada del archive v2";
+    assert(write_file("test/output/archive_v2_input/sub/nested.txt",
+                      (const unsigned char *)content, strlen(content)) == 0);
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, archive_path, 3);
+    config.operations = OP_COMPRESS | OP_ENCRYPT;
+    config.comp_alg = COMP_ALG_HUFFMAN;
+    config.enc_alg = ENC_ALG_VIGENERE;
+    config.archive_format = ARCHIVE_FORMAT_V2;
+    strcpy(config.key, "clave_v2");
+    assert(compress_and_encrypt_directory(&config, archive_path) == 0);
+    assert(is_archive_v2_file(archive_path));
+    assert(!is_gsea_archive_file(archive_path));
+    printf("   ✓ Archive v2 generado con 3 hilos\n");
+
+    make_directory_config(&config, archive_path, restored_dir, 3);
+    config.operations = OP_DECRYPT | OP_DECOMPRESS;
+    strcpy(config.key, "clave_v2");
+    assert(decrypt_and_decompress_directory(&config, restored_dir) == 0);
+    assert(files_equal("test/output/archive_v2_input/sub/nested.txt",
+                       "test/output/archive_v2_restored/sub/nested.txt"));
+    assert(files_equal("test/output/archive_v2_input/test_file_0.txt",
+                       "test/output/archive_v2_restored/test_file_0.txt"));
+    assert(files_equal("test/output/archive_v2_input/test_file_5.txt",
+                       "test/output/archive_v2_restored/test_file_5.txt"));
+    printf("   ✓ Extracción restaura todas las entradas\n");
+
+    printf("\n");
+}
+
+/**
+ * @brief Archive v2: listado y extracción selectiva con verificación CRC32
+ */
+void test_selective_archive_extraction() {
+    printf("9. Prueba extracción selectiva de archive v2:\n");
+
+    const char *input_dir = "test/output/archive_v2_input";
+    const char *archive_path = "test/output/archive_v2_rle.gsea";
+    const char *selected_dir = "test/output/archive_v2_selected";
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, archive_path, 2);
+    config.archive_format = ARCHIVE_FORMAT_V2;
+    assert(compress_directory_only(&config, archive_path) == 0);
+    assert(list_archive_v2(archive_path) == 0);
+    printf("   ✓ Directorio central listado\n");
+
+    make_directory_config(&config, archive_path, selected_dir, 1);
+    config.operations = OP_DECOMPRESS;
+    strcpy(config.extract_pattern, "sub/*.txt");
+    assert(extract_archive_v2(&config, archive_path, selected_dir) == 0);
+    assert(files_equal("test/output/archive_v2_input/sub/nested.txt",
+                       "test/output/archive_v2_selected/sub/nested.txt"));
+    assert(!file_exists("test/output/archive_v2_selected/test_file_0.txt"));
+    printf("   ✓ Solo se extraen las entradas que encajan con el patrón\n");
+
+    strcpy(config.extract_pattern, "no_existe_*");
+    assert(extract_archive_v2(&config, archive_path, selected_dir) != 0);
+    printf("   ✓ Un patrón sin coincidencias se rechaza\n");
+
+    // Alterar un byte de datos de la primera entrada: la extracción debe fallar
+    FILE *archive = fopen(archive_path, "r+b");
+    assert(archive != NULL);
+    assert(fseek(archive, 14 + 12 + 8 + 1, SEEK_SET) == 0);
+    int byte = fgetc(archive);
+    assert(byte != EOF);
+    assert(fseek(archive, -1, SEEK_CUR) == 0);
+    fputc(byte ^ 0x5A, archive);
+    fclose(archive);
+    config.extract_pattern[0] = '\0';
+    assert(extract_archive_v2(&config, archive_path, "test/output/archive_v2_corrupt") != 0);
+    // La entrada alterada depende del orden de los hilos al crear: ninguna salida puede quedar corrupta
+    const char *entries[] = {"test_file_0.txt", "test_file_1.txt", "test_file_2.txt", "test_file_3.txt",
+                             "test_file_4.txt", "test_file_5.txt", "sub/nested.txt"};
+    size_t discarded = 0;
+    for (size_t i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+        char original[MAX_PATH_LENGTH];
+        char extracted[MAX_PATH_LENGTH];
+        snprintf(original, sizeof(original), "%s/%s", input_dir, entries[i]);
+        snprintf(extracted, sizeof(extracted), "test/output/archive_v2_corrupt/%s", entries[i]);
+        if (!file_exists(extracted)) {
+            discarded++;
+        } else {
+            assert(files_equal(original, extracted));
+        }
+    }
+    assert(discarded > 0);
+    printf("   ✓ Entrada alterada detectada y descartada\n");
+
+    printf("\n");
+}
+
+/**
+ * @brief Extracción de archive v1 repartida entre hilos
+ */
+void test_parallel_archive_extraction() {
+    printf("10. Prueba extracción paralela de archive v1:\n");
+
+    const char *input_dir = "test/output/archive_v2_input";
+    const char *archive_path = "test/output/archive_v1_raw.gsea";
+    const char *restored_dir = "test/output/archive_v1_restored";
+    assert(create_directory_archive_file(input_dir, archive_path) == 0);
+    assert(extract_directory_archive_file(archive_path, restored_dir) == 0);
+    assert(files_equal("test/output/archive_v2_input/sub/nested.txt",
+                       "test/output/archive_v1_restored/sub/nested.txt"));
+    for (int i = 0; i < 6; i++) {
+        char original[256];
+        char restored[256];
+        snprintf(original, sizeof(original), "%s/test_file_%d.txt", input_dir, i);
+        snprintf(restored, sizeof(restored), "%s/test_file_%d.txt", restored_dir, i);
+        assert(files_equal(original, restored));
+    }
+    printf("   ✓ Todas las entradas restauradas por el pool\n");
+
+    printf("\n");
+}
+
+static off_t file_size_of(const char *path) {
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    return st.st_size;
+}
+
+/**
+ * @brief Archive v2 con bloques sólidos: archivos pequeños agrupados, grandes aparte
+ */
+void test_solid_archive_blocks() {
+    printf("11. Prueba archive v2 con bloques sólidos:\n");
+
+    const char *input_dir = "test/output/solid_input";
+    const char *solid_path = "test/output/solid.gsea";
+    const char *plain_path = "test/output/solid_plain.gsea";
+    create_directory("test/output/solid_input/conf");
+    for (int i = 0; i < 40; i++) {
+        char path[256];
+        char line[128];
+        snprintf(path, sizeof(path), "%s/conf/app_%d.conf", input_dir, i);
+        int len = snprintf(line, sizeof(line), "servidor=interno\npuerto=%d\nmodo=produccion\n", 8000 + i);
+        assert(write_file(path, (const unsigned char *)line, (size_t)len) == 0);
+    }
+    size_t large_size = 256 * 1024;
+    unsigned char *large = malloc(large_size);
+    assert(large != NULL);
+    for (size_t i = 0; i < large_size; i++) {
+        large[i] = (unsigned char)((i * 7) % 251);
+    }
+    assert(write_file("test/output/solid_input/grande.bin", large, large_size) == 0);
+    free(large);
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, plain_path, 2);
+    config.comp_alg = COMP_ALG_LZW;
+    config.archive_format = ARCHIVE_FORMAT_V2;
+    assert(compress_directory_only(&config, plain_path) == 0);
+    config.solid_blocks = 1;
+    assert(compress_directory_only(&config, solid_path) == 0);
+    assert(list_archive_v2(solid_path) == 0);
+    assert(file_size_of(solid_path) < file_size_of(plain_path));
+    printf("   ✓ Los archivos pequeños comprimidos en bloque ocupan menos (%ld < %ld bytes)\n",
+           (long)file_size_of(solid_path), (long)file_size_of(plain_path));
+
+    make_directory_config(&config, solid_path, "test/output/solid_restored", 2);
+    config.operations = OP_DECOMPRESS;
+    assert(extract_archive_v2(&config, solid_path, "test/output/solid_restored") == 0);
+    assert(files_equal("test/output/solid_input/grande.bin", "test/output/solid_restored/grande.bin"));
+    for (int i = 0; i < 40; i++) {
+        char original[256];
+        char restored[256];
+        snprintf(original, sizeof(original), "%s/conf/app_%d.conf", input_dir, i);
+        snprintf(restored, sizeof(restored), "test/output/solid_restored/conf/app_%d.conf", i);
+        assert(files_equal(original, restored));
+    }
+    printf("   ✓ Entradas sólidas y propias restauradas\n");
+
+    strcpy(config.extract_pattern, "conf/app_7.conf");
+    assert(extract_archive_v2(&config, solid_path, "test/output/solid_selected") == 0);
+    assert(files_equal("test/output/solid_input/conf/app_7.conf", "test/output/solid_selected/conf/app_7.conf"));
+    assert(!file_exists("test/output/solid_selected/conf/app_8.conf"));
+    printf("   ✓ Extracción selectiva de un archivo dentro de un bloque\n");
+
+    printf("\n");
+}
+
+/**
+ * @brief Archivos idénticos: se guardan una vez y el resto son referencias
+ */
+void test_duplicate_entries() {
+    printf("12. Prueba deduplicación de archivos idénticos:\n");
+
+    const char *sample = "Nobody inspects the spammish repetition";
+    assert(dedup_hash64("", 0, 0) == 0xEF46DB3751D8E999ULL);
+    assert(dedup_hash64(sample, strlen(sample), 0) == 0xFBCEA83C8A378BF1ULL);
+    printf("   ✓ XXH64 coincide con los vectores de referencia\n");
+
+    const char *input_dir = "test/output/dedup_input";
+    create_directory("test/output/dedup_input/vendor/a");
+    create_directory("test/output/dedup_input/vendor/b");
+    size_t lib_size = 100 * 1024;
+    unsigned char *lib = malloc(lib_size);
+    assert(lib != NULL);
+    for (size_t i = 0; i < lib_size; i++) {
+        lib[i] = (unsigned char)((i * 131 + (i >> 7)) & 0xFF);
+    }
+    assert(write_file("test/output/dedup_input/vendor/a/lib.bin", lib, lib_size) == 0);
+    assert(write_file("test/output/dedup_input/vendor/b/lib.bin", lib, lib_size) == 0);
+    lib[lib_size / 2] ^= 0xFF;
+    assert(write_file("test/output/dedup_input/casi.bin", lib, lib_size) == 0);
+    free(lib);
+
+    const char *archive_path = "test/output/dedup_raw.gsea";
+    assert(create_directory_archive_file(input_dir, archive_path) == 0);
+    assert(file_size_of(archive_path) < (off_t)(2 * lib_size + 1024));
+    assert(extract_directory_archive_file(archive_path, "test/output/dedup_restored") == 0);
+    assert(files_equal("test/output/dedup_input/vendor/a/lib.bin", "test/output/dedup_restored/vendor/a/lib.bin"));
+    assert(files_equal("test/output/dedup_input/vendor/b/lib.bin", "test/output/dedup_restored/vendor/b/lib.bin"));
+    assert(files_equal("test/output/dedup_input/casi.bin", "test/output/dedup_restored/casi.bin"));
+    printf("   ✓ Archive v1: la copia idéntica es una referencia, la casi idéntica no\n");
+
+    unsigned char *raw = NULL;
+    size_t raw_size = 0;
+    assert(read_file(archive_path, &raw, &raw_size) == 0 && raw_size >= 10);
+    assert(memcmp(raw, "GSEAARCHr1", 10) == 0);
+    free(raw);
+    assert(create_directory_archive_file("test/output/dedup_input/vendor/a", "test/output/dedup_single.gsea") == 0);
+    assert(read_file("test/output/dedup_single.gsea", &raw, &raw_size) == 0 && raw_size >= 10);
+    assert(memcmp(raw, "GSEAARCHv1", 10) == 0);
+    free(raw);
+    printf("   ✓ Solo los archives con referencias cambian de magic\n");
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, "test/output/dedup_v2.gsea", 2);
+    config.archive_format = ARCHIVE_FORMAT_V2;
+    assert(compress_directory_only(&config, "test/output/dedup_v2.gsea") == 0);
+    make_directory_config(&config, "test/output/dedup_v2.gsea", "test/output/dedup_v2_restored", 2);
+    config.operations = OP_DECOMPRESS;
+    assert(extract_archive_v2(&config, "test/output/dedup_v2.gsea", "test/output/dedup_v2_restored") == 0);
+    assert(files_equal("test/output/dedup_input/vendor/b/lib.bin", "test/output/dedup_v2_restored/vendor/b/lib.bin"));
+    printf("   ✓ Archive v2: el duplicado comparte los datos de su original\n");
+
+    printf("\n");
+}
+
+/**
+ * @brief Chunks por contenido: regiones repetidas entre archivos distintos se guardan una vez
+ */
+void test_chunk_dedup_archive() {
+    printf("13. Prueba deduplicación por chunks definidos por contenido:\n");
+
+    size_t base_size = 512 * 1024;
+    unsigned char *base = malloc(base_size + 64);
+    assert(base != NULL);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < base_size; i++) {
+        state = state * 1103515245u + 12345u;
+        base[i] = (unsigned char)(state >> 16);
+    }
+    size_t first = cdc_next_boundary(base, base_size);
+    assert(first >= CDC_MIN_CHUNK && first <= CDC_MAX_CHUNK);
+    printf("   ✓ Primer corte dentro de los límites (%zu bytes)\n", first);
+
+    // Mismo contenido con una inserción al principio y con una edición en medio
+    const char *input_dir = "test/output/chunks_input";
+    create_directory("test/output/chunks_input/v1");
+    create_directory("test/output/chunks_input/v2");
+    assert(write_file("test/output/chunks_input/v1/datos.bin", base, base_size) == 0);
+    memmove(base + 64, base, base_size);
+    memset(base, 'x', 64);
+    assert(write_file("test/output/chunks_input/v2/datos.bin", base, base_size + 64) == 0);
+    memset(base + base_size / 2, 0, 100);
+    assert(write_file("test/output/chunks_input/v2/editado.bin", base, base_size + 64) == 0);
+    free(base);
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, "test/output/chunks_plain.gsea", 2);
+    config.operations = OP_ENCRYPT;
+    config.enc_alg = ENC_ALG_VIGENERE;
+    strcpy(config.key, "clave");
+    config.archive_format = ARCHIVE_FORMAT_V2;
+    assert(compress_directory_only(&config, "test/output/chunks_plain.gsea") == 0);
+    config.dedup_chunks = 1;
+    assert(compress_directory_only(&config, "test/output/chunks.gsea") == 0);
+    assert(list_archive_v2("test/output/chunks.gsea") == 0);
+    assert(file_size_of("test/output/chunks.gsea") < (off_t)(base_size + base_size / 2));
+    printf("   ✓ Tres versiones de 512 KiB ocupan %ld bytes (sin chunks: %ld)\n",
+           (long)file_size_of("test/output/chunks.gsea"), (long)file_size_of("test/output/chunks_plain.gsea"));
+
+    make_directory_config(&config, "test/output/chunks.gsea", "test/output/chunks_restored", 2);
+    config.operations = OP_DECRYPT;
+    config.enc_alg = ENC_ALG_VIGENERE;
+    strcpy(config.key, "clave");
+    assert(extract_archive_v2(&config, "test/output/chunks.gsea", "test/output/chunks_restored") == 0);
+    assert(files_equal("test/output/chunks_input/v1/datos.bin", "test/output/chunks_restored/v1/datos.bin"));
+    assert(files_equal("test/output/chunks_input/v2/datos.bin", "test/output/chunks_restored/v2/datos.bin"));
+    assert(files_equal("test/output/chunks_input/v2/editado.bin", "test/output/chunks_restored/v2/editado.bin"));
+    printf("   ✓ Entradas reconstruidas a partir de sus chunks\n");
+
+    // Los chunks a cero se restauran como huecos, no como bloques escritos
+    size_t zeros_size = 4 * 1024 * 1024;
+    unsigned char *zeros = calloc(1, zeros_size);
+    assert(zeros != NULL);
+    memcpy(zeros + zeros_size - 4, "cola", 4);
+    create_directory("test/output/chunks_sparse_input");
+    assert(write_file("test/output/chunks_sparse_input/disco.img", zeros, zeros_size) == 0);
+    free(zeros);
+    make_directory_config(&config, "test/output/chunks_sparse_input", "test/output/chunks_sparse.gsea", 2);
+    config.archive_format = ARCHIVE_FORMAT_V2;
+    config.dedup_chunks = 1;
+    assert(compress_directory_only(&config, "test/output/chunks_sparse.gsea") == 0);
+    make_directory_config(&config, "test/output/chunks_sparse.gsea", "test/output/chunks_sparse_restored", 2);
+    config.operations = OP_DECOMPRESS;
+    assert(extract_archive_v2(&config, "test/output/chunks_sparse.gsea", "test/output/chunks_sparse_restored") == 0);
+    assert(files_equal("test/output/chunks_sparse_input/disco.img",
+                       "test/output/chunks_sparse_restored/disco.img"));
+    struct stat sparse_st;
+    assert(stat("test/output/chunks_sparse_restored/disco.img", &sparse_st) == 0);
+    assert((off_t)sparse_st.st_blocks * 512 < (off_t)(zeros_size / 4));
+    printf("   ✓ Chunks a cero restaurados como huecos (%lld de %zu bytes ocupados)\n",
+           (long long)sparse_st.st_blocks * 512, zeros_size);
+
+    printf("\n");
+}
+
+/**
+ * @brief --per-file --incremental: solo se reprocesa lo nuevo o modificado
+ */
+void test_incremental_per_file() {
+    printf("14. Prueba compresión incremental con manifiesto:\n");
+
+    const char *input_dir = "test/output/incr_input";
+    const char *output_dir = "test/output/incr_output";
+    const char *content = "linea de log repetida linea de log repetida\n";
+    create_directory("test/output/incr_input/logs");
+    unlink("test/output/incr_output/" MANIFEST_FILE_NAME);
+    for (int i = 0; i < 5; i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/logs/app_%d.log", input_dir, i);
+        assert(write_file(path, (const unsigned char *)content, strlen(content)) == 0);
+    }
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, output_dir, 2);
+    config.comp_alg = COMP_ALG_LZW;
+    config.per_file = 1;
+    config.incremental = 1;
+    assert(process_directory_concurrent(&config) == 0);
+    manifest_t manifest;
+    assert(manifest_load("test/output/incr_output/" MANIFEST_FILE_NAME, &manifest) == 0);
+    assert(manifest.count == 5);
+    manifest_free(&manifest);
+    printf("   ✓ Primera ejecución: 5 archivos procesados y registrados\n");
+
+    // Una salida marcada: si el archivo no cambió, la segunda ejecución no la toca
+    const char *marker = "sin reprocesar";
+    assert(write_file("test/output/incr_output/logs/app_0.log.lzw",
+                      (const unsigned char *)marker, strlen(marker)) == 0);
+    assert(write_file("test/output/incr_input/logs/app_1.log", (const unsigned char *)"otro", 4) == 0);
+    assert(unlink("test/output/incr_input/logs/app_2.log") == 0);
+    assert(process_directory_concurrent(&config) == 0);
+    assert(file_size_of("test/output/incr_output/logs/app_0.log.lzw") == (off_t)strlen(marker));
+    assert(!file_exists("test/output/incr_output/logs/app_2.log.lzw"));
+    printf("   ✓ Sin cambios se conserva la salida; la del archivo borrado se elimina\n");
+
+    make_directory_config(&config, output_dir, "test/output/incr_restored", 2);
+    config.operations = OP_DECOMPRESS;
+    config.comp_alg = COMP_ALG_LZW;
+    config.per_file = 1;
+    assert(unlink("test/output/incr_output/logs/app_0.log.lzw") == 0);
+    assert(process_directory_concurrent(&config) == 0);
+    assert(files_equal("test/output/incr_input/logs/app_1.log", "test/output/incr_restored/logs/app_1.log"));
+    assert(!file_exists("test/output/incr_restored/" MANIFEST_FILE_NAME));
+    printf("   ✓ El archivo modificado se reprocesó y el manifiesto no se descomprime\n");
+
+    // Con otra clave ninguna salida encriptada anterior sirve, aunque la entrada no cambie
+    const char *encrypted_dir = "test/output/incr_encrypted";
+    make_directory_config(&config, input_dir, encrypted_dir, 2);
+    config.operations = OP_COMPRESS | OP_ENCRYPT;
+    config.comp_alg = COMP_ALG_LZW;
+    config.enc_alg = ENC_ALG_VIGENERE;
+    config.per_file = 1;
+    config.incremental = 1;
+    strcpy(config.key, "clave_inicial");
+    unlink("test/output/incr_encrypted/" MANIFEST_FILE_NAME);
+    assert(process_directory_concurrent(&config) == 0);
+    FileList outputs = {0};
+    read_directory_recursive(encrypted_dir, &outputs);
+    size_t marked = 0;
+    for (size_t i = 0; i < outputs.count; i++) {
+        if (strstr(outputs.paths[i], MANIFEST_FILE_NAME) == NULL) {
+            assert(write_file(outputs.paths[i], (const unsigned char *)marker, strlen(marker)) == 0);
+            marked++;
+        }
+    }
+    assert(marked == 4);
+    strcpy(config.key, "clave_nueva");
+    assert(process_directory_concurrent(&config) == 0);
+    for (size_t i = 0; i < outputs.count; i++) {
+        if (strstr(outputs.paths[i], MANIFEST_FILE_NAME) == NULL) {
+            assert(file_size_of(outputs.paths[i]) != (off_t)strlen(marker));
+        }
+    }
+    free_file_list(&outputs);
+    printf("   ✓ Un cambio de clave reescribe todas las salidas\n");
+
+    printf("\n");
+}
+
+void test_streaming_scheduler() {
+    printf("15. Prueba de planificador en streaming:\n");
+
+    const char *input_dir = "test/output/stream_walk_input";
+    char path[256];
+    // Más archivos que la ventana (2 hilos × 64): el recorrido tiene que esperar a los hilos
+    for (int d = 0; d < 6; d++) {
+        snprintf(path, sizeof(path), "%s/dir_%d/sub", input_dir, d);
+        create_directory(path);
+        for (int f = 0; f < 50; f++) {
+            char content[64];
+            snprintf(path, sizeof(path), "%s/dir_%d/%s/file_%d.txt", input_dir, d, f % 2 ? "sub" : ".", f);
+            snprintf(content, sizeof(content), "archivo %d del directorio %d, repetido repetido\n", f, d);
+            assert(write_file(path, (const unsigned char *)content, strlen(content)) == 0);
+        }
+    }
+
+    program_config_t config;
+    make_directory_config(&config, input_dir, "test/output/stream_walk_output", 2);
+    config.comp_alg = COMP_ALG_LZW;
+    config.per_file = 1;
+    config.scheduler = SCHEDULER_STREAMING;
+    assert(process_directory_concurrent(&config) == 0);
+
+    FileList outputs = {0};
+    read_directory_recursive("test/output/stream_walk_output", &outputs);
+    assert(outputs.count == 300);
+    free_file_list(&outputs);
+    printf("   ✓ 300 archivos procesados con una ventana de 128 rutas\n");
+
+    make_directory_config(&config, "test/output/stream_walk_output", "test/output/stream_walk_restored", 2);
+    config.operations = OP_DECOMPRESS;
+    config.comp_alg = COMP_ALG_LZW;
+    config.per_file = 1;
+    config.scheduler = SCHEDULER_STREAMING;
+    assert(process_directory_concurrent(&config) == 0);
+    assert(files_equal("test/output/stream_walk_input/dir_5/sub/file_49.txt",
+                       "test/output/stream_walk_restored/dir_5/sub/file_49.txt"));
+    printf("   ✓ Árbol espejo restaurado también en streaming\n");
+
+    printf("\n");
+}
+
 int main() {
     printf("=== GSEA - Pruebas de Concurrencia ===\n\n");
     
@@ -153,6 +787,17 @@ int main() {
     test_performance_comparison();
     test_concurrent_error_handling();
     test_different_file_counts();
+    test_bounded_pool();
+    test_work_stealing_mixed();
+    test_mirrored_output_tree();
+    test_parallel_archive_v2();
+    test_selective_archive_extraction();
+    test_parallel_archive_extraction();
+    test_solid_archive_blocks();
+    test_duplicate_entries();
+    test_chunk_dedup_archive();
+    test_incremental_per_file();
+    test_streaming_scheduler();
     
     printf("=== Pruebas de concurrencia completadas ===\n");
     printf("Nota: Las pruebas de rendimiento real requieren ejecutar el programa completo\n");
@@ -48,19 +48,6 @@ static int create_file_with_content(const char *path, const char *content) {
     return 0;
 }
 
-static void free_file_list(FileList *list) {
-    if (!list || !list->paths) {
-        return;
-    }
-
-    for (size_t i = 0; i < list->count; ++i) {
-        free(list->paths[i]);
-    }
-    free(list->paths);
-    list->paths = NULL;
-    list->count = 0;
-}
-
 static bool contains_path(const FileList *list, const char *target) {
     if (!list || !target) {
         return false;
@@ -234,6 +221,179 @@ static int test_nonexistent_directory(void) {
     return 1;
 }
 
+static int test_sort_by_size(void) {
+    printf("[4] Orden por tamaño (mayor primero)...\n");
+
+    char base_template[] = "/tmp/cli_gsea_dir_utils_sizeXXXXXX";
+    char *base_dir = mkdtemp(base_template);
+    if (!base_dir) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    const char *names[] = {"small.txt", "large.txt", "medium.txt", "tie.txt"};
+    const char *contents[] = {"a", "aaaaaaaaaaaaaaaa", "aaaaa", "bbbbb"};
+    char path[PATH_MAX];
+    int result = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        snprintf(path, sizeof(path), "%s/%s", base_dir, names[i]);
+        if (create_file_with_content(path, contents[i]) != 0) {
+            result = 1;
+        }
+    }
+
+    FileList list = {0};
+    read_directory_recursive(base_dir, &list);
+    sort_file_list_by_size(&list);
+
+    const char *expected[] = {"large.txt", "medium.txt", "tie.txt", "small.txt"};
+    const off_t expected_sizes[] = {16, 5, 5, 1};
+    bool order_ok = (list.count == 4 && list.sizes != NULL);
+    for (size_t i = 0; order_ok && i < 4; ++i) {
+        const char *name = strrchr(list.paths[i], '/') + 1;
+        order_ok = strcmp(name, expected[i]) == 0 && list.sizes[i] == expected_sizes[i];
+    }
+
+    if (result == 0 && order_ok) {
+        printf("   ✓ Tamaños capturados en el recorrido y lista ordenada de mayor a menor\n");
+    } else {
+        printf("   ✗ Orden o tamaños inesperados\n");
+        result = 1;
+    }
+
+    free_file_list(&list);
+    if (remove_path(base_dir) != 0) {
+        fprintf(stderr, "Warning: no se pudo eliminar %s\n", base_dir);
+    }
+
+    return result;
+}
+
+static int test_deep_and_large_tree(void) {
+    printf("[5] Rutas de más de 1024 bytes, enlaces y miles de archivos...\n");
+
+    char base_template[] = "/tmp/cli_gsea_dir_utils_deepXXXXXX";
+    char *base_dir = mkdtemp(base_template);
+    if (!base_dir) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    int result = 0;
+    char path[PATH_MAX];
+    size_t length = (size_t)snprintf(path, sizeof(path), "%s", base_dir);
+    for (int level = 0; level < 20 && result == 0; ++level) {
+        length += (size_t)snprintf(path + length, sizeof(path) - length,
+                                   "/nivel_%02d_con_un_nombre_bastante_largo_para_superar_el_limite", level);
+        result = ensure_directory(path) == 0 ? 0 : 1;
+    }
+    char deep_file[PATH_MAX + 16];
+    snprintf(deep_file, sizeof(deep_file), "%s/profundo.txt", path);
+    if (result == 0 && create_file_with_content(deep_file, "profundo") != 0) {
+        result = 1;
+    }
+
+    snprintf(path, sizeof(path), "%s/muchos", base_dir);
+    if (ensure_directory(path) != 0) {
+        result = 1;
+    }
+    for (int i = 0; i < 3000 && result == 0; ++i) {
+        snprintf(path, sizeof(path), "%s/muchos/f%04d.txt", base_dir, i);
+        result = create_file_with_content(path, "x") == 0 ? 0 : 1;
+    }
+    char link_path[PATH_MAX];
+    snprintf(link_path, sizeof(link_path), "%s/enlace.txt", base_dir);
+    // El enlace se sigue, como antes con stat: cuenta como el archivo al que apunta
+    if (symlink("muchos/f0000.txt", link_path) != 0) {
+        result = 1;
+    }
+
+    FileList list = {0};
+    read_directory_recursive(base_dir, &list);
+
+    bool ok = list.count == 3002 && strlen(deep_file) > 1024 && contains_path(&list, deep_file) &&
+              contains_path(&list, link_path);
+    for (size_t i = 0; ok && i < list.count; ++i) {
+        if (strcmp(list.paths[i], link_path) == 0) {
+            ok = list.sizes[i] == 1;
+        }
+    }
+
+    if (result == 0 && ok) {
+        printf("   ✓ %zu archivos, ruta de %zu bytes completa y enlace seguido\n",
+               list.count, strlen(deep_file));
+    } else {
+        printf("   ✗ Recorrido incompleto (%zu archivos)\n", list.count);
+        result = 1;
+    }
+
+    free_file_list(&list);
+    if (remove_path(base_dir) != 0) {
+        fprintf(stderr, "Warning: no se pudo eliminar %s\n", base_dir);
+    }
+
+    return result;
+}
+
+static int test_parallel_walk(void) {
+    printf("[6] Recorrido paralelo...\n");
+
+    char base_template[] = "/tmp/cli_gsea_dir_utils_parallelXXXXXX";
+    char *base_dir = mkdtemp(base_template);
+    if (!base_dir) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    int result = 0;
+    char path[PATH_MAX];
+    for (int d = 0; d < 12 && result == 0; ++d) {
+        snprintf(path, sizeof(path), "%s/d%02d", base_dir, d);
+        result |= ensure_directory(path) != 0;
+        snprintf(path, sizeof(path), "%s/d%02d/sub", base_dir, d);
+        result |= ensure_directory(path) != 0;
+        for (int f = 0; f < 40 && result == 0; ++f) {
+            snprintf(path, sizeof(path), "%s/d%02d/%s/f%02d.txt", base_dir, d, f % 2 ? "sub" : ".", f);
+            result |= create_file_with_content(path, "contenido") != 0;
+        }
+    }
+
+    FileList sequential = {0};
+    FileList single = {0};
+    FileList parallel = {0};
+    read_directory_recursive(base_dir, &sequential);
+    sort_file_list_by_path(&sequential);
+    read_directory_parallel(base_dir, &single, 1);
+    read_directory_parallel(base_dir, &parallel, 4);
+
+    bool same = sequential.count == 480 && single.count == 480 && parallel.count == 480;
+    for (size_t i = 0; same && i < parallel.count; ++i) {
+        same = strcmp(sequential.paths[i], parallel.paths[i]) == 0 &&
+               strcmp(single.paths[i], parallel.paths[i]) == 0 &&
+               parallel.sizes[i] == 9;
+    }
+
+    FileList missing = {0};
+    read_directory_parallel("/path/that/should/not/exist/cli_gsea", &missing, 4);
+
+    if (result == 0 && same && missing.count == 0) {
+        printf("   ✓ Mismos %zu archivos y mismo orden con 1 y 4 hilos\n", parallel.count);
+    } else {
+        printf("   ✗ El recorrido paralelo no coincide con el secuencial\n");
+        result = 1;
+    }
+
+    free_file_list(&sequential);
+    free_file_list(&single);
+    free_file_list(&parallel);
+    free_file_list(&missing);
+    if (remove_path(base_dir) != 0) {
+        fprintf(stderr, "Warning: no se pudo eliminar %s\n", base_dir);
+    }
+
+    return result;
+}
+
 int main(void) {
     printf("=== Pruebas de utilidades de directorio ===\n\n");
 
@@ -241,6 +401,9 @@ int main(void) {
     failures += test_recursive_listing();
     failures += test_empty_directory();
     failures += test_nonexistent_directory();
+    failures += test_sort_by_size();
+    failures += test_deep_and_large_tree();
+    failures += test_parallel_walk();
 
     printf("\n=== Resumen: %s ===\n", (failures == 0) ? "todas las pruebas pasaron" : "fallas detectadas");
     return failures == 0 ? 0 : 1;
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <time.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include "../include/file_manager.h"
 
 /**
@@ -199,6 +200,166 @@ void test_directory_operations() {
     printf("\n");
 }
 
+/**
+ * @brief Prueba proyección de solo lectura con mmap
+ */
+void test_file_mapping() {
+    printf("6. Prueba proyección de archivos (mmap):\n");
+
+    const char* test_file = "test/output/test_mapping.dat";
+    const char* empty_file = "test/output/test_mapping_empty.dat";
+    size_t data_size = 256 * 1024;
+    unsigned char* data = (unsigned char*)malloc(data_size);
+    if (data == NULL) {
+        printf("   ✗ Error: No se pudo asignar memoria\n");
+        return;
+    }
+
+    for (size_t i = 0; i < data_size; i++) {
+        data[i] = (unsigned char)((i * 13) % 256);
+    }
+
+    if (write_file(test_file, data, data_size) == 0) {
+        file_mapping_t mapping;
+        if (map_file_readonly(test_file, &mapping) == 0) {
+            if (mapping.mapped && mapping.size == data_size &&
+                memcmp(mapping.data, data, data_size) == 0) {
+                printf("   ✓ Contenido proyectado verificado (%zu bytes)\n", mapping.size);
+            } else {
+                printf("   ✗ Error: La proyección no coincide con el archivo\n");
+            }
+            unmap_file(&mapping);
+        } else {
+            printf("   ✗ Error al proyectar archivo\n");
+        }
+    }
+
+    if (write_file(empty_file, data, 0) == 0) {
+        file_mapping_t mapping;
+        if (map_file_readonly(empty_file, &mapping) == 0 && mapping.size == 0 && mapping.data == NULL) {
+            printf("   ✓ Archivo vacío produce una vista vacía\n");
+            unmap_file(&mapping);
+        } else {
+            printf("   ✗ Error: Archivo vacío no manejado\n");
+        }
+    }
+
+    file_mapping_t mapping;
+    if (map_file_readonly("test", &mapping) == -1) {
+        printf("   ✓ Correctamente rechazado directorio en proyección\n");
+    }
+
+    free(data);
+    printf("\n");
+}
+
+/**
+ * @brief Prueba copia de regiones entre descriptores (copy_file_range/sendfile)
+ */
+void test_copy_file_region() {
+    printf("7. Prueba copia de regiones entre archivos:\n");
+
+    const char* source_file = "test/output/test_copy_source.dat";
+    const char* target_file = "test/output/test_copy_target.dat";
+    size_t data_size = 600 * 1024;
+    unsigned char* data = (unsigned char*)malloc(data_size);
+    if (data == NULL) {
+        printf("   ✗ Error: No se pudo asignar memoria\n");
+        return;
+    }
+
+    for (size_t i = 0; i < data_size; i++) {
+        data[i] = (unsigned char)((i * 31) % 251);
+    }
+
+    if (write_file(source_file, data, data_size) != 0) {
+        printf("   ✗ Error al escribir archivo fuente\n");
+        free(data);
+        return;
+    }
+
+    int in_fd = open(source_file, O_RDONLY);
+    int out_fd = open(target_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    off_t offset = 1000;
+    size_t length = data_size - 2000;
+    int rc = copy_file_region(in_fd, &offset, out_fd, length);
+    off_t fd_position = lseek(in_fd, 0, SEEK_CUR);
+    int eof_rc = copy_file_region(in_fd, &offset, out_fd, 5000);
+    close(in_fd);
+    close(out_fd);
+
+    unsigned char* copied = NULL;
+    size_t copied_size = 0;
+    if (rc == 0 && read_file(target_file, &copied, &copied_size) == 0 &&
+        copied_size == length + 1000 && memcmp(copied, data + 1000, copied_size) == 0) {
+        printf("   ✓ Región copiada correctamente (%zu bytes)\n", length);
+    } else {
+        printf("   ✗ Error: La región copiada no coincide\n");
+    }
+
+    if (fd_position == 0 && offset == (off_t)data_size) {
+        printf("   ✓ Offset explícito avanzado sin mover el descriptor\n");
+    } else {
+        printf("   ✗ Error: Offsets inesperados tras la copia\n");
+    }
+
+    if (eof_rc == -2) {
+        printf("   ✓ Fin de archivo prematuro detectado\n");
+    } else {
+        printf("   ✗ Error: No se detectó el fin de archivo prematuro\n");
+    }
+
+    free(copied);
+    free(data);
+    printf("\n");
+}
+
+/**
+ * @brief Prueba de preasignación de salidas con fallocate
+ */
+void test_preallocate_file() {
+    printf("8. Prueba de preasignación de archivos:\n");
+
+    const char* test_file = "test/output/test_prealloc.dat";
+    int fd = open(test_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        printf("   ✗ Error: No se pudo crear archivo de prueba\n");
+        return;
+    }
+
+    off_t reserved = 2 * 1024 * 1024;
+    if (preallocate_file(fd, reserved) != 0) {
+        // Sistemas de archivos sin fallocate: el llamador sigue por append
+        printf("   ✓ fallocate no soportado aquí, se omite la reserva\n");
+    } else if (get_file_size(test_file) == 0) {
+        printf("   ✓ Espacio reservado (%lld bytes) sin cambiar el tamaño visible\n", (long long)reserved);
+    } else {
+        printf("   ✗ Error: La reserva cambió el tamaño del archivo\n");
+    }
+
+    const char* content = "contenido real";
+    size_t content_size = strlen(content);
+    struct stat st;
+    if (write(fd, content, content_size) == (ssize_t)content_size &&
+        release_preallocation(fd) == 0 &&
+        fstat(fd, &st) == 0 && st.st_size == (off_t)content_size &&
+        st.st_blocks * 512 < reserved) {
+        printf("   ✓ Reserva sobrante liberada tras una salida abandonada\n");
+    } else {
+        printf("   ✗ Error: No se liberó la reserva del archivo\n");
+    }
+
+    if (preallocate_file(fd, 0) == 0) {
+        printf("   ✓ Reserva de tamaño cero ignorada\n");
+    } else {
+        printf("   ✗ Error: Reserva de tamaño cero falló\n");
+    }
+
+    close(fd);
+    unlink(test_file);
+    printf("\n");
+}
+
 /**
  * @brief Función principal de pruebas del file manager
  */
@@ -213,6 +374,9 @@ int main() {
     test_large_file();
     test_error_handling();
     test_directory_operations();
+    test_file_mapping();
+    test_copy_file_region();
+    test_preallocate_file();
     
     printf("=== Pruebas completadas ===\n");
     return 0;
@@ -2,8 +2,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <time.h>
 #include "../include/file_manager.h"
+#include "../include/archive.h"
+#include "../include/operations.h"
+#include "../include/chunk_cache.h"
+#include "../include/delta.h"
 
 /**
  * @brief Prueba flujo completo: compresión + encriptación
@@ -271,6 +278,406 @@ void test_large_binary_file_flow() {
     printf("\n");
 }
 
+/**
+ * @brief Prueba extracción por rango con y sin índice de chunks
+ */
+void test_range_extraction_flow() {
+    printf("6. Prueba extracción por rango (--index / --range):\n");
+
+    const char *input_file = "test/output/range_input.bin";
+    const char *indexed_file = "test/output/range_indexed.lzw";
+    const char *plain_file = "test/output/range_plain.lzw";
+    const char *range_output = "test/output/range_output.bin";
+
+    // 3MB para que el rango cruce el límite entre chunks de 1MB
+    size_t file_size = 3 * 1024 * 1024;
+    unsigned char *test_data = (unsigned char *)malloc(file_size);
+    for (size_t i = 0; i < file_size; i++) {
+        test_data[i] = (unsigned char)((i / 64) % 251);
+    }
+    assert(write_file(input_file, test_data, file_size) == 0);
+
+    char command[512];
+    snprintf(command, sizeof(command),
+             "./gsea -c --comp-alg lzw --index -i %s -o %s > /dev/null", input_file, indexed_file);
+    assert(system(command) == 0);
+    snprintf(command, sizeof(command),
+             "./gsea -c --comp-alg lzw -i %s -o %s > /dev/null", input_file, plain_file);
+    assert(system(command) == 0);
+    printf("   ✓ Streams con y sin índice generados\n");
+
+    // El stream indexado debe seguir descomprimiéndose completo
+    snprintf(command, sizeof(command),
+             "./gsea -d --comp-alg lzw -i %s -o %s > /dev/null", indexed_file, range_output);
+    assert(system(command) == 0);
+    unsigned char *full_data = NULL;
+    size_t full_size = 0;
+    assert(read_file(range_output, &full_data, &full_size) == 0);
+    assert(full_size == file_size);
+    assert(memcmp(full_data, test_data, file_size) == 0);
+    free(full_data);
+    printf("   ✓ Stream indexado descomprimido completo correctamente\n");
+
+    const char *sources[] = {indexed_file, plain_file};
+    size_t offset = 1024 * 1024 - 100;
+    size_t length = 5000;
+    for (int i = 0; i < 2; i++) {
+        snprintf(command, sizeof(command),
+                 "./gsea -d --comp-alg lzw -i %s -o %s --range %zu:%zu > /dev/null",
+                 sources[i], range_output, offset, length);
+        assert(system(command) == 0);
+
+        unsigned char *range_data = NULL;
+        size_t range_size = 0;
+        assert(read_file(range_output, &range_data, &range_size) == 0);
+        assert(range_size == length);
+        assert(memcmp(range_data, test_data + offset, length) == 0);
+        free(range_data);
+    }
+    printf("   ✓ Rango entre chunks extraído correctamente (con y sin índice)\n");
+
+    // Un rango que sobrepasa el final se recorta al contenido
+    snprintf(command, sizeof(command),
+             "./gsea -d --comp-alg lzw -i %s -o %s --range %zu:100000 > /dev/null",
+             indexed_file, range_output, file_size - 10);
+    assert(system(command) == 0);
+    assert(get_file_size(range_output) == 10);
+    printf("   ✓ Rango final recortado al tamaño del contenido\n");
+
+    free(test_data);
+    printf("\n");
+}
+
+/**
+ * @brief Prueba que --io-uring produce el mismo stream que la E/S bloqueante
+ */
+void test_async_io_flow() {
+    printf("7. Prueba E/S asíncrona (--io-uring):\n");
+
+    const char *input_file = "test/output/async_input.bin";
+    const char *async_file = "test/output/async_compressed.lzw";
+    const char *blocking_file = "test/output/async_blocking.lzw";
+    const char *output_file = "test/output/async_output.bin";
+
+    // Varios chunks de 1MB para tener más de una lectura en vuelo
+    size_t file_size = 5 * 1024 * 1024 + 123;
+    unsigned char *test_data = (unsigned char *)malloc(file_size);
+    for (size_t i = 0; i < file_size; i++) {
+        test_data[i] = (unsigned char)((i * 7 / 13) % 256);
+    }
+    assert(write_file(input_file, test_data, file_size) == 0);
+
+    char command[512];
+    snprintf(command, sizeof(command),
+             "./gsea -c --comp-alg lzw --io-uring -i %s -o %s > /dev/null", input_file, async_file);
+    assert(system(command) == 0);
+    snprintf(command, sizeof(command),
+             "./gsea -c --comp-alg lzw -i %s -o %s > /dev/null", input_file, blocking_file);
+    assert(system(command) == 0);
+
+    unsigned char *async_data = NULL;
+    size_t async_size = 0;
+    unsigned char *blocking_data = NULL;
+    size_t blocking_size = 0;
+    assert(read_file(async_file, &async_data, &async_size) == 0);
+    assert(read_file(blocking_file, &blocking_data, &blocking_size) == 0);
+    assert(async_size == blocking_size);
+    assert(memcmp(async_data, blocking_data, async_size) == 0);
+    free(async_data);
+    free(blocking_data);
+    printf("   ✓ Stream idéntico al generado con E/S bloqueante\n");
+
+    snprintf(command, sizeof(command),
+             "./gsea -d --comp-alg lzw --io-uring -i %s -o %s > /dev/null", async_file, output_file);
+    assert(system(command) == 0);
+
+    unsigned char *restored = NULL;
+    size_t restored_size = 0;
+    assert(read_file(output_file, &restored, &restored_size) == 0);
+    assert(restored_size == file_size);
+    assert(memcmp(restored, test_data, file_size) == 0);
+    free(restored);
+    printf("   ✓ Descompresión asíncrona restaura los datos\n");
+
+    free(test_data);
+    printf("\n");
+}
+
+/**
+ * @brief Prueba el modo --direct-io (O_DIRECT o descarte del page cache)
+ */
+void test_direct_io_flow() {
+    printf("8. Prueba modo sin page cache (--direct-io):\n");
+
+    const char *input_file = "test/output/async_input.bin";
+    const char *direct_file = "test/output/direct_compressed.rle";
+    const char *output_file = "test/output/direct_output.bin";
+
+    unsigned char *original = NULL;
+    size_t original_size = 0;
+    assert(read_file(input_file, &original, &original_size) == 0);
+
+    char command[512];
+    snprintf(command, sizeof(command),
+             "./gsea -c --comp-alg rle --direct-io -i %s -o %s > /dev/null", input_file, direct_file);
+    assert(system(command) == 0);
+    snprintf(command, sizeof(command),
+             "./gsea -d --comp-alg rle --direct-io -i %s -o %s > /dev/null", direct_file, output_file);
+    assert(system(command) == 0);
+
+    unsigned char *restored = NULL;
+    size_t restored_size = 0;
+    assert(read_file(output_file, &restored, &restored_size) == 0);
+    assert(restored_size == original_size);
+    assert(memcmp(restored, original, original_size) == 0);
+    printf("   ✓ Ida y vuelta sin page cache correcta\n");
+
+    free(original);
+    free(restored);
+    printf("\n");
+}
+
+/**
+ * @brief Prueba que los huecos de un archivo disperso se conservan
+ */
+void test_sparse_file_flow() {
+    printf("9. Prueba de archivos dispersos:\n");
+
+    const char *input_file = "test/output/sparse_input.img";
+    const char *compressed_file = "test/output/sparse_compressed.rle";
+    const char *output_file = "test/output/sparse_output.img";
+
+    // 16MB lógicos con solo 64KB de datos en el medio
+    size_t file_size = 16 * 1024 * 1024;
+    size_t data_offset = 6 * 1024 * 1024 + 4096;
+    unsigned char block[64 * 1024];
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] = (unsigned char)(i % 13 + 1);
+    }
+
+    int fd = open(input_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd != -1);
+    assert(ftruncate(fd, (off_t)file_size) == 0);
+    assert(pwrite(fd, block, sizeof(block), (off_t)data_offset) == (ssize_t)sizeof(block));
+    close(fd);
+
+    char command[512];
+    snprintf(command, sizeof(command),
+             "./gsea -c --comp-alg rle -i %s -o %s > /dev/null", input_file, compressed_file);
+    assert(system(command) == 0);
+    assert(get_file_size(compressed_file) < 256 * 1024);
+    printf("   ✓ Huecos almacenados como chunks de ceros (%lld bytes)\n",
+           (long long)get_file_size(compressed_file));
+
+    snprintf(command, sizeof(command),
+             "./gsea -d --comp-alg rle -i %s -o %s > /dev/null", compressed_file, output_file);
+    assert(system(command) == 0);
+
+    unsigned char *restored = NULL;
+    size_t restored_size = 0;
+    assert(read_file(output_file, &restored, &restored_size) == 0);
+    assert(restored_size == file_size);
+    for (size_t i = 0; i < file_size; i++) {
+        unsigned char expected = 0;
+        if (i >= data_offset && i < data_offset + sizeof(block)) {
+            expected = block[i - data_offset];
+        }
+        assert(restored[i] == expected);
+    }
+    free(restored);
+    printf("   ✓ Contenido restaurado correctamente\n");
+
+    struct stat st;
+    assert(stat(output_file, &st) == 0);
+    if ((off_t)st.st_blocks * 512 < st.st_size) {
+        printf("   ✓ La salida conserva los huecos (%lld bytes asignados)\n",
+               (long long)st.st_blocks * 512);
+    } else {
+        printf("   ✓ Sistema de archivos sin huecos: salida densa\n");
+    }
+
+    printf("\n");
+}
+
+static int same_contents(const char *a, const char *b) {
+    unsigned char *data_a = NULL;
+    unsigned char *data_b = NULL;
+    size_t size_a = 0;
+    size_t size_b = 0;
+    int same = read_file(a, &data_a, &size_a) == 0 && read_file(b, &data_b, &size_b) == 0 &&
+               size_a == size_b && memcmp(data_a, data_b, size_a) == 0;
+    free(data_a);
+    free(data_b);
+    return same;
+}
+
+/**
+ * @brief Directorio → archive comprimido y encriptado sin archive temporal
+ */
+void test_streaming_directory_flow() {
+    printf("10. Prueba de pipeline de directorio en streaming:\n");
+
+    create_directory("test/output/stream_dir/nested");
+    unsigned char data[300 * 1024];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (unsigned char)((i / 7) % 31);
+    }
+    assert(write_file("test/output/stream_dir/block.bin", data, sizeof(data)) == 0);
+    assert(write_file("test/output/stream_dir/nested/note.txt",
+                      (const unsigned char *)"streaming", 9) == 0);
+
+    program_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.operations = OP_COMPRESS | OP_ENCRYPT;
+    config.comp_alg = COMP_ALG_LZW;
+    config.enc_alg = ENC_ALG_VIGENERE;
+    config.durability = DURABILITY_NONE;
+    strcpy(config.key, "stream_key");
+    strcpy(config.input_path, "test/output/stream_dir");
+    assert(compress_and_encrypt_directory(&config, "test/output/stream_dir.gsea") == 0);
+
+    // Mismo resultado que el camino en dos pasos (archive en claro + pipeline)
+    assert(create_directory_archive_file("test/output/stream_dir", "test/output/stream_raw.gsea") == 0);
+    assert(execute_file_pipeline(&config, "test/output/stream_raw.gsea",
+                                 "test/output/stream_two_pass.gsea") == 0);
+    assert(same_contents("test/output/stream_dir.gsea", "test/output/stream_two_pass.gsea"));
+    printf("   ✓ Salida idéntica a la del archive temporal\n");
+
+    config.operations = OP_DECRYPT | OP_DECOMPRESS;
+    strcpy(config.input_path, "test/output/stream_dir.gsea");
+    assert(decrypt_and_decompress_directory(&config, "test/output/stream_restored") == 0);
+    assert(same_contents("test/output/stream_dir/block.bin", "test/output/stream_restored/block.bin"));
+    assert(same_contents("test/output/stream_dir/nested/note.txt",
+                         "test/output/stream_restored/nested/note.txt"));
+    printf("   ✓ Extracción directa desde el stream descomprimido\n");
+
+    printf("\n");
+}
+
+/**
+ * @brief Caché de chunks comprimidos: la segunda compresión no recomprime nada
+ */
+void test_chunk_cache_flow() {
+    printf("11. Prueba de caché de compresión persistente:\n");
+
+    assert(system("rm -rf test/output/chunk_cache") == 0);
+    size_t size = 3 * 1024 * 1024 + 4096;
+    unsigned char *data = malloc(size);
+    assert(data != NULL);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (unsigned char)("artefacto de compilación "[i % 25] + (i / 65536) % 3);
+    }
+    assert(write_file("test/output/cache_input.bin", data, size) == 0);
+    free(data);
+
+    program_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.operations = OP_COMPRESS;
+    config.comp_alg = COMP_ALG_LZW;
+    config.durability = DURABILITY_NONE;
+    config.cache_max_bytes = CHUNK_CACHE_DEFAULT_SIZE;
+    strcpy(config.cache_dir, "test/output/chunk_cache");
+
+    chunk_cache_stats_t before;
+    chunk_cache_stats_t after;
+    chunk_cache_get_stats(&before);
+    assert(execute_file_pipeline(&config, "test/output/cache_input.bin", "test/output/cache_first.lzw") == 0);
+    chunk_cache_get_stats(&after);
+    assert(after.misses - before.misses == 4 && after.stores - before.stores == 4);
+    printf("   ✓ Primera ejecución: 4 chunks comprimidos y guardados\n");
+
+    before = after;
+    assert(execute_file_pipeline(&config, "test/output/cache_input.bin", "test/output/cache_second.lzw") == 0);
+    chunk_cache_get_stats(&after);
+    assert(after.hits - before.hits == 4 && after.misses == before.misses);
+    assert(same_contents("test/output/cache_first.lzw", "test/output/cache_second.lzw"));
+    printf("   ✓ Segunda ejecución: 4 aciertos y salida idéntica\n");
+
+    // Temporales de un proceso que murió a medio escribir: el viejo se borra, el reciente no
+    const char *stale_temp = "test/output/chunk_cache/00/.tmp-99999-0";
+    const char *fresh_temp = "test/output/chunk_cache/00/.tmp-99999-1";
+    create_directory("test/output/chunk_cache/00");
+    assert(write_file(stale_temp, (const unsigned char *)"GSCC", 4) == 0);
+    assert(write_file(fresh_temp, (const unsigned char *)"GSCC", 4) == 0);
+    struct timespec old_times[2] = {{time(NULL) - 24 * 3600, 0}, {time(NULL) - 24 * 3600, 0}};
+    assert(utimensat(AT_FDCWD, stale_temp, old_times, 0) == 0);
+
+    // Con un límite menor que lo guardado se expulsan las entradas menos usadas
+    config.cache_max_bytes = 1024;
+    config.comp_alg = COMP_ALG_RLE;
+    before = after;
+    assert(execute_file_pipeline(&config, "test/output/cache_input.bin", "test/output/cache_small.rle") == 0);
+    chunk_cache_get_stats(&after);
+    assert(after.evictions > before.evictions && after.used_bytes <= 1024);
+    printf("   ✓ Expulsión LRU al superar el límite (%llu entradas)\n",
+           (unsigned long long)(after.evictions - before.evictions));
+    assert(!file_exists(stale_temp) && file_exists(fresh_temp));
+    unlink(fresh_temp);
+    printf("   ✓ Temporales abandonados borrados al recorrer la caché\n");
+
+    printf("\n");
+}
+
+/**
+ * @brief Delta frente a una versión anterior: solo viajan los cambios
+ */
+void test_delta_flow() {
+    printf("12. Prueba de delta frente a una versión anterior:\n");
+
+    size_t size = 4 * 1024 * 1024;
+    unsigned char *base = malloc(size);
+    unsigned char *target = malloc(size + 4096);
+    assert(base != NULL && target != NULL);
+    unsigned int state = 12345;
+    for (size_t i = 0; i < size; i++) {
+        state = state * 1103515245u + 12345u;
+        base[i] = (unsigned char)(state >> 16);
+    }
+    // Nueva versión: bytes insertados al principio, una región reescrita y un borrado
+    size_t target_size = 0;
+    memcpy(target, "cabecera nueva", 14);
+    target_size += 14;
+    memcpy(target + target_size, base, 1024 * 1024);
+    target_size += 1024 * 1024;
+    memset(target + 512 * 1024, 'x', 300);
+    memcpy(target + target_size, base + 1024 * 1024 + 777, size - 1024 * 1024 - 777);
+    target_size += size - 1024 * 1024 - 777;
+    assert(write_file("test/output/delta_v1.bin", base, size) == 0);
+    assert(write_file("test/output/delta_v2.bin", target, target_size) == 0);
+    free(base);
+    free(target);
+
+    delta_stats_t stats;
+    assert(delta_encode("test/output/delta_v1.bin", "test/output/delta_v2.bin",
+                        "test/output/delta_raw.gsdl", &stats) == 0);
+    assert(stats.inserted_bytes < 1024 && stats.copied_bytes + stats.inserted_bytes == target_size);
+    printf("   ✓ Delta de %llu bytes para %zu bytes (%llu nuevos)\n",
+           (unsigned long long)stats.delta_size, target_size, (unsigned long long)stats.inserted_bytes);
+
+    program_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.operations = OP_COMPRESS | OP_ENCRYPT;
+    config.comp_alg = COMP_ALG_HUFFMAN;
+    config.enc_alg = ENC_ALG_VIGENERE;
+    config.durability = DURABILITY_NONE;
+    strcpy(config.key, "delta_key");
+    strcpy(config.delta_base, "test/output/delta_v1.bin");
+    assert(delta_compress_file(&config, "test/output/delta_v2.bin", "test/output/delta_v2.gsea") == 0);
+
+    config.operations = OP_DECRYPT | OP_DECOMPRESS;
+    assert(delta_reconstruct_file(&config, "test/output/delta_v2.gsea", "test/output/delta_v2_restored.bin") == 0);
+    assert(same_contents("test/output/delta_v2.bin", "test/output/delta_v2_restored.bin"));
+    printf("   ✓ Reconstrucción exacta tras -ce / -du\n");
+
+    // Con otra base el delta se rechaza en lugar de producir basura
+    strcpy(config.delta_base, "test/output/delta_v2.bin");
+    assert(delta_reconstruct_file(&config, "test/output/delta_v2.gsea", "test/output/delta_wrong.bin") != 0);
+    assert(!file_exists("test/output/delta_wrong.bin"));
+    printf("   ✓ Base incorrecta detectada\n");
+
+    printf("\n");
+}
+
 int main() {
     printf("=== GSEA - Pruebas de Integración Completa ===\n\n");
     
@@ -291,6 +698,13 @@ int main() {
     test_encrypt_only_flow();
     test_error_handling_flow();
     test_large_binary_file_flow();
+    test_range_extraction_flow();
+    test_async_io_flow();
+    test_direct_io_flow();
+    test_sparse_file_flow();
+    test_streaming_directory_flow();
+    test_chunk_cache_flow();
+    test_delta_flow();
     
     printf("=== Todas las pruebas de integración completadas ===\n");
     return 0;
@@ -63,6 +63,151 @@ void test_argument_parser() {
             {"./gsea", "-i", "input.txt", "-o", "output.txt", NULL},
             -1,
             "Caso inválido: sin operaciones"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "lzw", "--index", "-i", "input.log", "-o", "output.lzw", NULL},
+            0,
+            "Caso válido: comprimir con índice de chunks"
+        },
+        {
+            {"./gsea", "-d", "--comp-alg", "lzw", "-i", "input.lzw", "-o", "parte.log", "--range", "1024:4096", NULL},
+            0,
+            "Caso válido: descomprimir un rango"
+        },
+        {
+            {"./gsea", "-d", "--comp-alg", "lzw", "-i", "input.lzw", "-o", "parte.log", "--range", "1024", NULL},
+            -1,
+            "Caso inválido: rango sin longitud"
+        },
+        {
+            {"./gsea", "-du", "--comp-alg", "lzw", "-i", "in.dat", "-o", "out", "-k", "clave", "--range", NULL},
+            -1,
+            "Caso inválido: --range sin argumento"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "rle", "--sync", "batch", "-i", "dir", "-o", "dir.rle", NULL},
+            0,
+            "Caso válido: sincronización batch"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "rle", "--sync", "siempre", "-i", "dir", "-o", "dir.rle", NULL},
+            -1,
+            "Caso inválido: política de sincronización desconocida"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "lzw", "--io-uring", "-i", "input.log", "-o", "output.lzw", NULL},
+            0,
+            "Caso válido: E/S asíncrona con io_uring"
+        },
+        {
+            {"./gsea", "-d", "--comp-alg", "lzw", "--direct-io", "-i", "input.lzw", "-o", "output.log", NULL},
+            0,
+            "Caso válido: modo sin page cache"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "rle", "--threads", "4", "-i", "dir", "-o", "dir.rle", NULL},
+            0,
+            "Caso válido: pool de 4 hilos"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "rle", "--threads", "0", "-i", "dir", "-o", "dir.rle", NULL},
+            -1,
+            "Caso inválido: cero hilos"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "rle", "--scheduler", "queue", "-i", "dir", "-o", "dir.rle", NULL},
+            0,
+            "Caso válido: cola compartida en lugar de robo de trabajo"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "rle", "--scheduler", "fifo", "-i", "dir", "-o", "dir.rle", NULL},
+            -1,
+            "Caso inválido: planificador desconocido"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "lzw", "--per-file", "-i", "dir", "-o", "dir_lzw", NULL},
+            0,
+            "Caso válido: directorio procesado por archivo"
+        },
+        {
+            {"./gsea", "-c", "--comp-alg", "lzw", "--archive-format", "v2", "-i", "dir", "-o", "dir.gsea", NULL},
+            0,
+            "Caso válido: archive v2 con entradas en paralelo"
+        },
+        {
+            {"./gsea", "--list", "-i", "dir.gsea", NULL},
+            0,
+            "Caso válido: listado de archive sin operaciones"
+        },
+        {
+            {"./gsea", "-c", "--extract", "*.conf", "-i", "dir.gsea", "-o", "out", NULL},
+            -1,
+            "Caso inválido: --extract con compresión"
+        },
+        {
+            {"./gsea", "-c", "--archive-format", "v2", "--solid", "-i", "dir", "-o", "dir.gsea", NULL},
+            0,
+            "Caso válido: archive v2 con bloques sólidos"
+        },
+        {
+            {"./gsea", "-c", "--solid", "-i", "dir", "-o", "dir.gsea", NULL},
+            -1,
+            "Caso inválido: --solid sin --archive-format v2"
+        },
+        {
+            {"./gsea", "-c", "--archive-format", "v2", "--dedup-chunks", "-i", "dir", "-o", "dir.gsea", NULL},
+            0,
+            "Caso válido: archive v2 con deduplicación por chunks"
+        },
+        {
+            {"./gsea", "-c", "--archive-format", "v2", "--dedup-chunks", "--solid", "-i", "dir", "-o", "dir.gsea", NULL},
+            -1,
+            "Caso inválido: --dedup-chunks junto con --solid"
+        },
+        {
+            {"./gsea", "-c", "--per-file", "--incremental", "-i", "dir", "-o", "out", NULL},
+            0,
+            "Caso válido: compresión incremental por archivo"
+        },
+        {
+            {"./gsea", "-d", "--per-file", "--incremental", "-i", "dir", "-o", "out", NULL},
+            -1,
+            "Caso inválido: --incremental con descompresión"
+        },
+        {
+            {"./gsea", "-c", "--cache-dir", "cache", "--cache-size", "512M", "-i", "a.bin", "-o", "a.rle", NULL},
+            0,
+            "Caso válido: compresión con caché persistente"
+        },
+        {
+            {"./gsea", "-ce", "--cache-dir", "cache", "-i", "a.bin", "-o", "a.gsea", "-k", "k", NULL},
+            -1,
+            "Caso inválido: caché con salida encriptada"
+        },
+        {
+            {"./gsea", "-c", "--delta-base", "v1.img", "-i", "v2.img", "-o", "v2.delta", NULL},
+            0,
+            "Caso válido: delta frente a una versión anterior"
+        },
+        {
+            {"./gsea", "-d", "--delta-base", "v1.img", "--range", "0:10", "-i", "v2.delta", "-o", "b", NULL},
+            -1,
+            "Caso inválido: --delta-base con --range"
+        },
+        {
+            {"./gsea", "-c", "--per-file", "--scheduler", "stream", "-i", "dir", "-o", "out", NULL},
+            0,
+            "Caso válido: procesamiento por archivo en streaming"
+        },
+        {
+            {"./gsea", "-c", "--scheduler", "stream", "-i", "dir", "-o", "out.gsea", NULL},
+            -1,
+            "Caso inválido: streaming sin --per-file"
+        },
+        {
+            {"./gsea", "-d", "--index", "-i", "a.lzw", "-o", "a.bin", NULL},
+            -1,
+            "Caso inválido: --index sin compresión"
         }
     };
     